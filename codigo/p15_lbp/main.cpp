@@ -77,23 +77,26 @@ void test_webcam()
 	//lbp = new SCSLBP;
 	//lbp = new BGLBP;
 
-	cv::Mat frame, img_lbp;
+	// only the tiles that changed since the previous frame are recomputed;
+	// the stream owns lbp from here on
+	StreamingLBP stream(lbp);
+	cv::Mat capture, frame, gray, img_lbp;
 	while (1)
 	{
-		cap >> frame;
-		cv::resize(frame, frame, cv::Size(320, 240));
+		cap >> capture;
+		cv::resize(capture, frame, cv::Size(320, 240));
 
 		imshow("capture", frame);
 		show_multi_histogram(frame);
 
-		cv::cvtColor(frame, frame, cv::COLOR_BGR2GRAY);
-		//cv::GaussianBlur(frame, frame, cv::Size(7, 7), 5, 3, cv::BORDER_CONSTANT);
+		cv::cvtColor(frame, gray, cv::COLOR_BGR2GRAY);
+		//cv::GaussianBlur(gray, gray, cv::Size(7, 7), 5, 3, cv::BORDER_CONSTANT);
 
-		imshow("gray", frame);
-		show_histogram("gray_hist", frame);
+		imshow("gray", gray);
+		show_histogram("gray_hist", gray);
 
-		lbp->run(frame, img_lbp);
-		cv::normalize(img_lbp, img_lbp, 0, 255, cv::NORM_MINMAX, CV_8UC1);
+		const cv::Mat& codes = stream.process(gray);
+		cv::normalize(codes, img_lbp, 0, 255, cv::NORM_MINMAX, CV_8UC1);
 
 		cv::imshow("lbp", img_lbp);
 		show_histogram("lbp_hist", img_lbp);
@@ -101,8 +104,6 @@ void test_webcam()
 		if (cv::waitKey(10) >= 0)
 			break;
 	}
-
-	delete lbp;
 }
 
 int main(int argc, const char **argv)
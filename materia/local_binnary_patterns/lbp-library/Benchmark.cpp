@@ -0,0 +1,640 @@
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <atomic>
+#include <cerrno>
+#include <opencv2/opencv.hpp>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+
+#include "lbplibrary.hpp"
+using namespace lbplibrary;
+
+#if defined(__GLIBC__)
+// Every heap allocation of the process, OpenCV's Mat buffers included, goes through these
+// glibc entry points, so counting them here gives the allocations per operator call.
+extern "C" {
+	void *__libc_malloc(size_t size);
+	void *__libc_calloc(size_t count, size_t size);
+	void *__libc_realloc(void *ptr, size_t size);
+	void *__libc_memalign(size_t alignment, size_t size);
+}
+
+static std::atomic<long> heap_allocations(0);
+
+extern "C" void *malloc(size_t size) __THROW
+{
+	heap_allocations.fetch_add(1, std::memory_order_relaxed);
+	return __libc_malloc(size);
+}
+
+extern "C" void *calloc(size_t count, size_t size) __THROW
+{
+	heap_allocations.fetch_add(1, std::memory_order_relaxed);
+	return __libc_calloc(count, size);
+}
+
+extern "C" void *realloc(void *ptr, size_t size) __THROW
+{
+	heap_allocations.fetch_add(1, std::memory_order_relaxed);
+	return __libc_realloc(ptr, size);
+}
+
+extern "C" void *memalign(size_t alignment, size_t size) __THROW
+{
+	heap_allocations.fetch_add(1, std::memory_order_relaxed);
+	return __libc_memalign(alignment, size);
+}
+
+extern "C" void *aligned_alloc(size_t alignment, size_t size) __THROW
+{
+	heap_allocations.fetch_add(1, std::memory_order_relaxed);
+	return __libc_memalign(alignment, size);
+}
+
+extern "C" int posix_memalign(void **ptr, size_t alignment, size_t size) __THROW
+{
+	heap_allocations.fetch_add(1, std::memory_order_relaxed);
+	*ptr = __libc_memalign(alignment, size);
+	return *ptr || size == 0 ? 0 : ENOMEM;
+}
+
+static long allocation_count() { return heap_allocations.load(std::memory_order_relaxed); }
+#else
+// not counted on this platform
+static long allocation_count() { return -1; }
+#endif
+
+// peak resident set size of the process in KiB, or -1 when it is not available
+static long peak_rss_kib()
+{
+#if defined(__APPLE__)
+	struct rusage usage;
+	return getrusage(RUSAGE_SELF, &usage) == 0 ? usage.ru_maxrss / 1024 : -1;
+#elif defined(__unix__)
+	struct rusage usage;
+	return getrusage(RUSAGE_SELF, &usage) == 0 ? usage.ru_maxrss : -1;
+#else
+	return -1;
+#endif
+}
+
+// average milliseconds per call of lbp->run over a fixed frame
+double time_per_frame(LBP *lbp, const cv::Mat &frame, cv::Mat &output, int iterations)
+{
+	lbp->run(frame, output); // warm-up, allocates the output
+	int64 start = cv::getTickCount();
+	for (int i = 0; i < iterations; i++)
+		lbp->run(frame, output);
+	return (cv::getTickCount() - start) * 1000.0 / cv::getTickFrequency() / iterations;
+}
+
+// scalar against the best instruction set on random 8-bit frames; olbp_ms, when given,
+// receives the SIMD time of each size so the other operators can be compared to OLBP
+void bench_simd(const char *name, LBP *lbp, double *olbp_ms = 0, double *ref_ms = 0)
+{
+	const cv::Size sizes[] = { cv::Size(640, 480), cv::Size(1920, 1080) };
+	const SimdLevel best = simdLevel();
+
+	std::cout << name << " 8-bit, best instruction set: " << simdLevelName(best) << std::endl;
+	for (int s = 0; s < 2; s++)
+	{
+		cv::Mat frame(sizes[s], CV_8UC1);
+		cv::randu(frame, cv::Scalar(0), cv::Scalar(256));
+		int iterations = s == 0 ? 200 : 50;
+
+		cv::Mat out_scalar, out_simd;
+		setSimdLevel(SIMD_SCALAR);
+		double ms_scalar = time_per_frame(lbp, frame, out_scalar, iterations);
+		setSimdLevel(best);
+		double ms_simd = time_per_frame(lbp, frame, out_simd, iterations);
+		if (olbp_ms)
+			olbp_ms[s] = ms_simd;
+
+		bool exact = cv::countNonZero(out_scalar != out_simd) == 0;
+		std::cout << std::fixed << std::setprecision(3)
+			<< sizes[s].width << "x" << sizes[s].height
+			<< "  scalar: " << ms_scalar << " ms"
+			<< "  " << simdLevelName(best) << ": " << ms_simd << " ms"
+			<< "  speedup: " << std::setprecision(2) << ms_scalar / ms_simd << "x"
+			<< "  bit-exact: " << (exact ? "yes" : "NO");
+		if (ref_ms)
+			std::cout << "  vs OLBP: " << ms_simd / ref_ms[s] << "x";
+		std::cout << std::endl;
+	}
+
+	delete lbp;
+}
+
+// the six opponent-colour codes of a 640x480 colour frame
+void bench_OCLBP()
+{
+	const SimdLevel best = simdLevel();
+	const int iterations = 100;
+
+	LBP *lbp = new OCLBP;
+
+	cv::Mat frame(480, 640, CV_8UC3);
+	cv::randu(frame, cv::Scalar::all(0), cv::Scalar::all(256));
+
+	double ms[2];
+	std::vector<cv::Mat> out[2];
+	for (int s = 0; s < 2; s++)
+	{
+		setSimdLevel(s == 0 ? SIMD_SCALAR : best);
+		lbp->run(frame, out[s]); // warm-up, allocates the planes and the outputs
+		int64 start = cv::getTickCount();
+		for (int i = 0; i < iterations; i++)
+			lbp->run(frame, out[s]);
+		ms[s] = (cv::getTickCount() - start) * 1000.0 / cv::getTickFrequency() / iterations;
+	}
+
+	bool exact = true;
+	for (int k = 0; k < 6; k++)
+		exact = exact && cv::countNonZero(out[0][k] != out[1][k]) == 0;
+	std::cout << "OCLBP 640x480 colour, best instruction set: " << simdLevelName(best) << std::endl
+		<< std::fixed << std::setprecision(3)
+		<< "scalar: " << ms[0] << " ms"
+		<< "  " << simdLevelName(best) << ": " << ms[1] << " ms"
+		<< "  speedup: " << std::setprecision(2) << ms[0] / ms[1] << "x"
+		<< "  fps: " << std::setprecision(0) << 1000.0 / ms[1]
+		<< "  bit-exact: " << (exact ? "yes" : "NO") << std::endl;
+
+	delete lbp;
+}
+
+// OLBP + 8x8 spatial histogram as two passes and fused, on a 640x480 frame
+void bench_spatial()
+{
+	const int iterations = 100;
+
+	LBP *lbp = new OLBP;
+
+	cv::Mat frame(480, 640, CV_8UC1);
+	cv::randu(frame, cv::Scalar(0), cv::Scalar(256));
+
+	cv::Mat codes, hist_two_pass, hist_fused;
+	int64 start = cv::getTickCount();
+	for (int i = 0; i < iterations; i++)
+	{
+		lbp->run(frame, codes);
+		spatial_histogram(codes, hist_two_pass, 256, 8, 8);
+	}
+	double ms_two_pass = (cv::getTickCount() - start) * 1000.0 / cv::getTickFrequency() / iterations;
+
+	start = cv::getTickCount();
+	for (int i = 0; i < iterations; i++)
+		computeSpatialLBPHistogram(frame, lbp, hist_fused, 256, 8, 8);
+	double ms_fused = (cv::getTickCount() - start) * 1000.0 / cv::getTickFrequency() / iterations;
+
+	bool exact = cv::countNonZero(hist_two_pass != hist_fused) == 0;
+	std::cout << "OLBP spatial histogram 640x480, 8x8 cells" << std::endl
+		<< std::fixed << std::setprecision(3)
+		<< "two passes: " << ms_two_pass << " ms"
+		<< "  fused: " << ms_fused << " ms"
+		<< "  speedup: " << std::setprecision(2) << ms_two_pass / ms_fused << "x"
+		<< "  identical: " << (exact ? "yes" : "NO") << std::endl;
+
+	delete lbp;
+}
+
+// multi-scale window scan over the OLBP codes of a 640x480 frame: every window
+// recounted with histogram() against one IntegralLBPHistogram build plus lookups
+void bench_integral()
+{
+	const int sides[] = { 32, 48, 64, 96, 128 };
+	const int step = 8;
+
+	LBP *lbp = new OLBP;
+
+	cv::Mat frame(480, 640, CV_8UC1), codes;
+	cv::randu(frame, cv::Scalar(0), cv::Scalar(256));
+	lbp->run(frame, codes);
+
+	std::vector<cv::Rect> windows;
+	for (int s = 0; s < 5; s++)
+		for (int y = 0; y + sides[s] <= codes.rows; y += step)
+			for (int x = 0; x + sides[s] <= codes.cols; x += step)
+				windows.push_back(cv::Rect(x, y, sides[s], sides[s]));
+
+	cv::Mat hist, sum_recount = cv::Mat::zeros(1, 256, CV_32SC1), sum_integral = cv::Mat::zeros(1, 256, CV_32SC1);
+	int64 start = cv::getTickCount();
+	for (size_t w = 0; w < windows.size(); w++)
+	{
+		histogram(codes(windows[w]), hist, 256);
+		sum_recount += hist;
+	}
+	double ms_recount = (cv::getTickCount() - start) * 1000.0 / cv::getTickFrequency();
+
+	start = cv::getTickCount();
+	IntegralLBPHistogram integral(codes, 256, 128 * 128);
+	double ms_build = (cv::getTickCount() - start) * 1000.0 / cv::getTickFrequency();
+	for (size_t w = 0; w < windows.size(); w++)
+	{
+		integral.histogram(windows[w], hist);
+		sum_integral += hist;
+	}
+	double ms_integral = (cv::getTickCount() - start) * 1000.0 / cv::getTickFrequency();
+
+	bool exact = cv::countNonZero(sum_recount != sum_integral) == 0;
+	std::cout << "Window scan 640x480, " << windows.size() << " windows of 32..128 px, "
+		<< (integral.depth() == CV_16U ? "16" : "32") << "-bit counts" << std::endl
+		<< std::fixed << std::setprecision(3)
+		<< "recount: " << ms_recount << " ms"
+		<< "  integral: " << ms_integral << " ms (build " << ms_build << " ms)"
+		<< "  speedup: " << std::setprecision(2) << ms_recount / ms_integral << "x"
+		<< "  identical: " << (exact ? "yes" : "NO") << std::endl;
+
+	delete lbp;
+}
+
+// one query against a gallery of 8x8 x 59 bin spatial histograms: scalar chi_square()
+// per pair, as before the SIMD kernels, against one batch call at the widest SIMD level
+void bench_distance()
+{
+	const int gallery_size = 20000, bins = 8 * 8 * 59;
+	const SimdLevel level = simdLevel();
+
+	cv::Mat gallery(gallery_size, bins, CV_32SC1), query(1, bins, CV_32SC1);
+	cv::randu(gallery, cv::Scalar(0), cv::Scalar(64));
+	cv::randu(query, cv::Scalar(0), cv::Scalar(64));
+
+	setSimdLevel(SIMD_SCALAR);
+	cv::Mat pairwise(gallery_size, 1, CV_64FC1), batch;
+	int64 start = cv::getTickCount();
+	for (int r = 0; r < gallery_size; r++)
+		pairwise.at<double>(r, 0) = chi_square(query, gallery.row(r));
+	double ms_pairwise = (cv::getTickCount() - start) * 1000.0 / cv::getTickFrequency();
+	setSimdLevel(level);
+
+	start = cv::getTickCount();
+	histogram_distances(query, gallery, batch, HISTOGRAM_CHI_SQUARE);
+	double ms_batch = (cv::getTickCount() - start) * 1000.0 / cv::getTickFrequency();
+
+	double max_error = 0;
+	for (int r = 0; r < gallery_size; r++)
+		max_error = std::max(max_error, std::abs(batch.at<double>(r, 0) - pairwise.at<double>(r, 0)) / pairwise.at<double>(r, 0));
+	std::cout << "Chi-square, 1 query x " << gallery_size << " histograms of " << bins << " bins" << std::endl
+		<< std::fixed << std::setprecision(3)
+		<< "pairwise scalar: " << ms_pairwise << " ms"
+		<< "  batch " << simdLevelName(level) << ": " << ms_batch << " ms"
+		<< "  speedup: " << std::setprecision(2) << ms_pairwise / ms_batch << "x"
+		<< "  max rel. error: " << std::scientific << max_error << std::endl;
+}
+
+// ParallelLBP against a single call, per operator and thread count, on a 4K frame
+void bench_parallel()
+{
+	const char *names[] = { "OLBP", "ELBP", "VARLBP", "CSLBP", "CSLDP", "XCSLBP", "SILTP", "CSSILTP", "SCSLBP", "BGLBP" };
+	const int iterations = 3;
+	const int cpus = cv::getNumberOfCPUs();
+	const int threads_default = cv::getNumThreads();
+
+	cv::Mat frame(2160, 3840, CV_8UC1);
+	cv::randu(frame, cv::Scalar(0), cv::Scalar(256));
+
+	std::cout << "ParallelLBP 3840x2160, " << cpus << " CPUs" << std::endl;
+	for (int k = 0; k < 10; k++)
+	{
+		LBP *lbp = 0;
+		switch (k)
+		{
+			case 0: lbp = new OLBP; break;
+			case 1: lbp = new ELBP; break;
+			case 2: lbp = new VARLBP; break;
+			case 3: lbp = new CSLBP; break;
+			case 4: lbp = new CSLDP; break;
+			case 5: lbp = new XCSLBP; break;
+			case 6: lbp = new SILTP; break;
+			case 7: lbp = new CSSILTP; break;
+			case 8: lbp = new SCSLBP; break;
+			case 9: lbp = new BGLBP; break;
+		}
+		ParallelLBP parallel(lbp);
+
+		cv::Mat out_serial, out_parallel;
+		double ms_serial = time_per_frame(lbp, frame, out_serial, iterations);
+		std::cout << std::fixed << std::setprecision(2) << names[k] << "  1 call: " << ms_serial << " ms";
+		for (int threads = 1; threads <= 16 && threads <= cpus; threads *= 2)
+		{
+			cv::setNumThreads(threads);
+			double ms = time_per_frame(&parallel, frame, out_parallel, iterations);
+			std::cout << "  " << threads << "t: " << ms << " ms (" << ms_serial / ms << "x)";
+		}
+		cv::setNumThreads(threads_default);
+
+		bool exact = cv::countNonZero(out_serial != out_parallel) == 0;
+		std::cout << "  bit-exact: " << (exact ? "yes" : "NO") << std::endl;
+	}
+}
+
+// frame sizes of the suite
+static const struct { const char *name; int width, height; } suite_sizes[] = {
+	{ "qvga", 320, 240 }, { "vga", 640, 480 }, { "720p", 1280, 720 }, { "1080p", 1920, 1080 }, { "4k", 3840, 2160 }
+};
+
+struct SuiteOptions
+{
+	std::vector<std::string> operators; // LBPFactory names
+	std::vector<std::string> sizes;     // names from suite_sizes
+	std::vector<int> threads;
+	std::vector<std::string> images;    // files, resized to every size; random frames when empty
+	std::string format;                 // table, csv or json
+	double min_time;                    // seconds of timed calls per measurement, at least 3 calls
+};
+
+struct SuiteResult
+{
+	std::string op, image;
+	int width, height, threads, iterations;
+	double ms_per_call, allocations_per_call;
+	long peak_rss;
+};
+
+static std::vector<std::string> split_list(const std::string &list)
+{
+	std::vector<std::string> items;
+	std::stringstream ss(list);
+	std::string item;
+	while (std::getline(ss, item, ','))
+		if (!item.empty())
+			items.push_back(item);
+	return items;
+}
+
+static std::string json_string(const std::string &text)
+{
+	std::string out = "\"";
+	for (size_t i = 0; i < text.size(); i++)
+	{
+		if (text[i] == '"' || text[i] == '\\')
+			out += '\\';
+		out += text[i];
+	}
+	return out + "\"";
+}
+
+// times one operator on one frame: a warm-up call sizes the outputs and the operator's
+// buffers, then the calls are repeated for at least min_time seconds
+static SuiteResult suite_measure(const std::string &name, const std::string &image, const cv::Mat &gray, const cv::Mat &colour, int threads, double min_time)
+{
+	LBP *op = LBPFactory::create(name);
+	LBP *lbp = threads > 1 ? new ParallelLBP(op) : op;
+	const bool planes = name == "oclbp"; // the only multi-plane operator, it needs colour
+	const cv::Mat &input = planes ? colour : gray;
+	cv::Mat output;
+	std::vector<cv::Mat> outputs;
+	cv::setNumThreads(threads);
+
+	if (planes)
+		lbp->run(input, outputs);
+	else
+		lbp->run(input, output);
+
+	SuiteResult r;
+	r.iterations = 0;
+	const long allocations = allocation_count();
+	const int64 start = cv::getTickCount();
+	double seconds = 0;
+	do
+	{
+		if (planes)
+			lbp->run(input, outputs);
+		else
+			lbp->run(input, output);
+		r.iterations++;
+		seconds = (cv::getTickCount() - start) / cv::getTickFrequency();
+	} while (r.iterations < 3 || seconds < min_time);
+
+	r.op = name;
+	r.image = image;
+	r.width = input.cols;
+	r.height = input.rows;
+	r.threads = threads;
+	r.ms_per_call = seconds * 1000.0 / r.iterations;
+	r.allocations_per_call = allocations < 0 ? -1 : double(allocation_count() - allocations) / r.iterations;
+	r.peak_rss = peak_rss_kib();
+
+	delete lbp;
+	return r;
+}
+
+static void suite_print(std::ostream &out, const std::string &format, const SuiteResult &r, bool first)
+{
+	const double pixels = double(r.width) * r.height;
+	const double ns_per_pixel = r.ms_per_call * 1e6 / pixels;
+	const double mpix_per_s = pixels / (r.ms_per_call * 1e3);
+
+	if (format == "csv")
+	{
+		if (first)
+			out << "operator,image,width,height,threads,iterations,ms_per_call,ns_per_pixel,mpix_per_s,allocations_per_call,peak_rss_kib" << std::endl;
+		out << r.op << "," << r.image << "," << r.width << "," << r.height << "," << r.threads << "," << r.iterations << ","
+			<< std::fixed << std::setprecision(4) << r.ms_per_call << "," << ns_per_pixel << "," << mpix_per_s << ","
+			<< std::setprecision(2) << r.allocations_per_call << "," << r.peak_rss << std::endl;
+	}
+	else if (format == "json")
+	{
+		out << (first ? "[\n" : ",\n") << "  { \"operator\": " << json_string(r.op) << ", \"image\": " << json_string(r.image)
+			<< ", \"width\": " << r.width << ", \"height\": " << r.height << ", \"threads\": " << r.threads
+			<< ", \"iterations\": " << r.iterations << std::fixed << std::setprecision(4)
+			<< ", \"ms_per_call\": " << r.ms_per_call << ", \"ns_per_pixel\": " << ns_per_pixel << ", \"mpix_per_s\": " << mpix_per_s
+			<< std::setprecision(2) << ", \"allocations_per_call\": " << r.allocations_per_call
+			<< ", \"peak_rss_kib\": " << r.peak_rss << " }";
+	}
+	else
+	{
+		if (first)
+			out << std::left << std::setw(9) << "operator" << std::setw(12) << "image" << std::right
+				<< std::setw(11) << "size" << std::setw(8) << "threads" << std::setw(12) << "ms/call"
+				<< std::setw(10) << "ns/pixel" << std::setw(10) << "MPix/s" << std::setw(12) << "allocs/call"
+				<< std::setw(14) << "peak RSS KiB" << std::endl;
+		std::stringstream size;
+		size << r.width << "x" << r.height;
+		out << std::left << std::setw(9) << r.op << std::setw(12) << r.image.substr(0, 11) << std::right
+			<< std::setw(11) << size.str() << std::setw(8) << r.threads << std::fixed << std::setprecision(3)
+			<< std::setw(12) << r.ms_per_call << std::setw(10) << ns_per_pixel << std::setprecision(1)
+			<< std::setw(10) << mpix_per_s << std::setw(12) << r.allocations_per_call
+			<< std::setw(14) << r.peak_rss << std::endl;
+	}
+}
+
+// every operator x frame x size x thread count, one result row each
+static int bench_suite(const SuiteOptions &options, std::ostream &out)
+{
+	const int threads_default = cv::getNumThreads();
+
+	// the frames: random 8-bit noise, or the given files scaled to each size
+	std::vector<std::pair<std::string, cv::Mat> > sources;
+	if (options.images.empty())
+	{
+		cv::Mat noise(2160, 3840, CV_8UC3);
+		cv::randu(noise, cv::Scalar::all(0), cv::Scalar::all(256));
+		sources.push_back(std::make_pair(std::string("random"), noise));
+	}
+	for (size_t i = 0; i < options.images.size(); i++)
+	{
+		cv::Mat image = cv::imread(options.images[i], cv::IMREAD_COLOR);
+		if (image.empty())
+		{
+			std::cerr << "cannot read " << options.images[i] << std::endl;
+			return 1;
+		}
+		std::string name = options.images[i].substr(options.images[i].find_last_of("/\\") + 1);
+		sources.push_back(std::make_pair(name, image));
+	}
+
+	bool first = true;
+	for (size_t k = 0; k < sources.size(); k++)
+		for (size_t z = 0; z < options.sizes.size(); z++)
+		{
+			int s = 0;
+			while (s < 5 && options.sizes[z] != suite_sizes[s].name)
+				s++;
+			cv::Size size(suite_sizes[s].width, suite_sizes[s].height);
+
+			cv::Mat colour, gray;
+			if (sources[k].second.size() == size)
+				colour = sources[k].second;
+			else if (k == 0 && options.images.empty())
+				colour = sources[k].second(cv::Rect(0, 0, size.width, size.height)).clone(); // crop the noise
+			else
+				cv::resize(sources[k].second, colour, size, 0, 0, cv::INTER_AREA);
+			cv::cvtColor(colour, gray, cv::COLOR_BGR2GRAY);
+
+			for (size_t o = 0; o < options.operators.size(); o++)
+				for (size_t t = 0; t < options.threads.size(); t++)
+				{
+					suite_print(out, options.format, suite_measure(options.operators[o], sources[k].first, gray, colour, options.threads[t], options.min_time), first);
+					first = false;
+				}
+		}
+	if (options.format == "json")
+		out << (first ? "[]" : "\n]") << std::endl;
+
+	cv::setNumThreads(threads_default);
+	return 0;
+}
+
+static void usage()
+{
+	std::cout << "usage: lbp_bench [--format table|csv|json] [--output FILE] [--operators olbp,elbp,...]" << std::endl
+		<< "                 [--sizes qvga,vga,720p,1080p,4k] [--threads 1,4,...] [--image FILE]... [--min-time SECONDS]" << std::endl
+		<< "       lbp_bench --kernels" << std::endl
+		<< "The first form times every operator on random frames (or on the given images, scaled to each size)" << std::endl
+		<< "and reports ns/pixel, MPix/s, heap allocations per call and the peak RSS of the process." << std::endl
+		<< "Thread counts above 1 run the operator through ParallelLBP. --kernels runs the scalar against" << std::endl
+		<< "SIMD, fused histogram, integral histogram, distance and ParallelLBP comparisons." << std::endl;
+}
+
+// the comparisons of the individual optimisations
+static void bench_kernels()
+{
+	double olbp_ms[2];
+	bench_simd("OLBP", new OLBP, olbp_ms);
+	bench_simd("CSLBP", new CSLBP, 0, olbp_ms);
+	bench_simd("CSSILTP", new CSSILTP, 0, olbp_ms);
+	bench_simd("SILTP", new SILTP, 0, olbp_ms);
+	bench_simd("SILTP 8 points", new SILTP(0.03f, 1, 8), 0, olbp_ms);
+	bench_simd("SCSLBP", new SCSLBP, 0, olbp_ms);
+	bench_OCLBP();
+	bench_spatial();
+	bench_integral();
+	bench_distance();
+	bench_parallel();
+}
+
+int main(int argc, const char **argv)
+{
+	SuiteOptions options;
+	options.operators = LBPFactory::names();
+	for (int s = 0; s < 5; s++)
+		options.sizes.push_back(suite_sizes[s].name);
+	options.threads.push_back(1);
+	if (cv::getNumberOfCPUs() > 1)
+		options.threads.push_back(cv::getNumberOfCPUs());
+	options.format = "table";
+	options.min_time = 0.2;
+	std::string output;
+
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		bool value = i + 1 < argc;
+		if (arg == "--kernels")
+		{
+			bench_kernels();
+			return 0;
+		}
+		else if (arg == "--format" && value)
+			options.format = argv[++i];
+		else if (arg == "--output" && value)
+			output = argv[++i];
+		else if (arg == "--operators" && value)
+		{
+			options.operators = split_list(argv[++i]);
+			for (size_t o = 0; o < options.operators.size(); o++)
+				for (size_t c = 0; c < options.operators[o].size(); c++)
+					options.operators[o][c] = static_cast<char>(tolower(options.operators[o][c]));
+		}
+		else if (arg == "--sizes" && value)
+			options.sizes = split_list(argv[++i]);
+		else if (arg == "--image" && value)
+			options.images.push_back(argv[++i]);
+		else if (arg == "--min-time" && value)
+			options.min_time = atof(argv[++i]);
+		else if (arg == "--threads" && value)
+		{
+			std::vector<std::string> list = split_list(argv[++i]);
+			options.threads.clear();
+			for (size_t t = 0; t < list.size(); t++)
+				options.threads.push_back(std::max(1, atoi(list[t].c_str())));
+		}
+		else
+		{
+			usage();
+			return arg == "--help" || arg == "-h" ? 0 : 1;
+		}
+	}
+
+	// reject unknown names before spending minutes on the others
+	if (options.format != "table" && options.format != "csv" && options.format != "json")
+	{
+		usage();
+		return 1;
+	}
+	for (size_t z = 0; z < options.sizes.size(); z++)
+	{
+		int s = 0;
+		while (s < 5 && options.sizes[z] != suite_sizes[s].name)
+			s++;
+		if (s == 5)
+		{
+			std::cerr << "unknown size " << options.sizes[z] << std::endl;
+			return 1;
+		}
+	}
+	try
+	{
+		for (size_t o = 0; o < options.operators.size(); o++)
+			delete LBPFactory::create(options.operators[o]);
+	}
+	catch (const cv::Exception &e)
+	{
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+
+	if (output.empty())
+		return bench_suite(options, std::cout);
+	std::ofstream file(output.c_str());
+	if (!file)
+	{
+		std::cerr << "cannot write " << output << std::endl;
+		return 1;
+	}
+	return bench_suite(options, file);
+}
@@ -4,7 +4,11 @@
 #include "lbplibrary.hpp"
 using namespace lbplibrary;
 
-void test_image()
+// operator names for LBPFactory, with the range of their codes:
+// olbp 0-255, elbp 0-255, varlbp 0-953.0, cslbp 0-15, csldp 0-15, xcslbp 0-15,
+// siltp 0-80, cssiltp 33-120, scslbp 0-15, bglbp 0-239
+
+void test_image(const std::string& name)
 {
 	cv::Mat img_output;
 	cv::Mat img_input = cv::imread("frames/1.png");
@@ -13,17 +17,7 @@ void test_image()
 	cv::cvtColor(img_input, img_input, cv::COLOR_BGR2GRAY);
 	//cv::GaussianBlur(img_input, img_input, cv::Size(7, 7), 5, 3, cv::BORDER_CONSTANT);
 
-	LBP *lbp;
-	lbp = new OLBP;     // 0-255
-	//lbp = new ELBP;     // 0-255
-	//lbp = new VARLBP;   // 0-953.0
-	//lbp = new CSLBP;    // 0-15
-	//lbp = new CSLDP;    // 0-15
-	//lbp = new XCSLBP;   // 0-15
-	//lbp = new SILTP;    // 0-80
-	//lbp = new CSSILTP;  // 33-120
-	//lbp = new SCSLBP;   // 0-15
-	//lbp = new BGLBP;    // 0-239
+	LBP *lbp = LBPFactory::create(name);
 	lbp->run(img_input, img_output);
 
 	double min, max; cv::minMaxLoc(img_output, &min, &max); std::cout << "min: " << min << ", max: " << max;
@@ -40,8 +34,7 @@ void test_OCLBP()
 	cv::Mat img_input = cv::imread("frames/1.png");
 	cv::imshow("Input", img_input);
 
-	LBP *lbp;
-	lbp = new OCLBP;
+	LBP *lbp = LBPFactory::create("oclbp");
 
 	std::vector<cv::Mat> vecMat;
 	lbp->run(img_input, vecMat);
@@ -57,41 +50,31 @@ void test_OCLBP()
 	delete lbp;
 }
 
-void test_webcam()
+void test_webcam(const std::string& name)
 {
 	cv::VideoCapture cap(0);
 	if (!cap.isOpened())
 		return;
 
-	LBP *lbp;
-	lbp = new OLBP;
-	//lbp = new ELBP;
-	//lbp = new VARLBP;
-	//lbp = new CSLBP;
-	//lbp = new CSLDP;
-	//lbp = new XCSLBP;
-	//lbp = new SILTP;
-	//lbp = new CSSILTP;
-	//lbp = new SCSLBP;
-	//lbp = new BGLBP;
-
-	cv::Mat frame, img_lbp;
+	// only the tiles that changed since the previous frame are recomputed
+	StreamingLBP stream(LBPFactory::create(name));
+	cv::Mat capture, frame, gray, img_lbp;
 	while (1)
 	{
-		cap >> frame;
-		cv::resize(frame, frame, cv::Size(320, 240));
+		cap >> capture;
+		cv::resize(capture, frame, cv::Size(320, 240));
 
 		imshow("capture", frame);
 		show_multi_histogram(frame);
 
-		cv::cvtColor(frame, frame, cv::COLOR_BGR2GRAY);
-		//cv::GaussianBlur(frame, frame, cv::Size(7, 7), 5, 3, cv::BORDER_CONSTANT);
+		cv::cvtColor(frame, gray, cv::COLOR_BGR2GRAY);
+		//cv::GaussianBlur(gray, gray, cv::Size(7, 7), 5, 3, cv::BORDER_CONSTANT);
 
-		imshow("gray", frame);
-		show_histogram("gray_hist", frame);
+		imshow("gray", gray);
+		show_histogram("gray_hist", gray);
 
-		lbp->run(frame, img_lbp);
-		cv::normalize(img_lbp, img_lbp, 0, 255, cv::NORM_MINMAX, CV_8UC1);
+		const cv::Mat& codes = stream.process(gray);
+		cv::normalize(codes, img_lbp, 0, 255, cv::NORM_MINMAX, CV_8UC1);
 
 		cv::imshow("lbp", img_lbp);
 		show_histogram("lbp_hist", img_lbp);
@@ -99,15 +82,15 @@ void test_webcam()
 		if (cv::waitKey(10) >= 0)
 			break;
 	}
-
-	delete lbp;
 }
 
 int main(int argc, const char **argv)
 {
-	//test_image();
+	std::string name = argc > 1 ? argv[1] : "olbp";
+
+	//test_image(name);
 	//test_OCLBP();
-	test_webcam();
+	test_webcam(name);
 
 	return 0;
 }
@@ -1,5 +1,7 @@
 #include "histogram.hpp"
+#include "package_lbp/simd/SIMD.h"
 #include <vector>
+#include <algorithm>
 
 namespace lbplibrary
 {
@@ -14,6 +16,20 @@ namespace lbplibrary
     }
   }
 
+  template <typename _Tp>
+  void map_codes_(const cv::Mat& src, cv::Mat& dst, const unsigned short* table, int size) {
+    dst.create(src.size(), src.type());
+    for (int i = 0; i < src.rows; i++) {
+      const _Tp* in = src.ptr<_Tp>(i);
+      _Tp* out = dst.ptr<_Tp>(i);
+      for (int j = 0; j < src.cols; j++) {
+        int code = static_cast<int>(in[j]);
+        // codes outside the table are not P-neighbour codes, leave them alone
+        out[j] = (code >= 0 && code < size) ? static_cast<_Tp>(table[code]) : in[j];
+      }
+    }
+  }
+
   template <typename _Tp>
   double chi_square_(const cv::Mat& histogram0, const cv::Mat& histogram1) {
     if (histogram0.type() != histogram1.type())
@@ -31,24 +47,398 @@ namespace lbplibrary
     return result;
   }
 
+  // cells of a spatial histogram: nx columns by ny rows of cells of size window,
+  // numPatterns bins each, stored column by column in one row
+  struct SpatialLayout
+  {
+    cv::Size window;
+    int stepx, stepy;
+    int nx, ny;
+    int numPatterns;
+  };
+
+  static SpatialLayout spatial_layout(const cv::Size& size, int numPatterns, const cv::Size& window, int overlap) {
+    SpatialLayout layout;
+    layout.window = window;
+    layout.stepx = window.width - overlap;
+    layout.stepy = window.height - overlap;
+    layout.numPatterns = numPatterns;
+    if (layout.stepx <= 0 || layout.stepy <= 0)
+      CV_Error(cv::Error::StsBadArg, "Overlap must be smaller than the cell size.");
+    layout.nx = layout.ny = 0;
+    for (int x = 0; x < size.width - window.width; x += layout.stepx)
+      layout.nx++;
+    for (int y = 0; y < size.height - window.height; y += layout.stepy)
+      layout.ny++;
+    return layout;
+  }
+
+  // adds code row y to the histograms of every cell that contains it
+  template <typename _Tp>
+  static void spatial_bin_row_(const _Tp* codes, int y, const SpatialLayout& layout, int* hist) {
+    const int first = y >= layout.window.height ? (y - layout.window.height) / layout.stepy + 1 : 0;
+    const int last = std::min(layout.ny - 1, y / layout.stepy);
+    for (int iy = first; iy <= last; iy++) {
+      for (int ix = 0; ix < layout.nx; ix++) {
+        int* cell = hist + (ix * layout.ny + iy) * layout.numPatterns;
+        const _Tp* c = codes + ix * layout.stepx;
+        for (int j = 0; j < layout.window.width; j++) {
+          int bin = c[j];
+          if ((unsigned)bin < (unsigned)layout.numPatterns)
+            cell[bin] += 1;
+        }
+      }
+    }
+  }
+
+  static bool spatial_bin_row(const cv::Mat& codes, int row, int y, const SpatialLayout& layout, int* hist) {
+    switch (codes.type()) {
+      case CV_8SC1: spatial_bin_row_<char>(codes.ptr<char>(row), y, layout, hist); break;
+      case CV_8UC1: spatial_bin_row_<unsigned char>(codes.ptr<unsigned char>(row), y, layout, hist); break;
+      case CV_16SC1: spatial_bin_row_<short>(codes.ptr<short>(row), y, layout, hist); break;
+      case CV_16UC1: spatial_bin_row_<unsigned short>(codes.ptr<unsigned short>(row), y, layout, hist); break;
+      case CV_32SC1: spatial_bin_row_<int>(codes.ptr<int>(row), y, layout, hist); break;
+      default: return false;
+    }
+    return true;
+  }
+
   void spatial_histogram(const cv::Mat& src, cv::Mat& hist, int numPatterns, const cv::Size& window, int overlap) {
-    int width = src.cols;
-    int height = src.rows;
-    std::vector<cv::Mat> histograms;
-    for (int x = 0; x < width - window.width; x += (window.width - overlap)) {
-      for (int y = 0; y < height - window.height; y += (window.height - overlap)) {
-        cv::Mat cell = cv::Mat(src, cv::Rect(x, y, window.width, window.height));
-        histograms.push_back(histogram(cell, numPatterns));
+    SpatialLayout layout = spatial_layout(src.size(), numPatterns, window, overlap);
+    hist = cv::Mat::zeros(1, layout.nx * layout.ny * numPatterns, CV_32SC1);
+    // rows below the last cell row are not binned
+    int rows = layout.ny > 0 ? (layout.ny - 1) * layout.stepy + window.height : 0;
+    for (int y = 0; y < rows; y++)
+      if (!spatial_bin_row(src, y, y, layout, hist.ptr<int>()))
+        break;
+  }
+
+  // histogram distances over int32 / float bins. The chi-square terms are computed in
+  // double from the widened bins, as the scalar loop does, and added to the result in bin
+  // order, so every SIMD level returns exactly the scalar value; the kernels only save the
+  // conversions and the divisions. Intersection and L1 of int32 histograms are summed
+  // exactly in 64-bit lanes.
+
+  // adds the chi-square terms of n consecutive bins in order
+  static inline void add_chi_terms(const double* terms, int n, double& result)
+  {
+    for (int k = 0; k < n; k++)
+      result += terms[k];
+  }
+
+#if defined(LBP_SIMD_X86)
+  LBP_TARGET_SSE41 static inline __m128d chi_term_sse(__m128d x, __m128d y)
+  {
+    // bins with an empty sum add nothing
+    const __m128d sign = _mm_set1_pd(-0.0);
+    __m128d a = _mm_sub_pd(x, y), b = _mm_add_pd(x, y);
+    __m128d keep = _mm_cmpgt_pd(_mm_andnot_pd(sign, b), _mm_set1_pd(std::numeric_limits<double>::epsilon()));
+    return _mm_and_pd(keep, _mm_div_pd(_mm_mul_pd(a, a), b));
+  }
+
+  LBP_TARGET_SSE41 static inline __m128d sum_ps_sse(__m128d acc, __m128 v)
+  {
+    acc = _mm_add_pd(acc, _mm_cvtps_pd(v));
+    return _mm_add_pd(acc, _mm_cvtps_pd(_mm_movehl_ps(v, v)));
+  }
+
+  LBP_TARGET_SSE41 static int distance_row_sse41(const int* h0, const int* h1, int n, HistogramDistance method, double& result)
+  {
+    int i = 0;
+    if (method == HISTOGRAM_CHI_SQUARE) {
+      double terms[4];
+      for (; i <= n - 4; i += 4) {
+        __m128i x = _mm_loadu_si128((const __m128i*)(h0 + i)), y = _mm_loadu_si128((const __m128i*)(h1 + i));
+        _mm_storeu_pd(terms, chi_term_sse(_mm_cvtepi32_pd(x), _mm_cvtepi32_pd(y)));
+        _mm_storeu_pd(terms + 2, chi_term_sse(_mm_cvtepi32_pd(_mm_srli_si128(x, 8)), _mm_cvtepi32_pd(_mm_srli_si128(y, 8))));
+        add_chi_terms(terms, 4, result);
       }
     }
-    hist.create(1, histograms.size()*numPatterns, CV_32SC1);
-    // i know this is a bit lame now... feel free to make this a bit more efficient...
-    for (int histIdx = 0; (std::size_t)histIdx < histograms.size(); histIdx++) {
-      for (int valIdx = 0; valIdx < numPatterns; valIdx++) {
-        int y = histIdx*numPatterns + valIdx;
-        hist.at<int>(0, y) = histograms[histIdx].at<int>(valIdx);
+    else {
+      __m128i acc = _mm_setzero_si128();
+      for (; i <= n - 4; i += 4) {
+        __m128i x = _mm_loadu_si128((const __m128i*)(h0 + i)), y = _mm_loadu_si128((const __m128i*)(h1 + i));
+        if (method == HISTOGRAM_INTERSECTION) {
+          __m128i m = _mm_min_epi32(x, y);
+          acc = _mm_add_epi64(acc, _mm_add_epi64(_mm_cvtepi32_epi64(m), _mm_cvtepi32_epi64(_mm_srli_si128(m, 8))));
+        }
+        else {
+          __m128i d = _mm_abs_epi32(_mm_sub_epi32(x, y));
+          acc = _mm_add_epi64(acc, _mm_add_epi64(_mm_cvtepu32_epi64(d), _mm_cvtepu32_epi64(_mm_srli_si128(d, 8))));
+        }
       }
+      long long lanes[2];
+      _mm_storeu_si128((__m128i*)lanes, acc);
+      result += (double)(lanes[0] + lanes[1]);
+    }
+    return i;
+  }
+
+  LBP_TARGET_SSE41 static int distance_row_sse41(const float* h0, const float* h1, int n, HistogramDistance method, double& result)
+  {
+    const __m128 sign = _mm_set1_ps(-0.0f);
+    __m128d acc = _mm_setzero_pd();
+    int i = 0;
+    if (method == HISTOGRAM_CHI_SQUARE) {
+      double terms[4];
+      for (; i <= n - 4; i += 4) {
+        __m128 x = _mm_loadu_ps(h0 + i), y = _mm_loadu_ps(h1 + i);
+        _mm_storeu_pd(terms, chi_term_sse(_mm_cvtps_pd(x), _mm_cvtps_pd(y)));
+        _mm_storeu_pd(terms + 2, chi_term_sse(_mm_cvtps_pd(_mm_movehl_ps(x, x)), _mm_cvtps_pd(_mm_movehl_ps(y, y))));
+        add_chi_terms(terms, 4, result);
+      }
+      return i;
+    }
+    for (; i <= n - 4; i += 4) {
+      __m128 x = _mm_loadu_ps(h0 + i), y = _mm_loadu_ps(h1 + i);
+      __m128 v;
+      if (method == HISTOGRAM_INTERSECTION)
+        v = _mm_min_ps(x, y);
+      else
+        v = _mm_andnot_ps(sign, _mm_sub_ps(x, y));
+      acc = sum_ps_sse(acc, v);
     }
+    result += _mm_cvtsd_f64(_mm_add_pd(acc, _mm_unpackhi_pd(acc, acc)));
+    return i;
+  }
+
+  LBP_TARGET_AVX2 static inline __m256d chi_term_avx2(__m256d x, __m256d y)
+  {
+    const __m256d sign = _mm256_set1_pd(-0.0);
+    __m256d a = _mm256_sub_pd(x, y), b = _mm256_add_pd(x, y);
+    __m256d keep = _mm256_cmp_pd(_mm256_andnot_pd(sign, b), _mm256_set1_pd(std::numeric_limits<double>::epsilon()), _CMP_GT_OQ);
+    return _mm256_and_pd(keep, _mm256_div_pd(_mm256_mul_pd(a, a), b));
+  }
+
+  LBP_TARGET_AVX2 static inline __m256d sum_ps_avx2(__m256d acc, __m256 v)
+  {
+    acc = _mm256_add_pd(acc, _mm256_cvtps_pd(_mm256_castps256_ps128(v)));
+    return _mm256_add_pd(acc, _mm256_cvtps_pd(_mm256_extractf128_ps(v, 1)));
+  }
+
+  LBP_TARGET_AVX2 static double hsum_avx2(__m256d acc)
+  {
+    __m128d v = _mm_add_pd(_mm256_castpd256_pd128(acc), _mm256_extractf128_pd(acc, 1));
+    return _mm_cvtsd_f64(_mm_add_pd(v, _mm_unpackhi_pd(v, v)));
+  }
+
+  LBP_TARGET_AVX2 static int distance_row_avx2(const int* h0, const int* h1, int n, HistogramDistance method, double& result)
+  {
+    int i = 0;
+    if (method == HISTOGRAM_CHI_SQUARE) {
+      double terms[8];
+      for (; i <= n - 8; i += 8) {
+        __m256i x = _mm256_loadu_si256((const __m256i*)(h0 + i)), y = _mm256_loadu_si256((const __m256i*)(h1 + i));
+        _mm256_storeu_pd(terms, chi_term_avx2(_mm256_cvtepi32_pd(_mm256_castsi256_si128(x)), _mm256_cvtepi32_pd(_mm256_castsi256_si128(y))));
+        _mm256_storeu_pd(terms + 4, chi_term_avx2(_mm256_cvtepi32_pd(_mm256_extracti128_si256(x, 1)), _mm256_cvtepi32_pd(_mm256_extracti128_si256(y, 1))));
+        add_chi_terms(terms, 8, result);
+      }
+    }
+    else {
+      __m256i acc = _mm256_setzero_si256();
+      for (; i <= n - 8; i += 8) {
+        __m256i x = _mm256_loadu_si256((const __m256i*)(h0 + i)), y = _mm256_loadu_si256((const __m256i*)(h1 + i));
+        if (method == HISTOGRAM_INTERSECTION) {
+          __m256i m = _mm256_min_epi32(x, y);
+          acc = _mm256_add_epi64(acc, _mm256_cvtepi32_epi64(_mm256_castsi256_si128(m)));
+          acc = _mm256_add_epi64(acc, _mm256_cvtepi32_epi64(_mm256_extracti128_si256(m, 1)));
+        }
+        else {
+          __m256i d = _mm256_abs_epi32(_mm256_sub_epi32(x, y));
+          acc = _mm256_add_epi64(acc, _mm256_cvtepu32_epi64(_mm256_castsi256_si128(d)));
+          acc = _mm256_add_epi64(acc, _mm256_cvtepu32_epi64(_mm256_extracti128_si256(d, 1)));
+        }
+      }
+      long long lanes[4];
+      _mm256_storeu_si256((__m256i*)lanes, acc);
+      result += (double)(lanes[0] + lanes[1] + lanes[2] + lanes[3]);
+    }
+    return i + distance_row_sse41(h0 + i, h1 + i, n - i, method, result);
+  }
+
+  LBP_TARGET_AVX2 static int distance_row_avx2(const float* h0, const float* h1, int n, HistogramDistance method, double& result)
+  {
+    const __m256 sign = _mm256_set1_ps(-0.0f);
+    __m256d acc = _mm256_setzero_pd();
+    int i = 0;
+    if (method == HISTOGRAM_CHI_SQUARE) {
+      double terms[8];
+      for (; i <= n - 8; i += 8) {
+        __m256 x = _mm256_loadu_ps(h0 + i), y = _mm256_loadu_ps(h1 + i);
+        _mm256_storeu_pd(terms, chi_term_avx2(_mm256_cvtps_pd(_mm256_castps256_ps128(x)), _mm256_cvtps_pd(_mm256_castps256_ps128(y))));
+        _mm256_storeu_pd(terms + 4, chi_term_avx2(_mm256_cvtps_pd(_mm256_extractf128_ps(x, 1)), _mm256_cvtps_pd(_mm256_extractf128_ps(y, 1))));
+        add_chi_terms(terms, 8, result);
+      }
+      return i + distance_row_sse41(h0 + i, h1 + i, n - i, method, result);
+    }
+    for (; i <= n - 8; i += 8) {
+      __m256 x = _mm256_loadu_ps(h0 + i), y = _mm256_loadu_ps(h1 + i);
+      __m256 v;
+      if (method == HISTOGRAM_INTERSECTION)
+        v = _mm256_min_ps(x, y);
+      else
+        v = _mm256_andnot_ps(sign, _mm256_sub_ps(x, y));
+      acc = sum_ps_avx2(acc, v);
+    }
+    result += hsum_avx2(acc);
+    return i + distance_row_sse41(h0 + i, h1 + i, n - i, method, result);
+  }
+#elif defined(LBP_SIMD_NEON) && defined(__aarch64__)
+  // double lanes (and vdivq_f32) need AArch64
+  static inline float64x2_t chi_term_neon(float64x2_t x, float64x2_t y)
+  {
+    float64x2_t a = vsubq_f64(x, y), b = vaddq_f64(x, y);
+    uint64x2_t keep = vcgtq_f64(vabsq_f64(b), vdupq_n_f64(std::numeric_limits<double>::epsilon()));
+    return vreinterpretq_f64_u64(vandq_u64(keep, vreinterpretq_u64_f64(vdivq_f64(vmulq_f64(a, a), b))));
+  }
+
+  static inline float64x2_t sum_ps_neon(float64x2_t acc, float32x4_t v)
+  {
+    acc = vaddq_f64(acc, vcvt_f64_f32(vget_low_f32(v)));
+    return vaddq_f64(acc, vcvt_high_f64_f32(v));
+  }
+
+  static int distance_row_neon(const int* h0, const int* h1, int n, HistogramDistance method, double& result)
+  {
+    int i = 0;
+    if (method == HISTOGRAM_CHI_SQUARE) {
+      double terms[4];
+      for (; i <= n - 4; i += 4) {
+        int32x4_t x = vld1q_s32(h0 + i), y = vld1q_s32(h1 + i);
+        vst1q_f64(terms, chi_term_neon(vcvtq_f64_s64(vmovl_s32(vget_low_s32(x))), vcvtq_f64_s64(vmovl_s32(vget_low_s32(y)))));
+        vst1q_f64(terms + 2, chi_term_neon(vcvtq_f64_s64(vmovl_high_s32(x)), vcvtq_f64_s64(vmovl_high_s32(y))));
+        add_chi_terms(terms, 4, result);
+      }
+    }
+    else if (method == HISTOGRAM_INTERSECTION) {
+      int64x2_t acc = vdupq_n_s64(0);
+      for (; i <= n - 4; i += 4)
+        acc = vpadalq_s32(acc, vminq_s32(vld1q_s32(h0 + i), vld1q_s32(h1 + i)));
+      result += (double)vaddvq_s64(acc);
+    }
+    else {
+      uint64x2_t acc = vdupq_n_u64(0);
+      for (; i <= n - 4; i += 4)
+        acc = vpadalq_u32(acc, vreinterpretq_u32_s32(vabdq_s32(vld1q_s32(h0 + i), vld1q_s32(h1 + i))));
+      result += (double)vaddvq_u64(acc);
+    }
+    return i;
+  }
+
+  static int distance_row_neon(const float* h0, const float* h1, int n, HistogramDistance method, double& result)
+  {
+    float64x2_t acc = vdupq_n_f64(0);
+    int i = 0;
+    if (method == HISTOGRAM_CHI_SQUARE) {
+      double terms[4];
+      for (; i <= n - 4; i += 4) {
+        float32x4_t x = vld1q_f32(h0 + i), y = vld1q_f32(h1 + i);
+        vst1q_f64(terms, chi_term_neon(vcvt_f64_f32(vget_low_f32(x)), vcvt_f64_f32(vget_low_f32(y))));
+        vst1q_f64(terms + 2, chi_term_neon(vcvt_high_f64_f32(x), vcvt_high_f64_f32(y)));
+        add_chi_terms(terms, 4, result);
+      }
+      return i;
+    }
+    for (; i <= n - 4; i += 4) {
+      float32x4_t x = vld1q_f32(h0 + i), y = vld1q_f32(h1 + i);
+      float32x4_t v;
+      if (method == HISTOGRAM_INTERSECTION)
+        v = vminq_f32(x, y);
+      else
+        v = vabdq_f32(x, y);
+      acc = sum_ps_neon(acc, v);
+    }
+    result += vaddvq_f64(acc);
+    return i;
+  }
+#endif
+
+  // scalar reference, also finishes the SIMD tails
+  template <typename _Tp>
+  static double distance_row_(const _Tp* h0, const _Tp* h1, int n, HistogramDistance method, SimdLevel level) {
+    double result = 0.0;
+    int i = 0;
+#if defined(LBP_SIMD_X86)
+    if (level == SIMD_256)
+      i = distance_row_avx2(h0, h1, n, method, result);
+    else if (level == SIMD_128)
+      i = distance_row_sse41(h0, h1, n, method, result);
+#elif defined(LBP_SIMD_NEON) && defined(__aarch64__)
+    if (level != SIMD_SCALAR)
+      i = distance_row_neon(h0, h1, n, method, result);
+#endif
+    switch (method) {
+      case HISTOGRAM_CHI_SQUARE:
+        for (; i < n; i++) {
+          // widened first: int32 bins do not overflow and float bins are not rounded
+          double a = (double)h0[i] - (double)h1[i];
+          double b = (double)h0[i] + (double)h1[i];
+          if (std::abs(b) > std::numeric_limits<double>::epsilon())
+            result += (a*a) / b;
+        }
+        break;
+      case HISTOGRAM_INTERSECTION:
+        for (; i < n; i++)
+          result += std::min(h0[i], h1[i]);
+        break;
+      case HISTOGRAM_L1:
+        for (; i < n; i++)
+          result += std::abs((double)h0[i] - (double)h1[i]);
+        break;
+    }
+    return result;
+  }
+
+  static void check_distance_args(const cv::Mat& histogram0, const cv::Mat& histogram1) {
+    if (histogram0.type() != histogram1.type())
+      CV_Error(cv::Error::StsBadArg, "Histograms must be of equal type.");
+    if (histogram0.type() != CV_32SC1 && histogram0.type() != CV_32FC1)
+      CV_Error(cv::Error::StsBadArg, "Histograms must be CV_32SC1 or CV_32FC1.");
+  }
+
+  double histogram_distance(const cv::Mat& histogram0, const cv::Mat& histogram1, HistogramDistance method) {
+    check_distance_args(histogram0, histogram1);
+    if (histogram0.rows != 1 || histogram0.rows != histogram1.rows || histogram0.cols != histogram1.cols)
+      CV_Error(cv::Error::StsBadArg, "Histograms must be of equal dimension.");
+    if (histogram0.type() == CV_32SC1)
+      return distance_row_<int>(histogram0.ptr<int>(), histogram1.ptr<int>(), histogram0.cols, method, simdLevel());
+    return distance_row_<float>(histogram0.ptr<float>(), histogram1.ptr<float>(), histogram0.cols, method, simdLevel());
+  }
+
+  // scores a block of gallery rows against the query
+  class HistogramDistanceBody : public cv::ParallelLoopBody
+  {
+  private:
+    const cv::Mat& query;
+    const cv::Mat& gallery;
+    cv::Mat& distances;
+    HistogramDistance method;
+    SimdLevel level;
+
+  public:
+    HistogramDistanceBody(const cv::Mat& query, const cv::Mat& gallery, cv::Mat& distances, HistogramDistance method)
+      : query(query), gallery(gallery), distances(distances), method(method), level(simdLevel()) {}
+
+    void operator()(const cv::Range& range) const
+    {
+      for (int r = range.start; r < range.end; r++) {
+        double d;
+        if (gallery.type() == CV_32SC1)
+          d = distance_row_<int>(query.ptr<int>(), gallery.ptr<int>(r), gallery.cols, method, level);
+        else
+          d = distance_row_<float>(query.ptr<float>(), gallery.ptr<float>(r), gallery.cols, method, level);
+        distances.at<double>(r, 0) = d;
+      }
+    }
+  };
+
+  void histogram_distances(const cv::Mat& query, const cv::Mat& gallery, cv::Mat& distances, HistogramDistance method) {
+    check_distance_args(query, gallery);
+    if (!query.isContinuous() || (int)query.total() != gallery.cols)
+      CV_Error(cv::Error::StsBadArg, "The query must have as many bins as a gallery row.");
+    distances.create(gallery.rows, 1, CV_64FC1);
+    // a few thousand bins per row, so blocks of rows keep the scheduling overhead low
+    cv::parallel_for_(cv::Range(0, gallery.rows), HistogramDistanceBody(query, gallery, distances, method), std::max(1, gallery.rows / 256));
   }
 
   // wrappers
@@ -68,11 +458,28 @@ namespace lbplibrary
       case CV_8UC1: return chi_square_<unsigned char>(histogram0, histogram1); break;
       case CV_16SC1: return chi_square_<short>(histogram0, histogram1); break;
       case CV_16UC1: return chi_square_<unsigned short>(histogram0, histogram1); break;
-      case CV_32SC1: return chi_square_<int>(histogram0, histogram1); break;
+      case CV_32SC1:
+      case CV_32FC1: return histogram_distance(histogram0, histogram1, HISTOGRAM_CHI_SQUARE);
       default: return 0;
     }
   }
 
+  void map_codes(const cv::Mat& src, cv::Mat& dst, LBPMapping mapping, int neighbors) {
+    const unsigned short* table = mappingTable(mapping, neighbors);
+    if (!table) {
+      src.copyTo(dst);
+      return;
+    }
+    int size = 1 << neighbors;
+    switch (src.type()) {
+      case CV_8UC1: map_codes_<unsigned char>(src, dst, table, size); break;
+      case CV_16UC1: map_codes_<unsigned short>(src, dst, table, size); break;
+      case CV_16SC1: map_codes_<short>(src, dst, table, size); break;
+      case CV_32SC1: map_codes_<int>(src, dst, table, size); break;
+      default: CV_Error(cv::Error::StsBadArg, "map_codes: codes must be 8U, 16U, 16S or 32S");
+    }
+  }
+
   void spatial_histogram(const cv::Mat& src, cv::Mat& dst, int numPatterns, int gridx, int gridy, int overlap) {
     int width = static_cast<int>(floor((double)src.cols / gridx));
     int height = static_cast<int>(floor((double)src.rows / gridy));
@@ -86,6 +493,18 @@ namespace lbplibrary
     return hist;
   }
 
+  cv::Mat map_codes(const cv::Mat& src, LBPMapping mapping, int neighbors) {
+    cv::Mat dst;
+    map_codes(src, dst, mapping, neighbors);
+    return dst;
+  }
+
+  cv::Mat histogram_distances(const cv::Mat& query, const cv::Mat& gallery, HistogramDistance method) {
+    cv::Mat distances;
+    histogram_distances(query, gallery, distances, method);
+    return distances;
+  }
+
   cv::Mat spatial_histogram(const cv::Mat& src, int numPatterns, const cv::Size& window, int overlap) {
     cv::Mat hist;
     spatial_histogram(src, hist, numPatterns, window, overlap);
@@ -98,6 +517,49 @@ namespace lbplibrary
     return hist;
   }
 
+  // code rows produced per call of the operator; small enough for a stripe to stay in cache
+  static const int SPATIAL_STRIPE_ROWS = 32;
+
+  void computeSpatialLBPHistogram(const cv::Mat& src, LBP* lbp, cv::Mat& hist, int numPatterns, int gridx, int gridy, int overlap) {
+    if (src.empty())
+      return;
+
+    if (lbp->halo() < 0) {
+      // the operator cannot run on stripes, histogram its whole code image
+      cv::Mat codes;
+      lbp->run(src, codes);
+      spatial_histogram(codes, hist, numPatterns, gridx, gridy, overlap);
+      return;
+    }
+
+    // same cells as spatial_histogram() over the full code image
+    cv::Size size = lbp->codeSize(src.size());
+    cv::Size window(static_cast<int>(floor((double)size.width / gridx)), static_cast<int>(floor((double)size.height / gridy)));
+    SpatialLayout layout = spatial_layout(size, numPatterns, window, overlap);
+    hist = cv::Mat::zeros(1, layout.nx * layout.ny * numPatterns, CV_32SC1);
+    int* bins = hist.ptr<int>();
+
+    int rows = layout.ny > 0 ? (layout.ny - 1) * layout.stepy + window.height : 0;
+    cv::Mat codes;
+    for (int first = 0, last = 0; first < rows; first = last) {
+      last = first + SPATIAL_STRIPE_ROWS;
+      if (rows - last < SPATIAL_STRIPE_ROWS / 2)
+        last = rows; // no thin tail stripe, some operators need a few rows
+      int top, bottom, offset;
+      lbp->stripeRows(src.rows, first, last, top, bottom, offset);
+      lbp->run(src.rowRange(top, bottom), codes);
+      for (int y = first; y < last; y++)
+        if (codes.empty() || !spatial_bin_row(codes, offset + y - first, y, layout, bins))
+          return;
+    }
+  }
+
+  cv::Mat computeSpatialLBPHistogram(const cv::Mat& src, LBP* lbp, int numPatterns, int gridx, int gridy, int overlap) {
+    cv::Mat hist;
+    computeSpatialLBPHistogram(src, lbp, hist, numPatterns, gridx, gridy, overlap);
+    return hist;
+  }
+
   void show_multi_histogram(cv::Mat &img)
   {
     const int maxnc = 6;
@@ -4,8 +4,18 @@
 #include <opencv2/opencv.hpp>
 #include <limits>
 
+#include "package_lbp/LBP.h"
+#include "package_lbp/mapping/Mapping.h"
+
 namespace lbplibrary
 {
+  enum HistogramDistance
+  {
+    HISTOGRAM_CHI_SQUARE,   // sum (h0 - h1)^2 / (h0 + h1), 0 for identical histograms
+    HISTOGRAM_INTERSECTION, // sum min(h0, h1), a similarity: larger is closer
+    HISTOGRAM_L1            // sum |h0 - h1|
+  };
+
   // templated functions
   template <typename _Tp>
   void histogram_(const cv::Mat& src, cv::Mat& hist, int numPatterns);
@@ -13,6 +23,9 @@ namespace lbplibrary
   template <typename _Tp>
   double chi_square_(const cv::Mat& histogram0, const cv::Mat& histogram1);
 
+  template <typename _Tp>
+  void map_codes_(const cv::Mat& src, cv::Mat& dst, const unsigned short* table, int size);
+
   // non-templated functions
   void spatial_histogram(const cv::Mat& src, cv::Mat& spatialhist, int numPatterns, const cv::Size& window, int overlap = 0);
 
@@ -20,12 +33,27 @@ namespace lbplibrary
   void spatial_histogram(const cv::Mat& src, cv::Mat& spatialhist, int numPatterns, int gridx = 8, int gridy = 8, int overlap = 0);
   void histogram(const cv::Mat& src, cv::Mat& hist, int numPatterns);
   double chi_square(const cv::Mat& histogram0, const cv::Mat& histogram1);
+  // maps raw P-neighbour codes to the bins of mapping (see Mapping.h); dst keeps the type of src
+  void map_codes(const cv::Mat& src, cv::Mat& dst, LBPMapping mapping, int neighbors = 8);
+
+  // SIMD distances between two 1 x N histograms of type CV_32SC1 or CV_32FC1
+  double histogram_distance(const cv::Mat& histogram0, const cv::Mat& histogram1, HistogramDistance method);
+  // scores query against every row of gallery (one histogram per row, same type and bin
+  // count) in parallel; distances is gallery.rows x 1, CV_64FC1
+  void histogram_distances(const cv::Mat& query, const cv::Mat& gallery, cv::Mat& distances, HistogramDistance method = HISTOGRAM_CHI_SQUARE);
 
   // Mat return type functions
   cv::Mat histogram(const cv::Mat& src, int numPatterns);
+  cv::Mat map_codes(const cv::Mat& src, LBPMapping mapping, int neighbors = 8);
+  cv::Mat histogram_distances(const cv::Mat& query, const cv::Mat& gallery, HistogramDistance method = HISTOGRAM_CHI_SQUARE);
   cv::Mat spatial_histogram(const cv::Mat& src, int numPatterns, const cv::Size& window, int overlap = 0);
   cv::Mat spatial_histogram(const cv::Mat& src, int numPatterns, int gridx = 8, int gridy = 8, int overlap = 0);
 
+  // fused LBP + spatial histogram: same result as spatial_histogram() over the code image
+  // of lbp, but the codes are binned a stripe at a time and the code image never exists
+  void computeSpatialLBPHistogram(const cv::Mat& src, LBP* lbp, cv::Mat& spatialhist, int numPatterns, int gridx = 8, int gridy = 8, int overlap = 0);
+  cv::Mat computeSpatialLBPHistogram(const cv::Mat& src, LBP* lbp, int numPatterns, int gridx = 8, int gridy = 8, int overlap = 0);
+
   void show_multi_histogram(cv::Mat &img);
   void show_histogram(std::string const& name, cv::Mat1b const& image);
 }
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "package_lbp/LBP.h"
+#include "package_lbp/simd/SIMD.h"
+#include "package_lbp/mapping/Mapping.h"
 #include "package_lbp/olbp/OLBP.h"
 #include "package_lbp/elbp/ELBP.h"
 #include "package_lbp/varlbp/VARLBP.h"
@@ -12,5 +14,10 @@
 #include "package_lbp/xcslbp/XCSLBP.h"
 #include "package_lbp/cssiltp/CSSILTP.h"
 #include "package_lbp/bglbp/BGLBP.h"
+#include "package_lbp/parallel/ParallelLBP.h"
+#include "package_lbp/integral/IntegralLBPHistogram.h"
+#include "package_lbp/factory/LBPFactory.h"
+#include "package_lbp/stream/StreamingLBP.h"
+#include "package_lbp/pyramid/LBPPyramid.h"
 
 #include "histogram.hpp"
@@ -1,17 +1,104 @@
 #pragma once
 
+#include <algorithm>
 #include <opencv2/opencv.hpp>
 
 #define _USE_MATH_DEFINES
 #include <math.h>
 
+#include "context/LBPContext.h"
+
 namespace lbplibrary
 {
+  // how an operator treats the pixels whose neighbourhood leaves the image
+  enum LBPBorder
+  {
+    LBP_BORDER_CROP,      // the output is smaller than the input by halo() on every side
+    LBP_BORDER_ZERO,      // neighbours outside the image read as zero
+    LBP_BORDER_REPLICATE, // neighbours outside the image repeat the edge pixel
+    LBP_BORDER_SKIP       // the codes along the image border are left at zero
+  };
+
   class LBP
   {
   public:
     virtual void run(const cv::Mat &img_input, cv::Mat &img_output){};
     virtual void run(const cv::Mat &img_input, std::vector<cv::Mat> &vec_output){};
     virtual ~LBP(){}
+
+    // the same with the scratch buffers of context instead of the operator's own ones,
+    // see LBPContext; operators without scratch memory ignore it
+    virtual void run(const cv::Mat &img_input, cv::Mat &img_output, LBPContext &context) { run(img_input, img_output); }
+    virtual void run(const cv::Mat &img_input, std::vector<cv::Mat> &vec_output, LBPContext &context) { run(img_input, vec_output); }
+
+    // codes of input in context.output() (or context.outputs() for the multi-plane
+    // operators), reusing the buffers of the previous frame
+    const cv::Mat& compute(const cv::Mat& input, LBPContext& context)
+    {
+      run(input, context.output(), context);
+      return context.output();
+    }
+    const std::vector<cv::Mat>& computePlanes(const cv::Mat& input, LBPContext& context)
+    {
+      run(input, context.outputs(), context);
+      return context.outputs();
+    }
+
+    // runs the operator on count images; outputs[i] is handed back to run, so its buffer is
+    // reused across batches by the operators that create() their output. LBPOperator<Op> overrides these with a loop over the
+    // non-virtual Op::run, so a batch costs one virtual call instead of one per image
+    virtual void runBatch(const cv::Mat* inputs, cv::Mat* outputs, size_t count)
+    {
+      for (size_t i = 0; i < count; i++)
+        run(inputs[i], outputs[i]);
+    }
+    virtual void runBatch(const cv::Mat* inputs, std::vector<cv::Mat>* outputs, size_t count)
+    {
+      for (size_t i = 0; i < count; i++)
+        run(inputs[i], outputs[i]);
+    }
+    void runBatch(const std::vector<cv::Mat>& inputs, std::vector<cv::Mat>& outputs)
+    {
+      outputs.resize(inputs.size());
+      runBatch(inputs.data(), outputs.data(), inputs.size());
+    }
+    void runBatch(const std::vector<cv::Mat>& inputs, std::vector<std::vector<cv::Mat> >& outputs)
+    {
+      outputs.resize(inputs.size());
+      runBatch(inputs.data(), outputs.data(), inputs.size());
+    }
+
+    // rows of input an output row depends on above and below it, or -1 when
+    // the operator cannot be run on row stripes (see ParallelLBP)
+    virtual int halo() const { return -1; }
+    virtual LBPBorder border() const { return LBP_BORDER_ZERO; }
+
+    // size of the code image for an input of the given size
+    cv::Size codeSize(const cv::Size& input) const
+    {
+      int crop = border() == LBP_BORDER_CROP ? 2 * halo() : 0;
+      return cv::Size(input.width - crop, input.height - crop);
+    }
+
+    // input rows [top, bottom) to run the operator on for the code rows [first, last);
+    // code row first is then row offset of its output
+    void stripeRows(int inputRows, int first, int last, int& top, int& bottom, int& offset) const
+    {
+      if (border() == LBP_BORDER_CROP) {
+        // code row k is centred on input row k + halo
+        top = first;
+        bottom = last + 2 * halo();
+        offset = 0;
+      }
+      else {
+        top = std::max(0, first - halo());
+        bottom = std::min(inputRows, last + halo());
+        offset = first - top;
+      }
+    }
+
+  protected:
+    // buffers of run(input, output)
+    LBPContext context;
   };
 }
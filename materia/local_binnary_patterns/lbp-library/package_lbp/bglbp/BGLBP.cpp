@@ -1,107 +1,131 @@
 #include <iostream>
 #include <assert.h>
+#include <algorithm>
 
 #include "BGLBP.h"
+#include "../parallel/ParallelLBP.h"
 
 namespace lbplibrary
 {
-  BGLBP::BGLBP() : beta(3), filterDim(3), neighbours(1)
+  BGLBP::BGLBP(int stripes) : beta(3), filterDim(3), neighbours(1), stripes(stripes)
   {
-    std::cout << "BGLBP()" << std::endl;
   }
 
   BGLBP::~BGLBP()
   {
-    std::cout << "~BGLBP()" << std::endl;
   }
 
-  void BGLBP::run(const cv::Mat &input, cv::Mat &BGLBP)
+  // a and b are 9 * pixel - sum of the 3x3 block for a neighbour and its diametral one, so
+  // the comparisons against the block mean m stay exact: the bit is set when m lies between
+  // the two and their distances to m add up to at least beta. _Wt is int for pixels of up
+  // to 16 bits and double for the wider types
+  template <typename _Wt>
+  static inline int BGLBP_bit(_Wt a, _Wt b, int beta)
   {
-    if (input.empty())
-      return;
+    bool between = (a >= 0 && b <= 0) || (a < 0 && b > 0);
+    return between && (std::abs(a) + std::abs(b) >= 9 * beta);
+  }
 
-    //int rows = input.size().height;
-    //int cols = input.size().width;
-    int channels = input.channels();
+  template <typename _Tp, typename _Wt>
+  struct BGLBPRows : public LBPRowKernel
+  {
+    const cv::Mat& gray;
+    cv::Mat& dst;
+    int beta;
 
-    // convert input image to grayscale
-    cv::Mat gray;
-    if (channels > 1)
-      cv::cvtColor(input, gray, cv::COLOR_BGR2GRAY);
-    else
-      gray = input.clone();
-
-    // for test
-    gray.data[0] = 9;
-    gray.data[1] = 7;
-    gray.data[2] = 3;
-    gray.data[0 + gray.cols] = 2;
-    gray.data[1 + gray.cols] = 3;
-    gray.data[2 + gray.cols] = 2;
-    gray.data[0 + 2*gray.cols] = 1;
-    gray.data[1 + 2*gray.cols] = 6;
-    gray.data[2 + 2*gray.cols] = 8;
-
-    // padd image with zeroes to deal with the edges
-    int padding = neighbours;
-    int binaryDescriptor = 0;
-    cv::Mat paddedImage = gray;
-    cv::copyMakeBorder(gray, paddedImage, padding, padding, padding, padding, cv::BORDER_CONSTANT, 0x00);
-
-    // create output image and set its elements on zero
-    BGLBP = cv::Mat(gray.rows, gray.cols, CV_8UC1);
-    memset(BGLBP.data, 0x00, BGLBP.cols * BGLBP.rows);
-
-    int* g_i = new int[filterDim*filterDim];
-    int* g_p_2 = new int[filterDim*filterDim];
-    float* weightVec = new float[filterDim*filterDim];
-    for (int i = 0; i < filterDim*filterDim; i++)
-      weightVec[i] = pow(2., i);
-
-    int diametralPositionY[9] = {1, 0, -1, 1, 0, -1, 1, 0, -1};
-    int diametralPositionX[9] = {1, 1, 1, 0, 0, 0, -1, -1, -1};
-
-    // process image
-    for (int i = 1; i < (gray.rows - padding); i++)
+    BGLBPRows(const cv::Mat& gray, cv::Mat& dst, int beta) : gray(gray), dst(dst), beta(beta) {}
+
+    void rows(int first, int last, int* hist) const
     {
-      for (int j = 1; j < (gray.cols - padding); j++)
+      const int cols = gray.cols;
+      for (int i = first; i < last; i++)
       {
-        // current central pixel
-        unsigned char* grayData = &gray.data[j + i * gray.cols];
-        //int centralPixel = gray.data[j + i * gray.cols];
-
-        // 3x3 neighborhood
-        float sum = 0;
-        float m = 0;
-        binaryDescriptor = 0;
-        int loop_counter = 0;
-        
-        for (int rowLocal = -1; rowLocal <= padding; rowLocal++)
+        const _Tp* up = gray.ptr<_Tp>(i - 1);
+        const _Tp* mid = gray.ptr<_Tp>(i);
+        const _Tp* down = gray.ptr<_Tp>(i + 1);
+        unsigned char* out = dst.ptr<unsigned char>(i);
+
+        out[0] = out[cols - 1] = 0;
+        for (int j = 1; j < cols - 1; j++)
         {
-          for (int colLocal = -1; colLocal <= padding; colLocal++)
-          {
-            sum += grayData[colLocal + rowLocal * gray.cols];
-
-            g_i[loop_counter] = grayData[colLocal + rowLocal * gray.cols];
-            g_p_2[loop_counter] = grayData[diametralPositionY[loop_counter] + (diametralPositionX[loop_counter]) * gray.cols];
-            loop_counter++;
-          }
-        }
-          m = sum / (filterDim*filterDim);
-
-          // save output value
-          for (int k = 0; k < filterDim*filterDim; k++)
-          {
-            int v;
-            if ( ( ((g_i[k] >= m) && (m >= g_p_2[k])) || ((g_i[k]< m) && (m < g_p_2[k])) ) && ((abs(g_i[k]-m) + abs(g_p_2[k]-m)) >= beta ) )
-              v = 1; // code 1
-            else
-              v = 0; // code 0
-
-          binaryDescriptor += weightVec[k] * v;
+          // 3x3 neighbourhood in raster order; the diametral position of k is 8 - k
+          const _Tp px[9] = { up[j - 1], up[j], up[j + 1], mid[j - 1], mid[j], mid[j + 1], down[j - 1], down[j], down[j + 1] };
+          _Wt g[9];
+          for (int k = 0; k < 9; k++)
+            g[k] = px[k];
+          _Wt sum = 0;
+          for (int k = 0; k < 9; k++)
+            sum += g[k];
+          _Wt d[9];
+          for (int k = 0; k < 9; k++)
+            d[k] = 9 * g[k] - sum;
+
+          // bit 4 (the centre against itself) is never set and bit 8 does not fit the 8-bit code
+          int code = 0;
+          for (int k = 0; k < 8; k++)
+            code |= BGLBP_bit<_Wt>(d[k], d[8 - k], beta) << k;
+          out[j] = static_cast<unsigned char>(code);
+          if (hist)
+            hist[code]++;
         }
-        BGLBP.data[j + BGLBP.cols * i] = binaryDescriptor;
-     }
-   }
- }
+      }
+    }
+  };
+
+  template <typename _Tp, typename _Wt>
+  void BGLBP::BGLBP_(const cv::Mat& gray, cv::Mat& dst, cv::Mat* hist)
+  {
+    const int rows = gray.rows;
+    const int cols = gray.cols;
+
+    // the codes along the image border stay zero
+    dst.create(rows, cols, CV_8UC1);
+    if (rows <= 2 * neighbours || cols <= 2 * neighbours) {
+      dst.setTo(cv::Scalar(0));
+      if (hist) {
+        hist->create(1, numPatterns(), CV_32SC1);
+        hist->setTo(cv::Scalar(0));
+      }
+      return;
+    }
+    dst.rowRange(0, neighbours).setTo(cv::Scalar(0));
+    dst.rowRange(rows - neighbours, rows).setTo(cv::Scalar(0));
+
+    runRowStripes(BGLBPRows<_Tp, _Wt>(gray, dst, beta), neighbours, rows - neighbours, stripes, hist, numPatterns());
+  }
+
+  void BGLBP::run(const cv::Mat &input, cv::Mat &BGLBP)
+  {
+    BGLBP_(input, BGLBP, 0, context);
+  }
+
+  void BGLBP::run(const cv::Mat &input, cv::Mat &BGLBP, LBPContext &context)
+  {
+    BGLBP_(input, BGLBP, 0, context);
+  }
+
+  void BGLBP::run(const cv::Mat &input, cv::Mat &BGLBP, cv::Mat &hist)
+  {
+    BGLBP_(input, BGLBP, &hist, context);
+  }
+
+  void BGLBP::BGLBP_(const cv::Mat &input, cv::Mat &BGLBP, cv::Mat* hist, LBPContext& context)
+  {
+    if (input.empty())
+      return;
+
+    // convert input image to grayscale
+    cv::Mat gray = context.gray(input, BGLBP);
+
+    switch (gray.type())
+    {
+      case CV_8SC1: BGLBP_<char, int>(gray, BGLBP, hist); break;
+      case CV_8UC1: BGLBP_<unsigned char, int>(gray, BGLBP, hist); break;
+      case CV_16SC1: BGLBP_<short, int>(gray, BGLBP, hist); break;
+      case CV_16UC1: BGLBP_<unsigned short, int>(gray, BGLBP, hist); break;
+      case CV_32SC1: BGLBP_<int, double>(gray, BGLBP, hist); break;
+      case CV_32FC1: BGLBP_<float, double>(gray, BGLBP, hist); break;
+      case CV_64FC1: BGLBP_<double, double>(gray, BGLBP, hist); break;
+    }
+  }
 }
@@ -11,11 +11,28 @@ namespace lbplibrary
     int beta;
     int filterDim;
     int neighbours;
+    int stripes;
+
+    void BGLBP_(const cv::Mat& input, cv::Mat& dst, cv::Mat* hist, LBPContext& context);
+    template <typename _Tp, typename _Wt>
+    void BGLBP_(const cv::Mat& gray, cv::Mat& dst, cv::Mat* hist);
 
   public:
-    BGLBP();
+    // stripes: 1 computes in the calling thread, n > 1 on n row stripes of the
+    // OpenCV thread pool, 0 picks the count from cv::getNumThreads()
+    BGLBP(int stripes = 1);
     ~BGLBP();
 
+    using LBP::run;
     void run(const cv::Mat &img_input, cv::Mat &img_output);
+    void run(const cv::Mat &img_input, cv::Mat &img_output, LBPContext &context);
+    // also counts the codes of the inner pixels in a 1 x numPatterns() CV_32SC1 histogram
+    void run(const cv::Mat &img_input, cv::Mat &img_output, cv::Mat &hist);
+
+    // codes are stored in 8 bits
+    int numPatterns() const { return 256; }
+
+    int halo() const { return neighbours; }
+    LBPBorder border() const { return LBP_BORDER_SKIP; }
   };
 }
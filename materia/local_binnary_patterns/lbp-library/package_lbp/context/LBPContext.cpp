@@ -0,0 +1,60 @@
+#include "LBPContext.h"
+
+namespace lbplibrary
+{
+  LBPContext::LBPContext() : allocations_(0)
+  {
+  }
+
+  cv::Mat& LBPContext::mat(int slot, int rows, int cols, int type)
+  {
+    if (slot >= (int)mats.size())
+      mats.resize(slot + 1);
+    cv::Mat& m = mats[slot];
+    if (m.rows != rows || m.cols != cols || m.type() != type) {
+      m.create(rows, cols, type);
+      m.setTo(cv::Scalar::all(0));
+      allocations_++;
+    }
+    return m;
+  }
+
+  unsigned char* LBPContext::bytes(int slot, size_t size)
+  {
+    if (slot >= (int)buffers.size())
+      buffers.resize(slot + 1);
+    cv::Mat& m = buffers[slot];
+    if (m.total() < size) {
+      // kept as one row; grown by half again so slowly increasing sizes settle quickly
+      cv::Mat grown = cv::Mat::zeros(1, static_cast<int>(std::max(size, m.total() + m.total() / 2)), CV_8UC1);
+      if (!m.empty())
+        m.copyTo(grown.colRange(0, m.cols));
+      m = grown;
+      allocations_++;
+    }
+    return m.data;
+  }
+
+  cv::Mat LBPContext::gray(const cv::Mat& input, const cv::Mat& output, int slot)
+  {
+    if (input.channels() > 1) {
+      cv::Mat& m = mat(slot, input.rows, input.cols, CV_MAKETYPE(input.depth(), 1));
+      cv::cvtColor(input, m, cv::COLOR_BGR2GRAY);
+      return m;
+    }
+    if (!output.empty() && input.data == output.data) {
+      cv::Mat& m = mat(slot, input.rows, input.cols, input.type());
+      input.copyTo(m);
+      return m;
+    }
+    return input;
+  }
+
+  void LBPContext::release()
+  {
+    output_.release();
+    outputs_.clear();
+    mats.clear();
+    buffers.clear();
+  }
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <deque>
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+namespace lbplibrary
+{
+  // Buffers of a run of LBP operators over a sequence of frames: the output Mats and numbered
+  // scratch slots. Everything is sized on the first frame and kept for the next ones, and only
+  // reallocated when the frame size or type changes, so a video loop that keeps one context
+  // does no heap allocation per frame. Every operator also owns a context of its own, used by
+  // run(input, output); pass a context explicitly to share buffers between operators, or give
+  // each thread one when running the same operator concurrently. A context must not be used
+  // by two threads at once.
+  class LBPContext
+  {
+  public:
+    LBPContext();
+
+    // output Mats of LBP::run(input, context)
+    cv::Mat& output() { return output_; }
+    std::vector<cv::Mat>& outputs() { return outputs_; }
+
+    // scratch matrix number slot with the given geometry; its contents are kept from the
+    // previous call and a (re)allocated matrix is zero-filled
+    cv::Mat& mat(int slot, int rows, int cols, int type);
+
+    // scratch array of at least count elements of the trivially copyable type T; it only
+    // grows, and grown memory is zero-filled
+    template <typename T>
+    T* buffer(int slot, size_t count)
+    {
+      return reinterpret_cast<T*>(bytes(slot, count * sizeof(T)));
+    }
+
+    // single channel version of input: a colour input is converted to gray in scratch slot
+    // `slot`, and an input sharing its data with output (an in-place call) is copied there,
+    // so the kernels never read what they have already written; any other input is returned
+    // as it is
+    cv::Mat gray(const cv::Mat& input, const cv::Mat& output, int slot = 0);
+
+    // scratch buffers (re)allocated so far; it stops growing once the frames repeat their geometry
+    int allocations() const { return allocations_; }
+    // frees every buffer
+    void release();
+
+  private:
+    cv::Mat output_;
+    std::vector<cv::Mat> outputs_;
+    // deques, so adding a slot does not move the Mats handed out for the others
+    std::deque<cv::Mat> mats;
+    std::deque<cv::Mat> buffers;
+    int allocations_;
+
+    unsigned char* bytes(int slot, size_t size);
+  };
+}
@@ -1,110 +1,356 @@
 #include <iostream>
-#include <assert.h>
+#include <vector>
+#include <type_traits>
 
 #include "CSLBP.h"
+#include "../simd/SIMD.h"
 
 namespace lbplibrary
 {
-  CSLBP::CSLBP() : filterDim(3), numberOfWeights(4)
+  CSLBP::CSLBP()
   {
-    std::cout << "CSLBP()" << std::endl;
   }
 
   CSLBP::~CSLBP()
   {
-    std::cout << "~CSLBP()" << std::endl;
+  }
+
+  // both pixels of a centre-symmetric pair lie on the same side of the centre; compared
+  // rather than multiplied, so 16-bit and float pixels cannot overflow
+  template <typename _Tp>
+  static inline int CSLBP_pair(_Tp a, _Tp b, _Tp c)
+  {
+    return (a > c && b > c) || (a < c && b < c);
+  }
+
+  // bit k is set when both pixels of the k-th centre-symmetric pair lie on the same side of the centre
+  template <typename _Tp>
+  static inline unsigned char CSLBP_code(_Tp c, _Tp e, _Tp se, _Tp s, _Tp sw, _Tp w, _Tp nw, _Tp n, _Tp ne)
+  {
+    int value = 0;
+    value |= CSLBP_pair(e, w, c) << 0;
+    value |= CSLBP_pair(se, nw, c) << 1;
+    value |= CSLBP_pair(s, n, c) << 2;
+    value |= CSLBP_pair(sw, ne, c) << 3;
+    return value;
+  }
+
+  // pixels outside the image read as zero (the image used to be zero padded)
+  template <typename _Tp>
+  static inline _Tp CSLBP_px(const _Tp* row, int x, int cols)
+  {
+    return (x < 0 || x >= cols) ? _Tp(0) : row[x];
+  }
+
+  template <typename _Tp>
+  static inline unsigned char CSLBP_border(const _Tp* up, const _Tp* mid, const _Tp* down, int j, int cols)
+  {
+    return CSLBP_code(mid[j],
+      CSLBP_px(mid, j + 1, cols), CSLBP_px(down, j + 1, cols), down[j], CSLBP_px(down, j - 1, cols),
+      CSLBP_px(mid, j - 1, cols), CSLBP_px(up, j - 1, cols), up[j], CSLBP_px(up, j + 1, cols));
+  }
+
+  // interior columns [j, end), all neighbours inside the row buffers
+  template <typename _Tp>
+  static void CSLBP_row(const _Tp* up, const _Tp* mid, const _Tp* down, unsigned char* out, int j, int end)
+  {
+    for (; j < end; j++)
+      out[j] = CSLBP_code(mid[j], mid[j + 1], down[j + 1], down[j], down[j - 1], mid[j - 1], up[j - 1], up[j], up[j + 1]);
+  }
+
+#if defined(LBP_SIMD_X86)
+  // bits of one pair for 16 centres; inputs are biased by 0x80 for the signed byte compares
+  LBP_TARGET_SSE41 static inline __m128i CSLBP_pair_sse(const unsigned char* a, const unsigned char* b, __m128i center, __m128i bias, char bit)
+  {
+    __m128i va = _mm_xor_si128(_mm_loadu_si128((const __m128i*)a), bias);
+    __m128i vb = _mm_xor_si128(_mm_loadu_si128((const __m128i*)b), bias);
+    __m128i above = _mm_and_si128(_mm_cmpgt_epi8(va, center), _mm_cmpgt_epi8(vb, center));
+    __m128i below = _mm_and_si128(_mm_cmpgt_epi8(center, va), _mm_cmpgt_epi8(center, vb));
+    return _mm_and_si128(_mm_or_si128(above, below), _mm_set1_epi8(bit));
+  }
+
+  LBP_TARGET_SSE41 static int CSLBP_row_sse41(const unsigned char* up, const unsigned char* mid, const unsigned char* down, unsigned char* out, int j, int end)
+  {
+    const __m128i bias = _mm_set1_epi8((char)0x80);
+    for (; j <= end - 16; j += 16) {
+      __m128i center = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(mid + j)), bias);
+      __m128i code = CSLBP_pair_sse(mid + j + 1, mid + j - 1, center, bias, 1);
+      code = _mm_or_si128(code, CSLBP_pair_sse(down + j + 1, up + j - 1, center, bias, 2));
+      code = _mm_or_si128(code, CSLBP_pair_sse(down + j, up + j, center, bias, 4));
+      code = _mm_or_si128(code, CSLBP_pair_sse(down + j - 1, up + j + 1, center, bias, 8));
+      _mm_storeu_si128((__m128i*)(out + j), code);
+    }
+    return j;
+  }
+
+  LBP_TARGET_AVX2 static inline __m256i CSLBP_pair_avx2(const unsigned char* a, const unsigned char* b, __m256i center, __m256i bias, char bit)
+  {
+    __m256i va = _mm256_xor_si256(_mm256_loadu_si256((const __m256i*)a), bias);
+    __m256i vb = _mm256_xor_si256(_mm256_loadu_si256((const __m256i*)b), bias);
+    __m256i above = _mm256_and_si256(_mm256_cmpgt_epi8(va, center), _mm256_cmpgt_epi8(vb, center));
+    __m256i below = _mm256_and_si256(_mm256_cmpgt_epi8(center, va), _mm256_cmpgt_epi8(center, vb));
+    return _mm256_and_si256(_mm256_or_si256(above, below), _mm256_set1_epi8(bit));
+  }
+
+  LBP_TARGET_AVX2 static int CSLBP_row_avx2(const unsigned char* up, const unsigned char* mid, const unsigned char* down, unsigned char* out, int j, int end)
+  {
+    const __m256i bias = _mm256_set1_epi8((char)0x80);
+    for (; j <= end - 32; j += 32) {
+      __m256i center = _mm256_xor_si256(_mm256_loadu_si256((const __m256i*)(mid + j)), bias);
+      __m256i code = CSLBP_pair_avx2(mid + j + 1, mid + j - 1, center, bias, 1);
+      code = _mm256_or_si256(code, CSLBP_pair_avx2(down + j + 1, up + j - 1, center, bias, 2));
+      code = _mm256_or_si256(code, CSLBP_pair_avx2(down + j, up + j, center, bias, 4));
+      code = _mm256_or_si256(code, CSLBP_pair_avx2(down + j - 1, up + j + 1, center, bias, 8));
+      _mm256_storeu_si256((__m256i*)(out + j), code);
+    }
+    return CSLBP_row_sse41(up, mid, down, out, j, end);
+  }
+
+  // 16-bit pixels, 8 centres per vector; biased by 0x8000 for the signed word compares
+  LBP_TARGET_SSE41 static inline __m128i CSLBP_pair16_sse(const unsigned short* a, const unsigned short* b, __m128i center, __m128i bias, short bit)
+  {
+    __m128i va = _mm_xor_si128(_mm_loadu_si128((const __m128i*)a), bias);
+    __m128i vb = _mm_xor_si128(_mm_loadu_si128((const __m128i*)b), bias);
+    __m128i above = _mm_and_si128(_mm_cmpgt_epi16(va, center), _mm_cmpgt_epi16(vb, center));
+    __m128i below = _mm_and_si128(_mm_cmpgt_epi16(center, va), _mm_cmpgt_epi16(center, vb));
+    return _mm_and_si128(_mm_or_si128(above, below), _mm_set1_epi16(bit));
+  }
+
+  LBP_TARGET_SSE41 static int CSLBP_row_sse41(const unsigned short* up, const unsigned short* mid, const unsigned short* down, unsigned char* out, int j, int end)
+  {
+    const __m128i bias = _mm_set1_epi16((short)0x8000);
+    for (; j <= end - 8; j += 8) {
+      __m128i center = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(mid + j)), bias);
+      __m128i code = CSLBP_pair16_sse(mid + j + 1, mid + j - 1, center, bias, 1);
+      code = _mm_or_si128(code, CSLBP_pair16_sse(down + j + 1, up + j - 1, center, bias, 2));
+      code = _mm_or_si128(code, CSLBP_pair16_sse(down + j, up + j, center, bias, 4));
+      code = _mm_or_si128(code, CSLBP_pair16_sse(down + j - 1, up + j + 1, center, bias, 8));
+      _mm_storel_epi64((__m128i*)(out + j), _mm_packus_epi16(code, code));
+    }
+    return j;
+  }
+
+  // float pixels, 4 centres per vector; NaN compares false either way, as in the scalar code
+  LBP_TARGET_SSE41 static inline __m128i CSLBP_pair32f_sse(const float* a, const float* b, __m128 center, int bit)
+  {
+    __m128 va = _mm_loadu_ps(a), vb = _mm_loadu_ps(b);
+    __m128 above = _mm_and_ps(_mm_cmpgt_ps(va, center), _mm_cmpgt_ps(vb, center));
+    __m128 below = _mm_and_ps(_mm_cmplt_ps(va, center), _mm_cmplt_ps(vb, center));
+    return _mm_and_si128(_mm_castps_si128(_mm_or_ps(above, below)), _mm_set1_epi32(bit));
+  }
+
+  LBP_TARGET_SSE41 static inline __m128i CSLBP_code32f_sse(const float* up, const float* mid, const float* down, int j)
+  {
+    __m128 center = _mm_loadu_ps(mid + j);
+    __m128i code = CSLBP_pair32f_sse(mid + j + 1, mid + j - 1, center, 1);
+    code = _mm_or_si128(code, CSLBP_pair32f_sse(down + j + 1, up + j - 1, center, 2));
+    code = _mm_or_si128(code, CSLBP_pair32f_sse(down + j, up + j, center, 4));
+    return _mm_or_si128(code, CSLBP_pair32f_sse(down + j - 1, up + j + 1, center, 8));
+  }
+
+  LBP_TARGET_SSE41 static int CSLBP_row_sse41(const float* up, const float* mid, const float* down, unsigned char* out, int j, int end)
+  {
+    for (; j <= end - 8; j += 8) {
+      __m128i words = _mm_packs_epi32(CSLBP_code32f_sse(up, mid, down, j), CSLBP_code32f_sse(up, mid, down, j + 4));
+      _mm_storel_epi64((__m128i*)(out + j), _mm_packus_epi16(words, words));
+    }
+    return j;
+  }
+
+  LBP_TARGET_AVX2 static inline __m256i CSLBP_pair16_avx2(const unsigned short* a, const unsigned short* b, __m256i center, __m256i bias, short bit)
+  {
+    __m256i va = _mm256_xor_si256(_mm256_loadu_si256((const __m256i*)a), bias);
+    __m256i vb = _mm256_xor_si256(_mm256_loadu_si256((const __m256i*)b), bias);
+    __m256i above = _mm256_and_si256(_mm256_cmpgt_epi16(va, center), _mm256_cmpgt_epi16(vb, center));
+    __m256i below = _mm256_and_si256(_mm256_cmpgt_epi16(center, va), _mm256_cmpgt_epi16(center, vb));
+    return _mm256_and_si256(_mm256_or_si256(above, below), _mm256_set1_epi16(bit));
+  }
+
+  LBP_TARGET_AVX2 static int CSLBP_row_avx2(const unsigned short* up, const unsigned short* mid, const unsigned short* down, unsigned char* out, int j, int end)
+  {
+    const __m256i bias = _mm256_set1_epi16((short)0x8000);
+    for (; j <= end - 16; j += 16) {
+      __m256i center = _mm256_xor_si256(_mm256_loadu_si256((const __m256i*)(mid + j)), bias);
+      __m256i code = CSLBP_pair16_avx2(mid + j + 1, mid + j - 1, center, bias, 1);
+      code = _mm256_or_si256(code, CSLBP_pair16_avx2(down + j + 1, up + j - 1, center, bias, 2));
+      code = _mm256_or_si256(code, CSLBP_pair16_avx2(down + j, up + j, center, bias, 4));
+      code = _mm256_or_si256(code, CSLBP_pair16_avx2(down + j - 1, up + j + 1, center, bias, 8));
+      __m128i bytes = _mm_packus_epi16(_mm256_castsi256_si128(code), _mm256_extracti128_si256(code, 1));
+      _mm_storeu_si128((__m128i*)(out + j), bytes);
+    }
+    return CSLBP_row_sse41(up, mid, down, out, j, end);
+  }
+
+  LBP_TARGET_AVX2 static inline __m256i CSLBP_pair32f_avx2(const float* a, const float* b, __m256 center, int bit)
+  {
+    __m256 va = _mm256_loadu_ps(a), vb = _mm256_loadu_ps(b);
+    __m256 above = _mm256_and_ps(_mm256_cmp_ps(va, center, _CMP_GT_OQ), _mm256_cmp_ps(vb, center, _CMP_GT_OQ));
+    __m256 below = _mm256_and_ps(_mm256_cmp_ps(va, center, _CMP_LT_OQ), _mm256_cmp_ps(vb, center, _CMP_LT_OQ));
+    return _mm256_and_si256(_mm256_castps_si256(_mm256_or_ps(above, below)), _mm256_set1_epi32(bit));
+  }
+
+  LBP_TARGET_AVX2 static int CSLBP_row_avx2(const float* up, const float* mid, const float* down, unsigned char* out, int j, int end)
+  {
+    for (; j <= end - 8; j += 8) {
+      __m256 center = _mm256_loadu_ps(mid + j);
+      __m256i code = CSLBP_pair32f_avx2(mid + j + 1, mid + j - 1, center, 1);
+      code = _mm256_or_si256(code, CSLBP_pair32f_avx2(down + j + 1, up + j - 1, center, 2));
+      code = _mm256_or_si256(code, CSLBP_pair32f_avx2(down + j, up + j, center, 4));
+      code = _mm256_or_si256(code, CSLBP_pair32f_avx2(down + j - 1, up + j + 1, center, 8));
+      __m128i words = _mm_packs_epi32(_mm256_castsi256_si128(code), _mm256_extracti128_si256(code, 1));
+      _mm_storel_epi64((__m128i*)(out + j), _mm_packus_epi16(words, words));
+    }
+    return CSLBP_row_sse41(up, mid, down, out, j, end);
+  }
+#elif defined(LBP_SIMD_NEON)
+  static inline uint8x16_t CSLBP_pair_neon(const unsigned char* a, const unsigned char* b, uint8x16_t center, unsigned char bit)
+  {
+    uint8x16_t va = vld1q_u8(a);
+    uint8x16_t vb = vld1q_u8(b);
+    uint8x16_t above = vandq_u8(vcgtq_u8(va, center), vcgtq_u8(vb, center));
+    uint8x16_t below = vandq_u8(vcltq_u8(va, center), vcltq_u8(vb, center));
+    return vandq_u8(vorrq_u8(above, below), vdupq_n_u8(bit));
+  }
+
+  static int CSLBP_row_neon(const unsigned char* up, const unsigned char* mid, const unsigned char* down, unsigned char* out, int j, int end)
+  {
+    for (; j <= end - 16; j += 16) {
+      uint8x16_t center = vld1q_u8(mid + j);
+      uint8x16_t code = CSLBP_pair_neon(mid + j + 1, mid + j - 1, center, 1);
+      code = vorrq_u8(code, CSLBP_pair_neon(down + j + 1, up + j - 1, center, 2));
+      code = vorrq_u8(code, CSLBP_pair_neon(down + j, up + j, center, 4));
+      code = vorrq_u8(code, CSLBP_pair_neon(down + j - 1, up + j + 1, center, 8));
+      vst1q_u8(out + j, code);
+    }
+    return j;
+  }
+  static inline uint16x8_t CSLBP_pair16_neon(const unsigned short* a, const unsigned short* b, uint16x8_t center, unsigned short bit)
+  {
+    uint16x8_t va = vld1q_u16(a);
+    uint16x8_t vb = vld1q_u16(b);
+    uint16x8_t above = vandq_u16(vcgtq_u16(va, center), vcgtq_u16(vb, center));
+    uint16x8_t below = vandq_u16(vcltq_u16(va, center), vcltq_u16(vb, center));
+    return vandq_u16(vorrq_u16(above, below), vdupq_n_u16(bit));
+  }
+
+  static int CSLBP_row_neon(const unsigned short* up, const unsigned short* mid, const unsigned short* down, unsigned char* out, int j, int end)
+  {
+    for (; j <= end - 8; j += 8) {
+      uint16x8_t center = vld1q_u16(mid + j);
+      uint16x8_t code = CSLBP_pair16_neon(mid + j + 1, mid + j - 1, center, 1);
+      code = vorrq_u16(code, CSLBP_pair16_neon(down + j + 1, up + j - 1, center, 2));
+      code = vorrq_u16(code, CSLBP_pair16_neon(down + j, up + j, center, 4));
+      code = vorrq_u16(code, CSLBP_pair16_neon(down + j - 1, up + j + 1, center, 8));
+      vst1_u8(out + j, vmovn_u16(code));
+    }
+    return j;
+  }
+
+  static inline uint32x4_t CSLBP_pair32f_neon(const float* a, const float* b, float32x4_t center, unsigned int bit)
+  {
+    float32x4_t va = vld1q_f32(a);
+    float32x4_t vb = vld1q_f32(b);
+    uint32x4_t above = vandq_u32(vcgtq_f32(va, center), vcgtq_f32(vb, center));
+    uint32x4_t below = vandq_u32(vcltq_f32(va, center), vcltq_f32(vb, center));
+    return vandq_u32(vorrq_u32(above, below), vdupq_n_u32(bit));
+  }
+
+  static inline uint16x4_t CSLBP_code32f_neon(const float* up, const float* mid, const float* down, int j)
+  {
+    float32x4_t center = vld1q_f32(mid + j);
+    uint32x4_t code = CSLBP_pair32f_neon(mid + j + 1, mid + j - 1, center, 1);
+    code = vorrq_u32(code, CSLBP_pair32f_neon(down + j + 1, up + j - 1, center, 2));
+    code = vorrq_u32(code, CSLBP_pair32f_neon(down + j, up + j, center, 4));
+    code = vorrq_u32(code, CSLBP_pair32f_neon(down + j - 1, up + j + 1, center, 8));
+    return vmovn_u32(code);
+  }
+
+  static int CSLBP_row_neon(const float* up, const float* mid, const float* down, unsigned char* out, int j, int end)
+  {
+    for (; j <= end - 8; j += 8)
+      vst1_u8(out + j, vmovn_u16(vcombine_u16(CSLBP_code32f_neon(up, mid, down, j), CSLBP_code32f_neon(up, mid, down, j + 4))));
+    return j;
+  }
+#endif
+
+  // pixel types with vector code
+  template <typename _Tp> struct CSLBP_vector : std::false_type {};
+  template <> struct CSLBP_vector<unsigned char> : std::true_type {};
+  template <> struct CSLBP_vector<unsigned short> : std::true_type {};
+  template <> struct CSLBP_vector<float> : std::true_type {};
+
+  // vector code of the interior columns from j on; returns the first column left to the scalar loop
+  template <typename _Tp>
+  static int CSLBP_row_simd(SimdLevel level, const _Tp* up, const _Tp* mid, const _Tp* down, unsigned char* out, int j, int end, std::true_type)
+  {
+#if defined(LBP_SIMD_X86)
+    if (level == SIMD_256)
+      return CSLBP_row_avx2(up, mid, down, out, j, end);
+    if (level == SIMD_128)
+      return CSLBP_row_sse41(up, mid, down, out, j, end);
+#elif defined(LBP_SIMD_NEON)
+    if (level != SIMD_SCALAR)
+      return CSLBP_row_neon(up, mid, down, out, j, end);
+#endif
+    return j;
+  }
+
+  template <typename _Tp>
+  static int CSLBP_row_simd(SimdLevel level, const _Tp* up, const _Tp* mid, const _Tp* down, unsigned char* out, int j, int end, std::false_type)
+  {
+    return j;
+  }
+
+  // the pixels are read in place whatever their type; codes are 8-bit
+  template <typename _Tp>
+  void CSLBP::CSLBP_(const cv::Mat& gray, cv::Mat& dst, LBPContext& context)
+  {
+    const int rows = gray.rows;
+    const int cols = gray.cols;
+    const SimdLevel level = simdLevel();
+
+    // stands in for the zero padding above the first and below the last row
+    _Tp* zeros = context.buffer<_Tp>(1, cols);
+    std::fill(zeros, zeros + cols, _Tp(0));
+
+    dst.create(rows, cols, CV_8UC1);
+    for (int i = 0; i < rows; i++)
+    {
+      const _Tp* up = i > 0 ? gray.ptr<_Tp>(i - 1) : zeros;
+      const _Tp* mid = gray.ptr<_Tp>(i);
+      const _Tp* down = i < rows - 1 ? gray.ptr<_Tp>(i + 1) : zeros;
+      unsigned char* out = dst.ptr<unsigned char>(i);
+
+      out[0] = CSLBP_border(up, mid, down, 0, cols);
+      int j = CSLBP_row_simd(level, up, mid, down, out, 1, cols - 1, CSLBP_vector<_Tp>());
+      CSLBP_row(up, mid, down, out, j, cols - 1);
+      if (cols > 1)
+        out[cols - 1] = CSLBP_border(up, mid, down, cols - 1, cols);
+    }
   }
 
   void CSLBP::run(const cv::Mat &input, cv::Mat &CSLBP)
+  {
+    CSLBP::run(input, CSLBP, context);
+  }
+
+  void CSLBP::run(const cv::Mat &input, cv::Mat &CSLBP, LBPContext &context)
   {
     if (input.empty())
       return;
 
-    const int weights = numberOfWeights;
-    //int rows = input.size().height;
-    //int cols = input.size().width;
-    int channels = input.channels();
-
     // convert input image to grayscale
-    cv::Mat gray;
-    if (channels > 1)
-      cv::cvtColor(input, gray, cv::COLOR_BGR2GRAY);
-    else
-      gray = input.clone();
-
-    // create filter
-    //CvMat* filter = cvCreateMat(filterDim, filterDim, CV_8UC1);
-
-    // verify filter dimensions are odd, so a middle element always exists
-    assert(filterDim == (filterDim + 1 - filterDim % 2));
-
-    //int nNeighbours = filterDim * filterDim - 1;
-    //int nWeights = numberOfWeights;
-
-    int filterRadius[2] = { static_cast<int>(floor(filterDim / 2.)), static_cast<int>(floor(filterDim / 2.)) };
-
-    // padd image with zeroes to deal with the edges
-    cv::Mat paddedImage = gray;
-    cv::copyMakeBorder(gray, paddedImage, filterRadius[0], filterRadius[0], filterRadius[0], filterRadius[0], cv::BORDER_CONSTANT, 0x00);
-
-    // compute weights
-    unsigned char* P = new unsigned char[weights];
-    unsigned char* S = new unsigned char[numberOfWeights];
-    float* weightVec = new float[numberOfWeights];
-    for (int i = 0; i < numberOfWeights; i++)
-      weightVec[i] = pow(2., i);
-
-    // create output image and set its elements on zero
-    /*cv::Mat*/ CSLBP = cv::Mat(gray.rows, gray.cols, CV_8UC1);
-    memset(CSLBP.data, 0x00, CSLBP.cols * CSLBP.rows);
-
-    cv::Mat subImg;
-    cv::Rect roi;
-    int* central = new int[numberOfWeights];
-    int* neighborhood = new int[numberOfWeights];
-    int* neighborhood1 = new int[numberOfWeights];
-    int* diffVec = new int[numberOfWeights];
-
-    // process image
-    for (int i = 0; i < (paddedImage.rows - filterRadius[0] - 1); i++)
+    cv::Mat gray = context.gray(input, CSLBP);
+
+    switch (gray.type())
     {
-      for (int j = 0; j < (paddedImage.cols - filterRadius[0] - 1); j++)
-      {
-        roi = cv::Rect(j, i, filterDim, filterDim);
-        paddedImage(roi).copyTo(subImg);
-
-        // neighborhood N0 to N3
-        P[0] = subImg.data[2 + subImg.cols * 1];
-        P[1] = subImg.data[2 + subImg.cols * 2];
-        P[2] = subImg.data[1 + subImg.cols * 2];
-        P[3] = subImg.data[0 + subImg.cols * 2];
-
-        // neighborhood N4 to N7
-        S[0] = subImg.data[0 + subImg.cols * 1];
-        S[1] = subImg.data[0 + subImg.cols * 0];
-        S[2] = subImg.data[1 + subImg.cols * 0];
-        S[3] = subImg.data[2 + subImg.cols * 0];
-
-        // value of the center pixel
-        central[0] = central[1] = central[2] = central[3] = subImg.data[1 + subImg.cols * 1];
-
-        //neighborhood subtraction
-        for (int k = 0; k < numberOfWeights; k++)
-        {
-          neighborhood[k] = P[k] - central[k];
-          neighborhood1[k] = S[k] - central[k];
-          diffVec[k] = neighborhood[k] * neighborhood1[k];
-        }
-
-        // save output value
-        int value = 0;
-        for (int k = 0; k < numberOfWeights; k++)
-        {
-          int v = (diffVec[k] > 0.01) ? 1 : 0;
-          value += weightVec[k] * v;
-        }
-        CSLBP.data[j + CSLBP.cols * i] = value;
-      }
+      case CV_8SC1: CSLBP_<char>(gray, CSLBP, context); break;
+      case CV_8UC1: CSLBP_<unsigned char>(gray, CSLBP, context); break;
+      case CV_16SC1: CSLBP_<short>(gray, CSLBP, context); break;
+      case CV_16UC1: CSLBP_<unsigned short>(gray, CSLBP, context); break;
+      case CV_32SC1: CSLBP_<int>(gray, CSLBP, context); break;
+      case CV_32FC1: CSLBP_<float>(gray, CSLBP, context); break;
+      case CV_64FC1: CSLBP_<double>(gray, CSLBP, context); break;
     }
   }
 }
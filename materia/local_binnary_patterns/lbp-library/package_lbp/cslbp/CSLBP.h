@@ -8,13 +8,18 @@ namespace lbplibrary
   class CSLBP : public LBP
   {
   private:
-    int filterDim;
-    int numberOfWeights;
+    template <typename _Tp>
+    void CSLBP_(const cv::Mat& gray, cv::Mat& dst, LBPContext& context);
 
   public:
     CSLBP();
     ~CSLBP();
 
+    using LBP::run;
     void run(const cv::Mat &img_input, cv::Mat &img_output);
+    void run(const cv::Mat &img_input, cv::Mat &img_output, LBPContext &context);
+
+    int halo() const { return 1; }
+    LBPBorder border() const { return LBP_BORDER_ZERO; }
   };
 }
@@ -8,116 +8,101 @@ namespace lbplibrary
 {
   CSLDP::CSLDP() : bilinearInterpolation(0), fxRadius(1), fyRadius(1), borderLength(1)
   {
-    std::cout << "CSLDP()" << std::endl;
   }
 
   CSLDP::~CSLDP()
   {
-    std::cout << "~CSLBP()" << std::endl;
   }
 
-  void processCSLDP(cv::Mat &gray, cv::Mat &out, int fxRadius, int fyRadius, const int neighborPoints[3], int borderLength, int bilinearInterpolation)
+  // bit set when the pair across the centre does not lie on one side of it, i.e. when the product
+  // of their differences to the centre is not positive; compared rather than multiplied so that
+  // no pixel type overflows
+  template <typename _Tp>
+  static inline bool CSLDP_straddles(_Tp p1, _Tp p, _Tp c)
+  {
+    return !((p1 > c && p > c) || (p1 < c && p < c));
+  }
+
+  template <typename _Tp>
+  void processCSLDP(const cv::Mat &gray, cv::Mat &out, int fxRadius, int fyRadius, const int neighborPoints[3], int borderLength, int bilinearInterpolation)
   {
     int height = gray.size().height;
     int width = gray.size().width;
 
     int xyNeighborPoints = neighborPoints[0];
-    double nDim = pow(2.0, xyNeighborPoints / 2.0);
-    cv::Mat histogram(1, nDim, CV_8UC1);
-
-    int p1XY, pXY;
 
     if (bilinearInterpolation == 0)
     {
+      // the sampling circle is the same for every pixel
+      int dx[8], dy[8];
+      for (int k = 0; k < xyNeighborPoints; k++)
+      {
+        dx[k] = (int)floor((double)fxRadius * cos((2 * M_PI * k) / xyNeighborPoints) + 0.5);
+        dy[k] = (int)floor(-(double)fyRadius * sin((2 * M_PI * k) / xyNeighborPoints) + 0.5);
+      }
+
+      // pairs across the centre, one bit each
+      static const int pairs[4][2] = { { 0, 4 }, { 7, 3 }, { 6, 2 }, { 5, 1 } };
+
       for (int yc = borderLength; yc < (height - borderLength); yc++)
       {
+        const _Tp* row[8];
+        for (int k = 0; k < xyNeighborPoints; k++)
+          row[k] = gray.ptr<_Tp>(yc + dy[k]) + dx[k];
+        const _Tp* center = gray.ptr<_Tp>(yc);
+        unsigned char* dst = out.ptr<unsigned char>(yc);
+
         for (int xc = borderLength; xc < (width - borderLength); xc++)
         {
           // obtain center value
-          int centerVal = gray.data[xc + yc * gray.cols];
+          _Tp centerVal = center[xc];
 
           // XY plane
           int basicLBP = 0;
-          int featureBin = 0;
-          int countXY = 0;
-          int vXYNeighbor[8];
-
-          // store the neighbors in a vector
-          for (int k = 0; k < xyNeighborPoints; k++)
-          {
-            float x = floor((double)xc + (double)fxRadius * cos((2 * M_PI * k) / xyNeighborPoints) + 0.5);
-            float y = floor((double)yc - (double)fyRadius * sin((2 * M_PI * k) / xyNeighborPoints) + 0.5);
-
-            vXYNeighbor[k] = gray.data[(int)x + (int)y * gray.cols];
-            countXY++;
-          }
-
-          // loop to calculate CS-LDP
           for (int kXY = 0; kXY < 4; kXY++)
-          {
-            if (kXY == 0)
-            {
-              p1XY = vXYNeighbor[0] - centerVal;
-              pXY = vXYNeighbor[4] - centerVal;
-            }
-
-            if (kXY == 1)
-            {
-              p1XY = vXYNeighbor[7] - centerVal;
-              pXY = vXYNeighbor[3] - centerVal;
-            }
-
-            if (kXY == 2)
-            {
-              p1XY = vXYNeighbor[6] - centerVal;
-              pXY = vXYNeighbor[2] - centerVal;
-            }
-
-            if (kXY == 3)
-            {
-              p1XY = vXYNeighbor[5] - centerVal;
-              pXY = vXYNeighbor[1] - centerVal;
-            }
-
-            int currentVal = (p1XY*pXY);
-
-            if (currentVal <= 0)
-              basicLBP += pow(2.0, featureBin);
-
-            featureBin++;
-          }
+            if (CSLDP_straddles(row[pairs[kXY][0]][xc], row[pairs[kXY][1]][xc], centerVal))
+              basicLBP |= 1 << kXY;
+
           // save pixel in output
-          out.data[xc + yc * gray.cols] = basicLBP;
-          histogram.data[basicLBP] += 1;
+          dst[xc] = (unsigned char)basicLBP;
         }
       }
     }
   }
 
   void CSLDP::run(const cv::Mat &input, cv::Mat &CSLDP)
+  {
+    CSLDP::run(input, CSLDP, context);
+  }
+
+  void CSLDP::run(const cv::Mat &input, cv::Mat &CSLDP, LBPContext &context)
   {
     if (input.empty())
       return;
 
     int height = input.size().height;
     int width = input.size().width;
-    int channels = input.channels();
 
     // convert input image to grayscale
-    cv::Mat gray;
-    if (channels > 1)
-      cv::cvtColor(input, gray, cv::COLOR_BGR2GRAY);
-    else
-      gray = input.clone();
+    cv::Mat gray = context.gray(input, CSLDP);
 
     int neighborPoints[3] = { 8, 8, 8 };
     //int xyNeighborPoints = neighborPoints[0];
 
     // create output background model
-    /*cv::Mat*/ CSLDP = cv::Mat(height, width, CV_8UC1, cv::Scalar(0));
-    memset(CSLDP.data, 0x00, CSLDP.cols * CSLDP.rows);
+    CSLDP.create(height, width, CV_8UC1);
+    CSLDP.setTo(cv::Scalar(0));
 
     // compute CSLDP
-    processCSLDP(gray, CSLDP, fxRadius, fyRadius, neighborPoints, borderLength, bilinearInterpolation);
+    switch (gray.type())
+    {
+      case CV_8SC1: processCSLDP<char>(gray, CSLDP, fxRadius, fyRadius, neighborPoints, borderLength, bilinearInterpolation); break;
+      case CV_8UC1: processCSLDP<unsigned char>(gray, CSLDP, fxRadius, fyRadius, neighborPoints, borderLength, bilinearInterpolation); break;
+      case CV_16SC1: processCSLDP<short>(gray, CSLDP, fxRadius, fyRadius, neighborPoints, borderLength, bilinearInterpolation); break;
+      case CV_16UC1: processCSLDP<unsigned short>(gray, CSLDP, fxRadius, fyRadius, neighborPoints, borderLength, bilinearInterpolation); break;
+      case CV_32SC1: processCSLDP<int>(gray, CSLDP, fxRadius, fyRadius, neighborPoints, borderLength, bilinearInterpolation); break;
+      case CV_32FC1: processCSLDP<float>(gray, CSLDP, fxRadius, fyRadius, neighborPoints, borderLength, bilinearInterpolation); break;
+      case CV_64FC1: processCSLDP<double>(gray, CSLDP, fxRadius, fyRadius, neighborPoints, borderLength, bilinearInterpolation); break;
+    }
   }
 }
@@ -17,6 +17,11 @@ namespace lbplibrary
     CSLDP();
     ~CSLDP();
 
+    using LBP::run;
     void run(const cv::Mat &img_input, cv::Mat &img_output);
+    void run(const cv::Mat &img_input, cv::Mat &img_output, LBPContext &context);
+
+    int halo() const { return std::max(fyRadius, borderLength); }
+    LBPBorder border() const { return LBP_BORDER_SKIP; }
   };
 }
@@ -1,137 +1,274 @@
 #include <iostream>
-#include <assert.h>
+#include <vector>
+#include <algorithm>
 
 #include "CSSILTP.h"
+#include "../simd/SIMD.h"
 
 namespace lbplibrary
 {
-  CSSILTP::CSSILTP() : filterDim(3), numberOfWeights(4), tau(0.03)
+  CSSILTP::CSSILTP() : tau(0.03)
   {
-    std::cout << "CSSILTP()" << std::endl;
   }
 
   CSSILTP::~CSSILTP()
   {
-    std::cout << "~CSSILTP()" << std::endl;
+  }
+
+  // ternary digit of one centre-symmetric pair: 3 (code 10) below the lower limit, 1 (code 01) above the upper one.
+  // _Wt holds the pair product: int for 8-bit pixels, double for the wider types
+  template <typename _Wt>
+  static inline int CSSILTP_digit(_Wt a, _Wt b, _Wt c, _Wt lower, _Wt upper)
+  {
+    _Wt diff = (a - c) * (b - c);
+    return diff < lower ? 3 : (diff > upper ? 1 : 0);
+  }
+
+  // lower and upper limits of a centre, (1 -/+ tau) * centre rounded back to the pixel type
+  template <typename _Tp>
+  struct CSSILTP_limits
+  {
+    float lowScale, upScale;
+    CSSILTP_limits(float tau) : lowScale(1 - tau), upScale(1 + tau) {}
+    _Tp lower(_Tp c) const { return cv::saturate_cast<_Tp>(lowScale * c); }
+    _Tp upper(_Tp c) const { return cv::saturate_cast<_Tp>(upScale * c); }
+  };
+
+  // 8-bit centres look their limits up
+  template <>
+  struct CSSILTP_limits<unsigned char>
+  {
+    unsigned char lowers[256], uppers[256];
+    CSSILTP_limits(float tau)
+    {
+      for (int c = 0; c < 256; c++) {
+        lowers[c] = cv::saturate_cast<unsigned char>((1 - tau) * c);
+        uppers[c] = cv::saturate_cast<unsigned char>((1 + tau) * c);
+      }
+    }
+    unsigned char lower(unsigned char c) const { return lowers[c]; }
+    unsigned char upper(unsigned char c) const { return uppers[c]; }
+  };
+
+  template <typename _Tp, typename _Wt>
+  static inline unsigned char CSSILTP_code(_Tp c, _Tp e, _Tp se, _Tp s, _Tp sw, _Tp w, _Tp nw, _Tp n, _Tp ne, const CSSILTP_limits<_Tp>& limits)
+  {
+    _Wt l = limits.lower(c), u = limits.upper(c);
+    return CSSILTP_digit<_Wt>(e, w, c, l, u) + 3 * CSSILTP_digit<_Wt>(se, nw, c, l, u)
+      + 9 * CSSILTP_digit<_Wt>(s, n, c, l, u) + 27 * CSSILTP_digit<_Wt>(sw, ne, c, l, u);
+  }
+
+  // pixels outside the image read as zero (the image used to be zero padded)
+  template <typename _Tp>
+  static inline _Tp CSSILTP_px(const _Tp* row, int x, int cols)
+  {
+    return (x < 0 || x >= cols) ? _Tp(0) : row[x];
+  }
+
+  template <typename _Tp, typename _Wt>
+  static inline unsigned char CSSILTP_border(const _Tp* up, const _Tp* mid, const _Tp* down, int j, int cols, const CSSILTP_limits<_Tp>& limits)
+  {
+    return CSSILTP_code<_Tp, _Wt>(mid[j],
+      CSSILTP_px(mid, j + 1, cols), CSSILTP_px(down, j + 1, cols), down[j], CSSILTP_px(down, j - 1, cols),
+      CSSILTP_px(mid, j - 1, cols), CSSILTP_px(up, j - 1, cols), up[j], CSSILTP_px(up, j + 1, cols), limits);
+  }
+
+  // interior columns [j, end), all neighbours inside the row buffers
+  template <typename _Tp, typename _Wt>
+  static void CSSILTP_row(const _Tp* up, const _Tp* mid, const _Tp* down, unsigned char* out, int j, int end, const CSSILTP_limits<_Tp>& limits)
+  {
+    for (; j < end; j++)
+      out[j] = CSSILTP_code<_Tp, _Wt>(mid[j], mid[j + 1], down[j + 1], down[j], down[j - 1], mid[j - 1], up[j - 1], up[j], up[j + 1], limits);
+  }
+
+#if defined(LBP_SIMD_X86)
+  // the pair products need 32 bits, so 16 centres are handled as four groups of 4 int32 lanes
+  LBP_TARGET_SSE41 static inline __m128i CSSILTP_digit_sse(const unsigned char* a, const unsigned char* b, __m128i c, __m128i lower, __m128i upper, int weight)
+  {
+    __m128i va = _mm_cvtepu8_epi32(_mm_cvtsi32_si128(*(const int*)a));
+    __m128i vb = _mm_cvtepu8_epi32(_mm_cvtsi32_si128(*(const int*)b));
+    __m128i diff = _mm_mullo_epi32(_mm_sub_epi32(va, c), _mm_sub_epi32(vb, c));
+    __m128i below = _mm_and_si128(_mm_cmpgt_epi32(lower, diff), _mm_set1_epi32(3 * weight));
+    __m128i above = _mm_and_si128(_mm_cmpgt_epi32(diff, upper), _mm_set1_epi32(weight));
+    return _mm_or_si128(below, above);
+  }
+
+  LBP_TARGET_SSE41 static inline __m128i CSSILTP_code4_sse(const unsigned char* up, const unsigned char* mid, const unsigned char* down, int j, __m128 lowScale, __m128 upScale)
+  {
+    __m128i c = _mm_cvtepu8_epi32(_mm_cvtsi32_si128(*(const int*)(mid + j)));
+    // same rounding as converting (1 -/+ tau) * centre back to 8 bits
+    __m128 cf = _mm_cvtepi32_ps(c);
+    __m128i lower = _mm_min_epi32(_mm_cvtps_epi32(_mm_mul_ps(cf, lowScale)), _mm_set1_epi32(255));
+    __m128i upper = _mm_min_epi32(_mm_cvtps_epi32(_mm_mul_ps(cf, upScale)), _mm_set1_epi32(255));
+    __m128i code = CSSILTP_digit_sse(mid + j + 1, mid + j - 1, c, lower, upper, 1);
+    code = _mm_add_epi32(code, CSSILTP_digit_sse(down + j + 1, up + j - 1, c, lower, upper, 3));
+    code = _mm_add_epi32(code, CSSILTP_digit_sse(down + j, up + j, c, lower, upper, 9));
+    code = _mm_add_epi32(code, CSSILTP_digit_sse(down + j - 1, up + j + 1, c, lower, upper, 27));
+    return code;
+  }
+
+  LBP_TARGET_SSE41 static int CSSILTP_row_sse41(const unsigned char* up, const unsigned char* mid, const unsigned char* down, unsigned char* out, int j, int end, float tau)
+  {
+    const __m128 lowScale = _mm_set1_ps(1 - tau);
+    const __m128 upScale = _mm_set1_ps(1 + tau);
+    for (; j <= end - 16; j += 16) {
+      __m128i c0 = CSSILTP_code4_sse(up, mid, down, j, lowScale, upScale);
+      __m128i c1 = CSSILTP_code4_sse(up, mid, down, j + 4, lowScale, upScale);
+      __m128i c2 = CSSILTP_code4_sse(up, mid, down, j + 8, lowScale, upScale);
+      __m128i c3 = CSSILTP_code4_sse(up, mid, down, j + 12, lowScale, upScale);
+      __m128i code = _mm_packus_epi16(_mm_packs_epi32(c0, c1), _mm_packs_epi32(c2, c3));
+      _mm_storeu_si128((__m128i*)(out + j), code);
+    }
+    return j;
+  }
+
+  LBP_TARGET_AVX2 static inline __m256i CSSILTP_digit_avx2(const unsigned char* a, const unsigned char* b, __m256i c, __m256i lower, __m256i upper, int weight)
+  {
+    __m256i va = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)a));
+    __m256i vb = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)b));
+    __m256i diff = _mm256_mullo_epi32(_mm256_sub_epi32(va, c), _mm256_sub_epi32(vb, c));
+    __m256i below = _mm256_and_si256(_mm256_cmpgt_epi32(lower, diff), _mm256_set1_epi32(3 * weight));
+    __m256i above = _mm256_and_si256(_mm256_cmpgt_epi32(diff, upper), _mm256_set1_epi32(weight));
+    return _mm256_or_si256(below, above);
+  }
+
+  LBP_TARGET_AVX2 static inline __m256i CSSILTP_code8_avx2(const unsigned char* up, const unsigned char* mid, const unsigned char* down, int j, __m256 lowScale, __m256 upScale)
+  {
+    __m256i c = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(mid + j)));
+    __m256 cf = _mm256_cvtepi32_ps(c);
+    __m256i lower = _mm256_min_epi32(_mm256_cvtps_epi32(_mm256_mul_ps(cf, lowScale)), _mm256_set1_epi32(255));
+    __m256i upper = _mm256_min_epi32(_mm256_cvtps_epi32(_mm256_mul_ps(cf, upScale)), _mm256_set1_epi32(255));
+    __m256i code = CSSILTP_digit_avx2(mid + j + 1, mid + j - 1, c, lower, upper, 1);
+    code = _mm256_add_epi32(code, CSSILTP_digit_avx2(down + j + 1, up + j - 1, c, lower, upper, 3));
+    code = _mm256_add_epi32(code, CSSILTP_digit_avx2(down + j, up + j, c, lower, upper, 9));
+    code = _mm256_add_epi32(code, CSSILTP_digit_avx2(down + j - 1, up + j + 1, c, lower, upper, 27));
+    return code;
+  }
+
+  LBP_TARGET_AVX2 static int CSSILTP_row_avx2(const unsigned char* up, const unsigned char* mid, const unsigned char* down, unsigned char* out, int j, int end, float tau)
+  {
+    const __m256 lowScale = _mm256_set1_ps(1 - tau);
+    const __m256 upScale = _mm256_set1_ps(1 + tau);
+    for (; j <= end - 16; j += 16) {
+      __m256i c0 = CSSILTP_code8_avx2(up, mid, down, j, lowScale, upScale);
+      __m256i c1 = CSSILTP_code8_avx2(up, mid, down, j + 8, lowScale, upScale);
+      // packs works per 128-bit lane, the permute restores the column order
+      __m256i words = _mm256_permute4x64_epi64(_mm256_packs_epi32(c0, c1), 0xD8);
+      __m128i code = _mm_packus_epi16(_mm256_castsi256_si128(words), _mm256_extracti128_si256(words, 1));
+      _mm_storeu_si128((__m128i*)(out + j), code);
+    }
+    return j;
+  }
+#elif defined(LBP_SIMD_NEON)
+  static inline int32x4_t CSSILTP_digit_neon(uint8x8_t a, uint8x8_t b, int32x4_t c, int32x4_t lower, int32x4_t upper, int weight, bool high)
+  {
+    uint16x8_t a16 = vmovl_u8(a), b16 = vmovl_u8(b);
+    int32x4_t va = vreinterpretq_s32_u32(vmovl_u16(high ? vget_high_u16(a16) : vget_low_u16(a16)));
+    int32x4_t vb = vreinterpretq_s32_u32(vmovl_u16(high ? vget_high_u16(b16) : vget_low_u16(b16)));
+    int32x4_t diff = vmulq_s32(vsubq_s32(va, c), vsubq_s32(vb, c));
+    int32x4_t below = vandq_s32(vreinterpretq_s32_u32(vcltq_s32(diff, lower)), vdupq_n_s32(3 * weight));
+    int32x4_t above = vandq_s32(vreinterpretq_s32_u32(vcgtq_s32(diff, upper)), vdupq_n_s32(weight));
+    return vorrq_s32(below, above);
+  }
+
+  static inline int32x4_t CSSILTP_code4_neon(const unsigned char* up, const unsigned char* mid, const unsigned char* down, int j, float tau, bool high)
+  {
+    uint16x8_t c16 = vmovl_u8(vld1_u8(mid + j));
+    int32x4_t c = vreinterpretq_s32_u32(vmovl_u16(high ? vget_high_u16(c16) : vget_low_u16(c16)));
+    float32x4_t cf = vcvtq_f32_s32(c);
+    int32x4_t lower = vminq_s32(vcvtnq_s32_f32(vmulq_n_f32(cf, 1 - tau)), vdupq_n_s32(255));
+    int32x4_t upper = vminq_s32(vcvtnq_s32_f32(vmulq_n_f32(cf, 1 + tau)), vdupq_n_s32(255));
+    int32x4_t code = CSSILTP_digit_neon(vld1_u8(mid + j + 1), vld1_u8(mid + j - 1), c, lower, upper, 1, high);
+    code = vaddq_s32(code, CSSILTP_digit_neon(vld1_u8(down + j + 1), vld1_u8(up + j - 1), c, lower, upper, 3, high));
+    code = vaddq_s32(code, CSSILTP_digit_neon(vld1_u8(down + j), vld1_u8(up + j), c, lower, upper, 9, high));
+    code = vaddq_s32(code, CSSILTP_digit_neon(vld1_u8(down + j - 1), vld1_u8(up + j + 1), c, lower, upper, 27, high));
+    return code;
+  }
+
+  static int CSSILTP_row_neon(const unsigned char* up, const unsigned char* mid, const unsigned char* down, unsigned char* out, int j, int end, float tau)
+  {
+    for (; j <= end - 8; j += 8) {
+      int32x4_t lo = CSSILTP_code4_neon(up, mid, down, j, tau, false);
+      int32x4_t hi = CSSILTP_code4_neon(up, mid, down, j, tau, true);
+      vst1_u8(out + j, vqmovun_s16(vcombine_s16(vqmovn_s32(lo), vqmovn_s32(hi))));
+    }
+    return j;
+  }
+#endif
+
+  // vector code of the interior columns [j, end); returns the first column left to the scalar
+  // loop. Only 8-bit pixels have vector code: the pair products of 16-bit pixels overflow
+  // 32-bit lanes, and float lanes would round them differently from the scalar loop
+  static int CSSILTP_row_simd(SimdLevel level, const unsigned char* up, const unsigned char* mid, const unsigned char* down, unsigned char* out, int j, int end, float tau)
+  {
+#if defined(LBP_SIMD_X86)
+    if (level == SIMD_256)
+      return CSSILTP_row_avx2(up, mid, down, out, j, end, tau);
+    if (level == SIMD_128)
+      return CSSILTP_row_sse41(up, mid, down, out, j, end, tau);
+#elif defined(LBP_SIMD_NEON)
+    if (level != SIMD_SCALAR)
+      return CSSILTP_row_neon(up, mid, down, out, j, end, tau);
+#endif
+    return j;
+  }
+
+  template <typename _Tp>
+  static int CSSILTP_row_simd(SimdLevel level, const _Tp* up, const _Tp* mid, const _Tp* down, unsigned char* out, int j, int end, float tau)
+  {
+    return j;
+  }
+
+  template <typename _Tp, typename _Wt>
+  void CSSILTP::CSSILTP_(const cv::Mat& gray, cv::Mat& dst, LBPContext& context)
+  {
+    const int rows = gray.rows;
+    const int cols = gray.cols;
+    const SimdLevel level = simdLevel();
+    const CSSILTP_limits<_Tp> limits(tau);
+
+    // stands in for the zero padding above the first and below the last row
+    _Tp* zeros = context.buffer<_Tp>(1, cols);
+    std::fill(zeros, zeros + cols, _Tp(0));
+
+    dst.create(rows, cols, CV_8UC1);
+    for (int i = 0; i < rows; i++)
+    {
+      const _Tp* up = i > 0 ? gray.ptr<_Tp>(i - 1) : zeros;
+      const _Tp* mid = gray.ptr<_Tp>(i);
+      const _Tp* down = i < rows - 1 ? gray.ptr<_Tp>(i + 1) : zeros;
+      unsigned char* out = dst.ptr<unsigned char>(i);
+
+      out[0] = CSSILTP_border<_Tp, _Wt>(up, mid, down, 0, cols, limits);
+      int j = CSSILTP_row_simd(level, up, mid, down, out, 1, cols - 1, tau);
+      CSSILTP_row<_Tp, _Wt>(up, mid, down, out, j, cols - 1, limits);
+      if (cols > 1)
+        out[cols - 1] = CSSILTP_border<_Tp, _Wt>(up, mid, down, cols - 1, cols, limits);
+    }
   }
 
   void CSSILTP::run(const cv::Mat &input, cv::Mat &CSSILTP)
+  {
+    CSSILTP::run(input, CSSILTP, context);
+  }
+
+  void CSSILTP::run(const cv::Mat &input, cv::Mat &CSSILTP, LBPContext &context)
   {
     if (input.empty())
       return;
 
-    //const int N = 255; // max value of u8 pixel
-    const int weights = numberOfWeights;
-    //int rows = input.size().height;
-    //int cols = input.size().width;
-    int channels = input.channels();
-
     // convert input image to grayscale
-    cv::Mat gray;
-    if (channels > 1)
-      cv::cvtColor(input, gray, cv::COLOR_BGR2GRAY);
-    else
-      gray = input.clone();
-
-    // create filter
-    //CvMat* filter = cvCreateMat(filterDim, filterDim, CV_8UC1);
-
-    // verify filter dimensions are odd, so a middle element always exists
-    assert(filterDim == (filterDim + 1 - filterDim % 2));
-
-    //int nNeighbours = filterDim * filterDim - 1;
-    //int nWeights = numberOfWeights;
-
-    int filterRadius[2] = { static_cast<int>(floor(filterDim / 2.)), static_cast<int>(floor(filterDim / 2.)) };
-
-    // padd image with zeroes to deal with the edges
-    cv::Mat paddedImage = gray;
-    cv::copyMakeBorder(gray, paddedImage, filterRadius[0], filterRadius[0], filterRadius[0], filterRadius[0], cv::BORDER_CONSTANT, 0x00);
-
-    // compute weights
-    unsigned char* P = new unsigned char[weights];
-    unsigned char* S = new unsigned char[numberOfWeights];
-    float* weightVec = new float[numberOfWeights];
-    for (int i = 0; i < numberOfWeights; i++)
-      weightVec[i] = pow(3., i);
-
-    // create output image and set its elements on zero
-    CSSILTP = cv::Mat(gray.rows, gray.cols, CV_8UC1, cv::Scalar(0));
-
-    // compute the upper and lower range
-    cv::Mat inF32(input.rows, input.cols, CV_32FC1);
-    cv::Mat lowRangeF32(input.rows, input.cols, CV_32FC1);
-    cv::Mat upperRangeF32(input.rows, input.cols, CV_32FC1);
-
-    input.convertTo(inF32, CV_32F);
-    lowRangeF32 = (1 - tau) * inF32;
-    upperRangeF32 = (1 + tau) * inF32;
-
-    cv::Mat L, U;
-    lowRangeF32.convertTo(L, CV_8U);
-    upperRangeF32.convertTo(U, CV_8U);
-
-    cv::Mat subImg;
-    cv::Rect roi;
-    int* central = new int[numberOfWeights];
-    int* neighborhood = new int[numberOfWeights];
-    int* neighborhood1 = new int[numberOfWeights];
-    int* diffVec = new int[numberOfWeights];
-    int* lowerVal = new int[numberOfWeights];
-    int* upperVal = new int[numberOfWeights];
-
-    // process image
-    for (int i = 0; i < (paddedImage.rows - filterRadius[0] - 1); i++)
+    cv::Mat gray = context.gray(input, CSSILTP);
+
+    switch (gray.type())
     {
-      for (int j = 0; j < (paddedImage.cols - filterRadius[0] - 1); j++)
-      {
-        roi = cv::Rect(j, i, filterDim, filterDim);
-        paddedImage(roi).copyTo(subImg);
-
-        // neighborhood N0 to N3
-        P[0] = subImg.data[2 + subImg.cols * 1];
-        P[1] = subImg.data[2 + subImg.cols * 2];
-        P[2] = subImg.data[1 + subImg.cols * 2];
-        P[3] = subImg.data[0 + subImg.cols * 2];
-
-        // neighborhood N4 to N7
-        S[0] = subImg.data[0 + subImg.cols * 1];
-        S[1] = subImg.data[0 + subImg.cols * 0];
-        S[2] = subImg.data[1 + subImg.cols * 0];
-        S[3] = subImg.data[2 + subImg.cols * 0];
-
-        // value of the center pixel
-        central[0] = central[1] = central[2] = central[3] = subImg.data[1 + subImg.cols * 1];
-
-        // lower and upper limits
-        lowerVal[0] = lowerVal[1] = lowerVal[2] = lowerVal[3] = L.data[1 + subImg.cols * 1];
-        upperVal[0] = upperVal[1] = upperVal[2] = upperVal[3] = U.data[1 + subImg.cols * 1];
-
-        //neighborhood subtraction
-        for (int k = 0; k < numberOfWeights; k++)
-        {
-          neighborhood[k] = P[k] - central[k];
-          neighborhood1[k] = S[k] - central[k];
-          diffVec[k] = neighborhood[k] * neighborhood1[k];
-        }
-
-        // save output value
-        int value = 0;
-        for (int k = 0; k < numberOfWeights; k++)
-        {
-          int v;
-          if (diffVec[k] < lowerVal[k])
-            v = 3; // code 10
-          else
-            if (diffVec[k] > upperVal[k])
-              v = 1; // code 01
-            else
-              v = 0; // code 00
-
-          value += weightVec[k] * v;
-        }
-        CSSILTP.data[j + CSSILTP.cols * i] = value;
-      }
+      case CV_8SC1: CSSILTP_<char, int>(gray, CSSILTP, context); break;
+      case CV_8UC1: CSSILTP_<unsigned char, int>(gray, CSSILTP, context); break;
+      case CV_16SC1: CSSILTP_<short, double>(gray, CSSILTP, context); break;
+      case CV_16UC1: CSSILTP_<unsigned short, double>(gray, CSSILTP, context); break;
+      case CV_32SC1: CSSILTP_<int, double>(gray, CSSILTP, context); break;
+      case CV_32FC1: CSSILTP_<float, double>(gray, CSSILTP, context); break;
+      case CV_64FC1: CSSILTP_<double, double>(gray, CSSILTP, context); break;
     }
   }
 }
@@ -8,14 +8,20 @@ namespace lbplibrary
   class CSSILTP : public LBP
   {
   private:
-    int filterDim;
-    int numberOfWeights;
     float tau;
 
+    template <typename _Tp, typename _Wt>
+    void CSSILTP_(const cv::Mat& gray, cv::Mat& dst, LBPContext& context);
+
   public:
     CSSILTP();
     ~CSSILTP();
 
+    using LBP::run;
     void run(const cv::Mat &img_input, cv::Mat &img_output);
+    void run(const cv::Mat &img_input, cv::Mat &img_output, LBPContext &context);
+
+    int halo() const { return 1; }
+    LBPBorder border() const { return LBP_BORDER_ZERO; }
   };
 }
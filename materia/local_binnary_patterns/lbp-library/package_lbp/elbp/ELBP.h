@@ -2,6 +2,8 @@
 #include <opencv2/opencv.hpp>
 
 #include "../LBP.h"
+#include "../sampler/CircularSampler.h"
+#include "../mapping/Mapping.h"
 
 namespace lbplibrary
 {
@@ -10,14 +12,26 @@ namespace lbplibrary
   private:
     int radius;
     int neighbors;
+    LBPMapping mapping;
+    const unsigned short* table; // code -> bin, 0 for raw codes
+    CircularSampler sampler;
 
     template <typename _Tp>
-    void ELBP_(const cv::Mat& src, cv::Mat& dst);
+    void ELBP_(const cv::Mat& src, cv::Mat& dst, LBPContext& context);
 
   public:
-    ELBP();
+    // mappings need neighbors = 4, 8 or 16
+    ELBP(int radius = 1, int neighbors = 8, LBPMapping mapping = LBP_MAPPING_NONE);
     ~ELBP();
 
+    using LBP::run;
     void run(const cv::Mat &img_input, cv::Mat &img_output);
+    void run(const cv::Mat &img_input, cv::Mat &img_output, LBPContext &context);
+
+    // histogram bins of the output codes
+    int numPatterns() const { return mappingBins(mapping, neighbors); }
+
+    int halo() const { return radius; }
+    LBPBorder border() const { return LBP_BORDER_CROP; }
   };
 }
@@ -0,0 +1,151 @@
+#include <algorithm>
+#include <cctype>
+
+#include "LBPFactory.h"
+#include "../olbp/OLBP.h"
+#include "../elbp/ELBP.h"
+#include "../varlbp/VARLBP.h"
+#include "../cslbp/CSLBP.h"
+#include "../csldp/CSLDP.h"
+#include "../oclbp/OCLBP.h"
+#include "../scslbp/SCSLBP.h"
+#include "../siltp/SILTP.h"
+#include "../xcslbp/XCSLBP.h"
+#include "../cssiltp/CSSILTP.h"
+#include "../bglbp/BGLBP.h"
+
+namespace lbplibrary
+{
+  static int intParam(const LBPParams& params, const char* key, int value)
+  {
+    return cvRound(LBPFactory::param(params, key, value));
+  }
+
+  static LBP* createOLBP(const LBPParams& params)
+  {
+    static const char* const keys[] = { "mapping", 0 };
+    LBPFactory::checkParams("olbp", params, keys);
+    return new LBPOperator<OLBP>(static_cast<LBPMapping>(intParam(params, "mapping", LBP_MAPPING_NONE)));
+  }
+
+  static LBP* createELBP(const LBPParams& params)
+  {
+    static const char* const keys[] = { "radius", "neighbors", "mapping", 0 };
+    LBPFactory::checkParams("elbp", params, keys);
+    return new LBPOperator<ELBP>(intParam(params, "radius", 1), intParam(params, "neighbors", 8),
+      static_cast<LBPMapping>(intParam(params, "mapping", LBP_MAPPING_NONE)));
+  }
+
+  static LBP* createVARLBP(const LBPParams& params)
+  {
+    static const char* const keys[] = { "radius", "neighbors", "fixedPoint", 0 };
+    LBPFactory::checkParams("varlbp", params, keys);
+    return new LBPOperator<VARLBP>(intParam(params, "radius", 1), intParam(params, "neighbors", 8),
+      intParam(params, "fixedPoint", 0) != 0);
+  }
+
+  static LBP* createSCSLBP(const LBPParams& params)
+  {
+    static const char* const keys[] = { "radius", "neighbors", 0 };
+    LBPFactory::checkParams("scslbp", params, keys);
+    return new LBPOperator<SCSLBP>(intParam(params, "radius", 2), intParam(params, "neighbors", 4));
+  }
+
+  static LBP* createSILTP(const LBPParams& params)
+  {
+    static const char* const keys[] = { "tau", "radius", "neighbors", "encoder", 0 };
+    LBPFactory::checkParams("siltp", params, keys);
+    return new LBPOperator<SILTP>(static_cast<float>(LBPFactory::param(params, "tau", 0.03)),
+      intParam(params, "radius", 1), intParam(params, "neighbors", 4), intParam(params, "encoder", 0));
+  }
+
+  static LBP* createXCSLBP(const LBPParams& params)
+  {
+    static const char* const keys[] = { "stripes", 0 };
+    LBPFactory::checkParams("xcslbp", params, keys);
+    return new LBPOperator<XCSLBP>(intParam(params, "stripes", 1));
+  }
+
+  static LBP* createBGLBP(const LBPParams& params)
+  {
+    static const char* const keys[] = { "stripes", 0 };
+    LBPFactory::checkParams("bglbp", params, keys);
+    return new LBPOperator<BGLBP>(intParam(params, "stripes", 1));
+  }
+
+  // operators without parameters
+  template <class Op>
+  static LBP* createPlain(const char* name, const LBPParams& params)
+  {
+    static const char* const keys[] = { 0 };
+    LBPFactory::checkParams(name, params, keys);
+    return new LBPOperator<Op>();
+  }
+
+  static LBP* createCSLBP(const LBPParams& params) { return createPlain<CSLBP>("cslbp", params); }
+  static LBP* createCSLDP(const LBPParams& params) { return createPlain<CSLDP>("csldp", params); }
+  static LBP* createOCLBP(const LBPParams& params) { return createPlain<OCLBP>("oclbp", params); }
+  static LBP* createCSSILTP(const LBPParams& params) { return createPlain<CSSILTP>("cssiltp", params); }
+
+  static std::string lowerCase(std::string name)
+  {
+    std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return name;
+  }
+
+  static std::map<std::string, LBPFactory::Creator>& registry()
+  {
+    static std::map<std::string, LBPFactory::Creator> creators = {
+      { "olbp", createOLBP },
+      { "elbp", createELBP },
+      { "varlbp", createVARLBP },
+      { "cslbp", createCSLBP },
+      { "csldp", createCSLDP },
+      { "oclbp", createOCLBP },
+      { "scslbp", createSCSLBP },
+      { "siltp", createSILTP },
+      { "xcslbp", createXCSLBP },
+      { "cssiltp", createCSSILTP },
+      { "bglbp", createBGLBP }
+    };
+    return creators;
+  }
+
+  LBP* LBPFactory::create(const std::string& name, const LBPParams& params)
+  {
+    std::map<std::string, Creator>::const_iterator it = registry().find(lowerCase(name));
+    if (it == registry().end())
+      CV_Error(cv::Error::StsBadArg, "unknown LBP operator: " + name);
+    return it->second(params);
+  }
+
+  void LBPFactory::add(const std::string& name, Creator creator)
+  {
+    registry()[lowerCase(name)] = creator;
+  }
+
+  std::vector<std::string> LBPFactory::names()
+  {
+    std::vector<std::string> names;
+    for (std::map<std::string, Creator>::const_iterator it = registry().begin(); it != registry().end(); ++it)
+      names.push_back(it->first);
+    return names;
+  }
+
+  double LBPFactory::param(const LBPParams& params, const std::string& key, double value)
+  {
+    LBPParams::const_iterator it = params.find(key);
+    return it == params.end() ? value : it->second;
+  }
+
+  void LBPFactory::checkParams(const std::string& name, const LBPParams& params, const char* const* keys)
+  {
+    for (LBPParams::const_iterator it = params.begin(); it != params.end(); ++it) {
+      const char* const* key = keys;
+      while (*key && it->first != *key)
+        key++;
+      if (!*key)
+        CV_Error(cv::Error::StsBadArg, "LBP operator " + name + " has no parameter " + it->first);
+    }
+  }
+}
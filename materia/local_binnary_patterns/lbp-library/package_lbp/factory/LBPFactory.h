@@ -0,0 +1,91 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+#include "../LBP.h"
+
+namespace lbplibrary
+{
+  // Op::run without virtual dispatch; an operator that only declares the other form of run
+  // hides this one, and then gets the LBP default, as a virtual call would
+  template <class Op, class Output>
+  inline auto runDirect_(Op& op, const cv::Mat& input, Output& output, int) -> decltype(op.Op::run(input, output))
+  {
+    op.Op::run(input, output);
+  }
+
+  template <class Op, class Output>
+  inline void runDirect_(Op& op, const cv::Mat& input, Output& output, long)
+  {
+    op.LBP::run(input, output);
+  }
+
+  // runs op on count images through the non-virtual Op::run, so the calls can be inlined
+  template <class Op>
+  void runBatch(Op& op, const cv::Mat* inputs, cv::Mat* outputs, size_t count)
+  {
+    for (size_t i = 0; i < count; i++)
+      runDirect_(op, inputs[i], outputs[i], 0);
+  }
+
+  template <class Op>
+  void runBatch(Op& op, const cv::Mat* inputs, std::vector<cv::Mat>* outputs, size_t count)
+  {
+    for (size_t i = 0; i < count; i++)
+      runDirect_(op, inputs[i], outputs[i], 0);
+  }
+
+  // Op with its batch entry points bound to Op::run; the factory creates these
+  template <class Op>
+  class LBPOperator : public Op
+  {
+  public:
+    template <typename... Args>
+    LBPOperator(Args... args) : Op(args...) {}
+
+    using LBP::runBatch;
+    void runBatch(const cv::Mat* inputs, cv::Mat* outputs, size_t count)
+    {
+      lbplibrary::runBatch<Op>(*this, inputs, outputs, count);
+    }
+    void runBatch(const cv::Mat* inputs, std::vector<cv::Mat>* outputs, size_t count)
+    {
+      lbplibrary::runBatch<Op>(*this, inputs, outputs, count);
+    }
+  };
+
+  // named operator parameters, e.g. {{"radius", 2}, {"neighbors", 16}}
+  typedef std::map<std::string, double> LBPParams;
+
+  // Creates operators by name so they can be chosen from a configuration. The built-in names
+  // are the lower case class names; their parameters are
+  //   olbp:    mapping (an LBPMapping value)
+  //   elbp:    radius, neighbors, mapping
+  //   varlbp:  radius, neighbors, fixedPoint
+  //   scslbp:  radius, neighbors (centre-symmetric pairs)
+  //   siltp:   tau, radius, neighbors, encoder
+  //   xcslbp, bglbp: stripes
+  //   cslbp, csldp, cssiltp, oclbp: none
+  // Parameters left out keep the constructor defaults. Unknown names and parameters raise
+  // StsBadArg. The registry is not locked: add() operators before creating them from other threads.
+  class LBPFactory
+  {
+  public:
+    typedef LBP* (*Creator)(const LBPParams& params);
+
+    // the caller owns the returned operator
+    static LBP* create(const std::string& name, const LBPParams& params = LBPParams());
+    // registers (or replaces) an operator; name is matched case-insensitively
+    static void add(const std::string& name, Creator creator);
+    // sorted names of the registered operators
+    static std::vector<std::string> names();
+
+    // value of key in params, or value when it is not given
+    static double param(const LBPParams& params, const std::string& key, double value);
+    // raises StsBadArg when params holds a key that is not in keys (a 0-terminated list)
+    static void checkParams(const std::string& name, const LBPParams& params, const char* const* keys);
+  };
+}
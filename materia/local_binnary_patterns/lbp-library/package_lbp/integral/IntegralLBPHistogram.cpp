@@ -0,0 +1,257 @@
+#include <vector>
+#include <cstring>
+#include <algorithm>
+
+#include "IntegralLBPHistogram.h"
+#include "../simd/SIMD.h"
+
+namespace lbplibrary
+{
+  IntegralLBPHistogram::IntegralLBPHistogram() : numPatterns_(0)
+  {
+  }
+
+  IntegralLBPHistogram::IntegralLBPHistogram(const cv::Mat& codes, int numPatterns, int maxWindowArea) : numPatterns_(0)
+  {
+    build(codes, numPatterns, maxWindowArea);
+  }
+
+#if defined(LBP_SIMD_X86)
+  LBP_TARGET_SSE41 static int integral_add_sse41(const unsigned short* u, const unsigned short* r, unsigned short* o, int n)
+  {
+    int b = 0;
+    for (; b <= n - 8; b += 8)
+      _mm_storeu_si128((__m128i*)(o + b), _mm_add_epi16(_mm_loadu_si128((const __m128i*)(u + b)), _mm_loadu_si128((const __m128i*)(r + b))));
+    return b;
+  }
+
+  LBP_TARGET_SSE41 static int integral_add_sse41(const unsigned int* u, const unsigned int* r, unsigned int* o, int n)
+  {
+    int b = 0;
+    for (; b <= n - 4; b += 4)
+      _mm_storeu_si128((__m128i*)(o + b), _mm_add_epi32(_mm_loadu_si128((const __m128i*)(u + b)), _mm_loadu_si128((const __m128i*)(r + b))));
+    return b;
+  }
+
+  LBP_TARGET_AVX2 static int integral_add_avx2(const unsigned short* u, const unsigned short* r, unsigned short* o, int n)
+  {
+    int b = 0;
+    for (; b <= n - 16; b += 16)
+      _mm256_storeu_si256((__m256i*)(o + b), _mm256_add_epi16(_mm256_loadu_si256((const __m256i*)(u + b)), _mm256_loadu_si256((const __m256i*)(r + b))));
+    return b;
+  }
+
+  LBP_TARGET_AVX2 static int integral_add_avx2(const unsigned int* u, const unsigned int* r, unsigned int* o, int n)
+  {
+    int b = 0;
+    for (; b <= n - 8; b += 8)
+      _mm256_storeu_si256((__m256i*)(o + b), _mm256_add_epi32(_mm256_loadu_si256((const __m256i*)(u + b)), _mm256_loadu_si256((const __m256i*)(r + b))));
+    return b;
+  }
+
+  // hist = d - b - c + a, the 16-bit differences widened to int
+  LBP_TARGET_SSE41 static int integral_corners_sse41(const unsigned short* a, const unsigned short* b, const unsigned short* c, const unsigned short* d, int* hist, int n)
+  {
+    int i = 0;
+    for (; i <= n - 8; i += 8) {
+      __m128i v = _mm_sub_epi16(_mm_loadu_si128((const __m128i*)(d + i)), _mm_loadu_si128((const __m128i*)(b + i)));
+      v = _mm_add_epi16(_mm_sub_epi16(v, _mm_loadu_si128((const __m128i*)(c + i))), _mm_loadu_si128((const __m128i*)(a + i)));
+      _mm_storeu_si128((__m128i*)(hist + i), _mm_cvtepu16_epi32(v));
+      _mm_storeu_si128((__m128i*)(hist + i + 4), _mm_cvtepu16_epi32(_mm_srli_si128(v, 8)));
+    }
+    return i;
+  }
+
+  LBP_TARGET_SSE41 static int integral_corners_sse41(const unsigned int* a, const unsigned int* b, const unsigned int* c, const unsigned int* d, int* hist, int n)
+  {
+    int i = 0;
+    for (; i <= n - 4; i += 4) {
+      __m128i v = _mm_sub_epi32(_mm_loadu_si128((const __m128i*)(d + i)), _mm_loadu_si128((const __m128i*)(b + i)));
+      v = _mm_add_epi32(_mm_sub_epi32(v, _mm_loadu_si128((const __m128i*)(c + i))), _mm_loadu_si128((const __m128i*)(a + i)));
+      _mm_storeu_si128((__m128i*)(hist + i), v);
+    }
+    return i;
+  }
+
+  LBP_TARGET_AVX2 static int integral_corners_avx2(const unsigned short* a, const unsigned short* b, const unsigned short* c, const unsigned short* d, int* hist, int n)
+  {
+    int i = 0;
+    for (; i <= n - 16; i += 16) {
+      __m256i v = _mm256_sub_epi16(_mm256_loadu_si256((const __m256i*)(d + i)), _mm256_loadu_si256((const __m256i*)(b + i)));
+      v = _mm256_add_epi16(_mm256_sub_epi16(v, _mm256_loadu_si256((const __m256i*)(c + i))), _mm256_loadu_si256((const __m256i*)(a + i)));
+      _mm256_storeu_si256((__m256i*)(hist + i), _mm256_cvtepu16_epi32(_mm256_castsi256_si128(v)));
+      _mm256_storeu_si256((__m256i*)(hist + i + 8), _mm256_cvtepu16_epi32(_mm256_extracti128_si256(v, 1)));
+    }
+    return i;
+  }
+
+  LBP_TARGET_AVX2 static int integral_corners_avx2(const unsigned int* a, const unsigned int* b, const unsigned int* c, const unsigned int* d, int* hist, int n)
+  {
+    int i = 0;
+    for (; i <= n - 8; i += 8) {
+      __m256i v = _mm256_sub_epi32(_mm256_loadu_si256((const __m256i*)(d + i)), _mm256_loadu_si256((const __m256i*)(b + i)));
+      v = _mm256_add_epi32(_mm256_sub_epi32(v, _mm256_loadu_si256((const __m256i*)(c + i))), _mm256_loadu_si256((const __m256i*)(a + i)));
+      _mm256_storeu_si256((__m256i*)(hist + i), v);
+    }
+    return i;
+  }
+#elif defined(LBP_SIMD_NEON)
+  static int integral_add_neon(const unsigned short* u, const unsigned short* r, unsigned short* o, int n)
+  {
+    int b = 0;
+    for (; b <= n - 8; b += 8)
+      vst1q_u16(o + b, vaddq_u16(vld1q_u16(u + b), vld1q_u16(r + b)));
+    return b;
+  }
+
+  static int integral_add_neon(const unsigned int* u, const unsigned int* r, unsigned int* o, int n)
+  {
+    int b = 0;
+    for (; b <= n - 4; b += 4)
+      vst1q_u32(o + b, vaddq_u32(vld1q_u32(u + b), vld1q_u32(r + b)));
+    return b;
+  }
+
+  static int integral_corners_neon(const unsigned short* a, const unsigned short* b, const unsigned short* c, const unsigned short* d, int* hist, int n)
+  {
+    int i = 0;
+    for (; i <= n - 8; i += 8) {
+      uint16x8_t v = vaddq_u16(vsubq_u16(vsubq_u16(vld1q_u16(d + i), vld1q_u16(b + i)), vld1q_u16(c + i)), vld1q_u16(a + i));
+      vst1q_s32(hist + i, vreinterpretq_s32_u32(vmovl_u16(vget_low_u16(v))));
+      vst1q_s32(hist + i + 4, vreinterpretq_s32_u32(vmovl_u16(vget_high_u16(v))));
+    }
+    return i;
+  }
+
+  static int integral_corners_neon(const unsigned int* a, const unsigned int* b, const unsigned int* c, const unsigned int* d, int* hist, int n)
+  {
+    int i = 0;
+    for (; i <= n - 4; i += 4) {
+      uint32x4_t v = vaddq_u32(vsubq_u32(vsubq_u32(vld1q_u32(d + i), vld1q_u32(b + i)), vld1q_u32(c + i)), vld1q_u32(a + i));
+      vst1q_s32(hist + i, vreinterpretq_s32_u32(v));
+    }
+    return i;
+  }
+#endif
+
+  // o = u + r over n bins
+  template <typename _Acc>
+  static inline void integral_add_row(SimdLevel level, const _Acc* u, const _Acc* r, _Acc* o, int n)
+  {
+    int b = 0;
+#if defined(LBP_SIMD_X86)
+    if (level == SIMD_256)
+      b = integral_add_avx2(u, r, o, n);
+    else if (level == SIMD_128)
+      b = integral_add_sse41(u, r, o, n);
+#elif defined(LBP_SIMD_NEON)
+    if (level != SIMD_SCALAR)
+      b = integral_add_neon(u, r, o, n);
+#endif
+    for (; b < n; b++)
+      o[b] = (_Acc)(u[b] + r[b]);
+  }
+
+  // codes outside [0, numPatterns) are not counted
+  template <typename _Tp, typename _Acc>
+  static void integral_build_(const cv::Mat& codes, cv::Mat& table, int numPatterns)
+  {
+    const SimdLevel level = simdLevel();
+    std::vector<_Acc> row(numPatterns);
+    memset(table.ptr<_Acc>(0), 0, table.cols * sizeof(_Acc));
+    for (int y = 0; y < codes.rows; y++) {
+      const _Tp* c = codes.ptr<_Tp>(y);
+      const _Acc* up = table.ptr<_Acc>(y);
+      _Acc* out = table.ptr<_Acc>(y + 1);
+      std::fill(row.begin(), row.end(), 0);
+      memset(out, 0, numPatterns * sizeof(_Acc));
+      for (int x = 0; x < codes.cols; x++) {
+        int bin = c[x];
+        if ((unsigned)bin < (unsigned)numPatterns)
+          row[bin]++;
+        // histogram of [0, x + 1) x [0, y + 1) = the one above plus the row so far
+        integral_add_row(level, up + (x + 1) * numPatterns, &row[0], out + (x + 1) * numPatterns, numPatterns);
+      }
+    }
+  }
+
+  template <typename _Acc>
+  static void integral_build(const cv::Mat& codes, cv::Mat& table, int numPatterns)
+  {
+    switch (codes.type()) {
+      case CV_8SC1: integral_build_<char, _Acc>(codes, table, numPatterns); break;
+      case CV_8UC1: integral_build_<unsigned char, _Acc>(codes, table, numPatterns); break;
+      case CV_16SC1: integral_build_<short, _Acc>(codes, table, numPatterns); break;
+      case CV_16UC1: integral_build_<unsigned short, _Acc>(codes, table, numPatterns); break;
+      case CV_32SC1: integral_build_<int, _Acc>(codes, table, numPatterns); break;
+      default: CV_Error(cv::Error::StsUnsupportedFormat, "Codes must be a single channel integer image.");
+    }
+  }
+
+  void IntegralLBPHistogram::build(const cv::Mat& codes, int numPatterns, int maxWindowArea)
+  {
+    if (numPatterns <= 0)
+      CV_Error(cv::Error::StsBadArg, "numPatterns must be positive.");
+
+    // the largest count a rectangle can reach decides the width of the counters
+    double area = static_cast<double>(codes.rows) * codes.cols;
+    if (maxWindowArea > 0)
+      area = std::min(area, static_cast<double>(maxWindowArea));
+    int depth = area < 65536 ? CV_16U : CV_32S;
+
+    numPatterns_ = numPatterns;
+    size_ = codes.size();
+    table.create(codes.rows + 1, (codes.cols + 1) * numPatterns, CV_MAKETYPE(depth, 1));
+    if (depth == CV_16U)
+      integral_build<unsigned short>(codes, table, numPatterns);
+    else
+      integral_build<unsigned int>(codes, table, numPatterns);
+  }
+
+  // the differences wrap around in the counter type and are exact as long as the true count fits
+  template <typename _Acc>
+  static void integral_lookup_(const cv::Mat& table, const cv::Rect& roi, int numPatterns, int* hist)
+  {
+    const _Acc* a = table.ptr<_Acc>(roi.y) + roi.x * numPatterns;
+    const _Acc* b = table.ptr<_Acc>(roi.y) + (roi.x + roi.width) * numPatterns;
+    const _Acc* c = table.ptr<_Acc>(roi.y + roi.height) + roi.x * numPatterns;
+    const _Acc* d = table.ptr<_Acc>(roi.y + roi.height) + (roi.x + roi.width) * numPatterns;
+    const SimdLevel level = simdLevel();
+    int i = 0;
+#if defined(LBP_SIMD_X86)
+    if (level == SIMD_256)
+      i = integral_corners_avx2(a, b, c, d, hist, numPatterns);
+    else if (level == SIMD_128)
+      i = integral_corners_sse41(a, b, c, d, hist, numPatterns);
+#elif defined(LBP_SIMD_NEON)
+    if (level != SIMD_SCALAR)
+      i = integral_corners_neon(a, b, c, d, hist, numPatterns);
+#endif
+    for (; i < numPatterns; i++)
+      hist[i] = (_Acc)(d[i] - b[i] - c[i] + a[i]);
+  }
+
+  void IntegralLBPHistogram::histogram(const cv::Rect& roi, int* hist) const
+  {
+    if (roi.x < 0 || roi.y < 0 || roi.width < 0 || roi.height < 0 || roi.x + roi.width > size_.width || roi.y + roi.height > size_.height)
+      CV_Error(cv::Error::StsOutOfRange, "Rectangle outside the code image.");
+
+    if (table.depth() == CV_16U)
+      integral_lookup_<unsigned short>(table, roi, numPatterns_, hist);
+    else
+      integral_lookup_<unsigned int>(table, roi, numPatterns_, hist);
+  }
+
+  void IntegralLBPHistogram::histogram(const cv::Rect& roi, cv::Mat& hist) const
+  {
+    hist.create(1, numPatterns_, CV_32SC1);
+    histogram(roi, hist.ptr<int>());
+  }
+
+  cv::Mat IntegralLBPHistogram::histogram(const cv::Rect& roi) const
+  {
+    cv::Mat hist;
+    histogram(roi, hist);
+    return hist;
+  }
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+
+namespace lbplibrary
+{
+  // Integral histogram of a code image: for every position (x, y) it holds the histogram of
+  // the codes in [0, x) x [0, y), so the histogram of any rectangle costs four lookups per bin
+  // regardless of its area. Counts are kept in 16 bits when no rectangle can hold 65536 codes
+  // (the corner differences are exact modulo 2^16), otherwise in 32 bits.
+  class IntegralLBPHistogram
+  {
+  public:
+    IntegralLBPHistogram();
+    // maxWindowArea > 0 promises that no queried rectangle is larger, which allows 16-bit
+    // counts on images with more than 65535 pixels
+    IntegralLBPHistogram(const cv::Mat& codes, int numPatterns, int maxWindowArea = 0);
+
+    // (re)builds the table, reusing its memory when the geometry does not change
+    void build(const cv::Mat& codes, int numPatterns, int maxWindowArea = 0);
+
+    // same result as histogram() over codes(roi): 1 x numPatterns, CV_32SC1
+    void histogram(const cv::Rect& roi, cv::Mat& hist) const;
+    cv::Mat histogram(const cv::Rect& roi) const;
+    // writes numPatterns counts to hist
+    void histogram(const cv::Rect& roi, int* hist) const;
+
+    int numPatterns() const { return numPatterns_; }
+    cv::Size size() const { return size_; }
+    // CV_16U or CV_32S, the type of the counts
+    int depth() const { return table.depth(); }
+
+  private:
+    int numPatterns_;
+    cv::Size size_;
+    // row y holds the histograms of the (size.width + 1) positions x of table row y, bins contiguous
+    cv::Mat table;
+  };
+}
@@ -0,0 +1,154 @@
+#include <climits>
+#include <opencv2/opencv.hpp>
+
+#include "Mapping.h"
+
+namespace lbplibrary
+{
+  template <int P>
+  struct MappingTable
+  {
+    unsigned short bin[1 << P];
+  };
+
+  static constexpr int mapping_popcount(int code)
+  {
+    int n = 0;
+    for (; code; code >>= 1)
+      n += code & 1;
+    return n;
+  }
+
+  // circular rotation by one neighbour
+  static constexpr int mapping_rotate(int code, int P)
+  {
+    return ((code << 1) | (code >> (P - 1))) & ((1 << P) - 1);
+  }
+
+  static constexpr int mapping_transitions(int code, int P)
+  {
+    return mapping_popcount(code ^ mapping_rotate(code, P));
+  }
+
+  static constexpr int mapping_min_rotation(int code, int P)
+  {
+    int m = code;
+    for (int r = 1; r < P; r++) {
+      code = mapping_rotate(code, P);
+      if (code < m)
+        m = code;
+    }
+    return m;
+  }
+
+  // uniform patterns are numbered in increasing code order, the others share the last bin
+  static constexpr void mapping_fill_u2(unsigned short* bin, int P)
+  {
+    int next = 0;
+    for (int code = 0; code < (1 << P); code++)
+      bin[code] = mapping_transitions(code, P) <= 2 ? next++ : P * (P - 1) + 2;
+  }
+
+  // a rotation class gets its bin at its smallest member, which is also the first one met
+  static constexpr void mapping_fill_ri(unsigned short* bin, int P)
+  {
+    int next = 0;
+    for (int code = 0; code < (1 << P); code++) {
+      int m = mapping_min_rotation(code, P);
+      bin[code] = m == code ? next++ : bin[m];
+    }
+  }
+
+  // uniform patterns map to their number of ones, the others to P + 1
+  static constexpr void mapping_fill_riu2(unsigned short* bin, int P)
+  {
+    for (int code = 0; code < (1 << P); code++)
+      bin[code] = mapping_transitions(code, P) <= 2 ? mapping_popcount(code) : P + 1;
+  }
+
+  template <int P>
+  static constexpr MappingTable<P> mapping_u2()
+  {
+    MappingTable<P> t = {};
+    mapping_fill_u2(t.bin, P);
+    return t;
+  }
+
+  template <int P>
+  static constexpr MappingTable<P> mapping_ri()
+  {
+    MappingTable<P> t = {};
+    mapping_fill_ri(t.bin, P);
+    return t;
+  }
+
+  template <int P>
+  static constexpr MappingTable<P> mapping_riu2()
+  {
+    MappingTable<P> t = {};
+    mapping_fill_riu2(t.bin, P);
+    return t;
+  }
+
+  static constexpr MappingTable<4> u2_4 = mapping_u2<4>();
+  static constexpr MappingTable<8> u2_8 = mapping_u2<8>();
+  static constexpr MappingTable<4> ri_4 = mapping_ri<4>();
+  static constexpr MappingTable<8> ri_8 = mapping_ri<8>();
+  static constexpr MappingTable<4> riu2_4 = mapping_riu2<4>();
+  static constexpr MappingTable<8> riu2_8 = mapping_riu2<8>();
+
+  static_assert(u2_8.bin[255] == 57 && u2_8.bin[5] == 58, "u2 mapping for P=8");
+  static_assert(ri_8.bin[255] == 35, "ri mapping for P=8 has 36 bins");
+  static_assert(riu2_8.bin[255] == 8 && riu2_8.bin[5] == 9, "riu2 mapping for P=8");
+
+  // the 2^16 entry tables take more steps than compilers allow a constant expression
+  // (Clang stops at 2^20 by default), so they are built once, on first use
+  struct MappingTables16
+  {
+    MappingTable<16> u2, ri, riu2;
+
+    MappingTables16()
+    {
+      mapping_fill_u2(u2.bin, 16);
+      mapping_fill_ri(ri.bin, 16);
+      mapping_fill_riu2(riu2.bin, 16);
+    }
+  };
+
+  static const MappingTables16& mapping_tables_16()
+  {
+    static const MappingTables16 tables;
+    return tables;
+  }
+
+  int mappingBins(LBPMapping mapping, int neighbors)
+  {
+    switch (mapping) {
+      case LBP_MAPPING_U2: return neighbors * (neighbors - 1) + 3;
+      case LBP_MAPPING_RI:
+        switch (neighbors) {
+          case 4: return ri_4.bin[15] + 1;
+          case 8: return ri_8.bin[255] + 1;
+          case 16: return mapping_tables_16().ri.bin[65535] + 1;
+        }
+        CV_Error(cv::Error::StsBadArg, "Rotation invariant mapping is only available for 4, 8 and 16 neighbours.");
+        return 0;
+      case LBP_MAPPING_RIU2: return neighbors + 2;
+      default: return neighbors < 31 ? 1 << neighbors : INT_MAX;
+    }
+  }
+
+  const unsigned short* mappingTable(LBPMapping mapping, int neighbors)
+  {
+    if (mapping == LBP_MAPPING_NONE)
+      return 0;
+    if (neighbors != 4 && neighbors != 8 && neighbors != 16)
+      CV_Error(cv::Error::StsBadArg, "Mappings are only available for 4, 8 and 16 neighbours.");
+
+    switch (mapping) {
+      case LBP_MAPPING_U2: return neighbors == 4 ? u2_4.bin : neighbors == 8 ? u2_8.bin : mapping_tables_16().u2.bin;
+      case LBP_MAPPING_RI: return neighbors == 4 ? ri_4.bin : neighbors == 8 ? ri_8.bin : mapping_tables_16().ri.bin;
+      default: return neighbors == 4 ? riu2_4.bin : neighbors == 8 ? riu2_8.bin : mapping_tables_16().riu2.bin;
+    }
+  }
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+namespace lbplibrary
+{
+  // code -> bin mappings of the circular operators (Ojala et al.)
+  enum LBPMapping
+  {
+    LBP_MAPPING_NONE, // raw codes, 2^P bins
+    LBP_MAPPING_U2,   // uniform patterns (at most two circular 0/1 transitions), P*(P-1)+3 bins
+    LBP_MAPPING_RI,   // rotation invariant, one bin per class of rotations (36 for P=8)
+    LBP_MAPPING_RIU2  // rotation invariant uniform, P+2 bins
+  };
+
+  // number of histogram bins of a mapping for P neighbours
+  int mappingBins(LBPMapping mapping, int neighbors);
+
+  // table of 2^P bins indexed by code, or 0 for LBP_MAPPING_NONE;
+  // the tables are built at compile time for P = 4 and 8, on first use for P = 16, and
+  // other P raise StsBadArg
+  const unsigned short* mappingTable(LBPMapping mapping, int neighbors);
+}
@@ -1,241 +1,211 @@
 #include <iostream>
-#include <assert.h>
-#include <algorithm>
 
 #include "OCLBP.h"
+#include "../simd/SIMD.h"
 
 namespace lbplibrary
 {
-  OCLBP::OCLBP() : isEfficient(1), filtDimsX(3), filtDimsY(3)
+  OCLBP::OCLBP()
   {
-    std::cout << "OCLBP()" << std::endl;
   }
 
   OCLBP::~OCLBP()
   {
-    std::cout << "~OCLBP()" << std::endl;
   }
 
-  int product8(cv::Mat &diffVecPositive, int weightVec[8], int nNeighbours)
-  {
-    int retVal = 0;
+  // bit of each neighbour, neighbours listed as TL, T, TR, L, R, BL, B, BR.
+  // The same-channel codes number the neighbours clockwise from the top-left corner,
+  // the opponent codes in raster order (as the Matlab implementation does).
+  static const unsigned char OCLBP_helix[8] = { 1, 2, 4, 128, 8, 64, 32, 16 };
+  static const unsigned char OCLBP_raster[8] = { 1, 2, 4, 8, 16, 32, 64, 128 };
 
-    // convert 0xFF elements of diffVecPositive to 0x01
-    for (int i = 0; i < nNeighbours; i++)
-    {
-      if (diffVecPositive.data[i] == 255)
-        diffVecPositive.data[i] = 1;
-    }
+  // the six codes as (centre plane, neighbour plane), planes in R, G, B order
+  static const int OCLBP_comb[6][2] = { { 0, 0 }, { 1, 1 }, { 2, 2 }, { 0, 1 }, { 0, 2 }, { 1, 2 } };
 
-    // compute cumulative product between the two vectors
-    for (int i = 0; i < nNeighbours; i++)
-    {
-      retVal += diffVecPositive.data[i] * weightVec[i];
-    }
+  // rows of one zero-padded plane around output row i, already offset to output column 0
+  struct OCLBP_rows
+  {
+    const unsigned char* up;
+    const unsigned char* mid;
+    const unsigned char* down;
+  };
 
-    return retVal;
+  static inline unsigned char OCLBP_code(int c, const OCLBP_rows& n, int j, const unsigned char* bits)
+  {
+    int value = 0;
+    value |= (c > n.up[j - 1]) ? bits[0] : 0;
+    value |= (c > n.up[j]) ? bits[1] : 0;
+    value |= (c > n.up[j + 1]) ? bits[2] : 0;
+    value |= (c > n.mid[j - 1]) ? bits[3] : 0;
+    value |= (c > n.mid[j + 1]) ? bits[4] : 0;
+    value |= (c > n.down[j - 1]) ? bits[5] : 0;
+    value |= (c > n.down[j]) ? bits[6] : 0;
+    value |= (c > n.down[j + 1]) ? bits[7] : 0;
+    return value;
   }
 
-  void efficientLBP(const cv::Mat &image, cv::Mat &efficientLBPImage, const int filter[2], int isEfficient)
+  static void OCLBP_row(const OCLBP_rows* plane, unsigned char** out, int j, int width)
   {
-    cv::Mat gray;
-    if (image.channels() == 3)
-      cv::cvtColor(image, gray, cv::COLOR_BGR2GRAY);
-    else
-      gray = image;
-
-    // verify filter dimensions are odd, so a middle element always exists
-    assert(filter[0] == (filter[0] + 1 - filter[0] % 2));
-    assert(filter[1] == (filter[1] + 1 - filter[1] % 2));
-
-    int nNeigh = filter[0] * filter[1] - 1;
-
-    cv::Mat iHelix(1, filter[0] * filter[1], CV_8UC1);
-    iHelix.data[0] = 0; iHelix.data[1] = 1; iHelix.data[2] = 2;
-    iHelix.data[3] = 5; iHelix.data[4] = 8; iHelix.data[5] = 7;
-    iHelix.data[6] = 6; iHelix.data[7] = 3; iHelix.data[8] = 4;
-
-    cv::Mat iNeight(1, nNeigh, CV_8UC1);
-    for (int i = 0; i < nNeigh; i++)
-      iNeight.data[i] = iHelix.data[i];
-
-    int filtCenter = ceil((float)((nNeigh + 1) / 2.0)) - 1;
-
-    cv::Mat filt(filter[0], filter[1], CV_32FC1, cv::Scalar(0));
-    float* filtData = (float*)filt.data;
-
-    // Better filtering/convolution based approach
-    if (isEfficient)
-    {
-      filtData[filtCenter] = 1.0;
-      filtData[iNeight.data[0]] = -1.0;
-
-      unsigned char* sumLBPData = efficientLBPImage.data;
-      memset(sumLBPData, 0x00, efficientLBPImage.step * efficientLBPImage.rows);
-
-      for (int i = 0; i < nNeigh; i++)
-      {
-        cv::Mat currNieghDiff(gray.rows, gray.cols, CV_32FC1);
-        float* currNieghDiffData = (float*)currNieghDiff.data;
-        cv::filter2D(gray, currNieghDiff, currNieghDiff.depth(), filt);
-
-        int cnt = 0;
-        for (int j = 0; j < currNieghDiff.rows; j++)
-        {
-          for (int k = 0; k < currNieghDiff.cols; k++)
-          {
-            sumLBPData[cnt++] += (currNieghDiffData[k + j*currNieghDiff.cols] > 0) ? pow(2.0, i) : 0;
-          }
-        }
-        // update filter
-        if (i < nNeigh)
-        {
-          filtData[iNeight.data[i]] = 0;
-          filtData[iNeight.data[i + 1]] = -1;
-        }
+    for (; j < width; j++)
+      for (int k = 0; k < 6; k++) {
+        const OCLBP_rows& centre = plane[OCLBP_comb[k][0]];
+        out[k][j] = OCLBP_code(centre.mid[j], plane[OCLBP_comb[k][1]], j, k < 3 ? OCLBP_helix : OCLBP_raster);
       }
-    }
   }
 
-  void processOCLBP(const cv::Mat &in, std::vector<cv::Mat> &out, const int filter[2], const int filterR[2], int nComb, const int chnsComb[6][2], int isEfficient)
+#if defined(LBP_SIMD_X86)
+  // inputs are biased by 0x80 for the signed byte compares
+  LBP_TARGET_SSE41 static inline __m128i OCLBP_bit_sse(__m128i c, const unsigned char* p, __m128i bias, unsigned char bit)
   {
-    int heightIn = in.size().height;
-    int widthIn = in.size().width;
-    int channels = in.channels();
-
-    // create a vector of input images of u8 to store each channel
-    std::vector<cv::Mat> inputImage(nComb);
-    cv::Mat sumLBP(heightIn, widthIn, CV_8UC1, cv::Scalar(0));
-
-    // create a vector of output padded images
-    std::vector<cv::Mat> outputImage(nComb);
-
-    // compute number of neibghbors based on filter's dimensions
-    int nNeighbours = filter[0] * filter[0] - 1;
-    int filtCenter = ceil((float)((nNeighbours + 1) / 2));
+    __m128i n = _mm_xor_si128(_mm_loadu_si128((const __m128i*)p), bias);
+    return _mm_and_si128(_mm_cmpgt_epi8(c, n), _mm_set1_epi8((char)bit));
+  }
 
-    // create neighbors mask
-    cv::Mat neightMat(filter[0], filter[1], CV_8UC1, cv::Scalar(1));
-    neightMat.data[filtCenter] = 0;
+  LBP_TARGET_SSE41 static inline __m128i OCLBP_code_sse(__m128i c, const OCLBP_rows& n, int j, __m128i bias, const unsigned char* bits)
+  {
+    __m128i code = OCLBP_bit_sse(c, n.up + j - 1, bias, bits[0]);
+    code = _mm_or_si128(code, OCLBP_bit_sse(c, n.up + j, bias, bits[1]));
+    code = _mm_or_si128(code, OCLBP_bit_sse(c, n.up + j + 1, bias, bits[2]));
+    code = _mm_or_si128(code, OCLBP_bit_sse(c, n.mid + j - 1, bias, bits[3]));
+    code = _mm_or_si128(code, OCLBP_bit_sse(c, n.mid + j + 1, bias, bits[4]));
+    code = _mm_or_si128(code, OCLBP_bit_sse(c, n.down + j - 1, bias, bits[5]));
+    code = _mm_or_si128(code, OCLBP_bit_sse(c, n.down + j, bias, bits[6]));
+    code = _mm_or_si128(code, OCLBP_bit_sse(c, n.down + j + 1, bias, bits[7]));
+    return code;
+  }
 
-    // assign weights to each neighbor
-    int weightVec[8] = { 1, 2, 4, 8, 16, 32, 64, 128 };
+  LBP_TARGET_SSE41 static int OCLBP_row_sse41(const OCLBP_rows* plane, unsigned char** out, int j, int width)
+  {
+    const __m128i bias = _mm_set1_epi8((char)0x80);
+    for (; j <= width - 16; j += 16) {
+      __m128i c[3];
+      for (int p = 0; p < 3; p++)
+        c[p] = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(plane[p].mid + j)), bias);
+      for (int k = 0; k < 6; k++)
+        _mm_storeu_si128((__m128i*)(out[k] + j), OCLBP_code_sse(c[OCLBP_comb[k][0]], plane[OCLBP_comb[k][1]], j, bias, k < 3 ? OCLBP_helix : OCLBP_raster));
+    }
+    return j;
+  }
 
-    // declare Mat objects needed
-    cv::Mat subImgMasked(1, nNeighbours, CV_32FC1);
-    cv::Mat diffVec(1, nNeighbours, CV_32FC1);
-    cv::Mat diffVecPositive(1, nNeighbours, CV_8UC1);
+  LBP_TARGET_AVX2 static inline __m256i OCLBP_bit_avx2(__m256i c, const unsigned char* p, __m256i bias, unsigned char bit)
+  {
+    __m256i n = _mm256_xor_si256(_mm256_loadu_si256((const __m256i*)p), bias);
+    return _mm256_and_si256(_mm256_cmpgt_epi8(c, n), _mm256_set1_epi8((char)bit));
+  }
 
-    float* subImgMaskedData = (float*)subImgMasked.data;
-    //float* diffVecData = (float*)diffVec.data;
+  LBP_TARGET_AVX2 static inline __m256i OCLBP_code_avx2(__m256i c, const OCLBP_rows& n, int j, __m256i bias, const unsigned char* bits)
+  {
+    __m256i code = OCLBP_bit_avx2(c, n.up + j - 1, bias, bits[0]);
+    code = _mm256_or_si256(code, OCLBP_bit_avx2(c, n.up + j, bias, bits[1]));
+    code = _mm256_or_si256(code, OCLBP_bit_avx2(c, n.up + j + 1, bias, bits[2]));
+    code = _mm256_or_si256(code, OCLBP_bit_avx2(c, n.mid + j - 1, bias, bits[3]));
+    code = _mm256_or_si256(code, OCLBP_bit_avx2(c, n.mid + j + 1, bias, bits[4]));
+    code = _mm256_or_si256(code, OCLBP_bit_avx2(c, n.down + j - 1, bias, bits[5]));
+    code = _mm256_or_si256(code, OCLBP_bit_avx2(c, n.down + j, bias, bits[6]));
+    code = _mm256_or_si256(code, OCLBP_bit_avx2(c, n.down + j + 1, bias, bits[7]));
+    return code;
+  }
 
-    // process each channel
-    for (int i = 0; i < nComb; i++)
-    {
-      int iCurrCenterClr = chnsComb[i][0] - 1;
-      int iCurrNeighClr = chnsComb[i][1] - 1;
-
-      inputImage[i] = cv::Mat(heightIn, widthIn, CV_8UC1);
-
-      if (iCurrCenterClr == iCurrNeighClr && isEfficient)
-      {
-        for (int iRow = 0; iRow < inputImage[i].rows; iRow++)
-        {
-          for (int iCol = 0; iCol < inputImage[i].cols; iCol++)
-          {
-            // each channel will account for one image of u8
-            inputImage[i].data[iCol + iRow * inputImage[i].step] = in.data[iCol * channels + iCurrCenterClr + iRow * in.step];
-          }
-        }
-        // compute efficient LBP and save it in output vector
-        efficientLBP(inputImage[i], sumLBP, filter, isEfficient);
-        outputImage[i] = sumLBP;
-        continue;
-      }
+  LBP_TARGET_AVX2 static int OCLBP_row_avx2(const OCLBP_rows* plane, unsigned char** out, int j, int width)
+  {
+    const __m256i bias = _mm256_set1_epi8((char)0x80);
+    for (; j <= width - 32; j += 32) {
+      __m256i c[3];
+      for (int p = 0; p < 3; p++)
+        c[p] = _mm256_xor_si256(_mm256_loadu_si256((const __m256i*)(plane[p].mid + j)), bias);
+      for (int k = 0; k < 6; k++)
+        _mm256_storeu_si256((__m256i*)(out[k] + j), OCLBP_code_avx2(c[OCLBP_comb[k][0]], plane[OCLBP_comb[k][1]], j, bias, k < 3 ? OCLBP_helix : OCLBP_raster));
+    }
+    return OCLBP_row_sse41(plane, out, j, width);
+  }
+#elif defined(LBP_SIMD_NEON)
+  static inline uint8x16_t OCLBP_bit_neon(uint8x16_t c, const unsigned char* p, unsigned char bit)
+  {
+    return vandq_u8(vcgtq_u8(c, vld1q_u8(p)), vdupq_n_u8(bit));
+  }
 
-      outputImage[i] = cv::Mat(heightIn, widthIn, CV_8UC1);
-      for (int iRow = 0; iRow < inputImage[i].rows; iRow++)
-      {
-        for (int iCol = 0; iCol < inputImage[i].cols; iCol++)
-        {
-          inputImage[i].data[iCol + iRow * inputImage[i].step] = in.data[iCol * channels + iCurrNeighClr + iRow * in.step];
-        }
-      }
+  static inline uint8x16_t OCLBP_code_neon(uint8x16_t c, const OCLBP_rows& n, int j, const unsigned char* bits)
+  {
+    uint8x16_t code = OCLBP_bit_neon(c, n.up + j - 1, bits[0]);
+    code = vorrq_u8(code, OCLBP_bit_neon(c, n.up + j, bits[1]));
+    code = vorrq_u8(code, OCLBP_bit_neon(c, n.up + j + 1, bits[2]));
+    code = vorrq_u8(code, OCLBP_bit_neon(c, n.mid + j - 1, bits[3]));
+    code = vorrq_u8(code, OCLBP_bit_neon(c, n.mid + j + 1, bits[4]));
+    code = vorrq_u8(code, OCLBP_bit_neon(c, n.down + j - 1, bits[5]));
+    code = vorrq_u8(code, OCLBP_bit_neon(c, n.down + j, bits[6]));
+    code = vorrq_u8(code, OCLBP_bit_neon(c, n.down + j + 1, bits[7]));
+    return code;
+  }
 
-      for (int iRow = filterR[0]; iRow < (inputImage[i].rows - filterR[0]); iRow++)
-      {
-        for (int iCol = filterR[1]; iCol < (inputImage[i].cols - filterR[1]); iCol++)
-        {
-          // crop image according to filter's dimensions
-          cv::Mat subImg(filter[1], filter[0], CV_8UC1);
-          cv::Rect roi = cv::Rect(iCol - filterR[0], iRow - filterR[1], filter[0], filter[1]);
-          inputImage[i](roi).copyTo(subImg);
-
-          // find differences between current pixel, and it's neighours
-          int element = in.data[iCol * channels + iCurrCenterClr + iRow * in.step];
-          cv::Mat replicatedElement(1, nNeighbours, CV_32FC1, cv::Scalar(element));
-
-          int cnt = 0;
-          for (int k = 0; k < neightMat.rows * neightMat.cols; k++)
-          {
-            if (neightMat.data[k] == 1)
-            {
-              subImgMaskedData[cnt] = subImg.data[k];
-              cnt++;
-            }
-          }
-
-          diffVec = replicatedElement - subImgMasked;
-          diffVecPositive = diffVec > 0;
-
-          outputImage[i].data[iCol + iRow*outputImage[i].step] = product8(diffVecPositive, weightVec, nNeighbours);
-        }
-      }
+  static int OCLBP_row_neon(const OCLBP_rows* plane, unsigned char** out, int j, int width)
+  {
+    for (; j <= width - 16; j += 16) {
+      uint8x16_t c[3];
+      for (int p = 0; p < 3; p++)
+        c[p] = vld1q_u8(plane[p].mid + j);
+      for (int k = 0; k < 6; k++)
+        vst1q_u8(out[k] + j, OCLBP_code_neon(c[OCLBP_comb[k][0]], plane[OCLBP_comb[k][1]], j, k < 3 ? OCLBP_helix : OCLBP_raster));
     }
-
-    // crop the margins resulting from zero padding
-    for (int i = 0; i < nComb; i++)
-      outputImage[i](cv::Rect(1, 1, out[i].cols, out[i].rows)).copyTo(out[i]);
+    return j;
   }
+#endif
 
   void OCLBP::run(const cv::Mat &input, std::vector<cv::Mat> &OCLBP)
   {
-    if (input.empty())
-      return;
-
-    int height = input.size().height;
-    int width = input.size().width;
-    int channels = input.channels();
-
-    // convert OpenCV's BGR style to Matlab's RGB style
-    cv::Mat imageRGBToAlignWithMatlab;
-    cv::cvtColor(input, imageRGBToAlignWithMatlab, cv::COLOR_BGR2RGB);
-
-    // go on with Matlab style RGB to be able to compare results with Matlab
-    imageRGBToAlignWithMatlab.copyTo(input);
-
-    // verify filter dimensions are odd, so a middle element always exists
-    assert(filtDimsX == (filtDimsX + 1 - filtDimsX % 2));
-    assert(filtDimsY == (filtDimsY + 1 - filtDimsY % 2));
-
-    // Primitive pixelwise solution
-    int filtDims[2] = { filtDimsX, filtDimsY };
-    int filtDimsR[2] = { static_cast<int>(floor(filtDimsX / 2.)), static_cast<int>(floor(filtDimsY / 2.)) };
+    OCLBP::run(input, OCLBP, context);
+  }
 
-    // padd image with zeroes to deal with the edges
-    cv::Mat paddedImage = input;
-    cv::copyMakeBorder(input, paddedImage, filtDimsR[0], filtDimsR[0], filtDimsR[0], filtDimsR[0], cv::BORDER_CONSTANT, 0x00);
+  void OCLBP::run(const cv::Mat &input, std::vector<cv::Mat> &OCLBP, LBPContext &context)
+  {
+    if (input.empty() || input.type() != CV_8UC3)
+      return;
 
-    int nComb = 2 * channels;
-    int chnsComb[6][2] = { { 1, 1 }, { 2, 2 }, { 3, 3 }, { 1, 2 }, { 1, 3 }, { 2, 3 } };
+    const int rows = input.rows;
+    const int cols = input.cols;
+    const SimdLevel level = simdLevel();
+
+    // split BGR once into zero-padded planes, kept in the context while the frame
+    // size does not change; the border is cleared again in case the context is shared
+    cv::Mat planes[3], bgr[3];
+    for (int p = 0; p < 3; p++) {
+      planes[p] = context.mat(p, rows + 2, cols + 2, CV_8UC1);
+      planes[p].row(0).setTo(cv::Scalar(0));
+      planes[p].row(rows + 1).setTo(cv::Scalar(0));
+      planes[p].col(0).setTo(cv::Scalar(0));
+      planes[p].col(cols + 1).setTo(cv::Scalar(0));
+      bgr[p] = planes[p](cv::Rect(1, 1, cols, rows));
+    }
+    cv::split(input, bgr);
 
-    // create output background model   
-    //std::vector<cv::Mat> oclbp(nComb);
-    OCLBP = std::vector<cv::Mat>(nComb);
-    for (int i = 0; i < nComb; i++)
-      OCLBP[i] = cv::Mat(height, width, CV_8UC1, cv::Scalar::all(0));
+    OCLBP.resize(6);
+    for (int k = 0; k < 6; k++)
+      OCLBP[k].create(rows, cols, CV_8UC1);
 
-    // compute OCLBP 
-    processOCLBP(paddedImage, OCLBP, filtDims, filtDimsR, nComb, chnsComb, isEfficient);
+    for (int i = 0; i < rows; i++)
+    {
+      // planes are indexed in R, G, B order
+      OCLBP_rows plane[3];
+      for (int p = 0; p < 3; p++) {
+        const cv::Mat& m = planes[2 - p];
+        plane[p].up = m.ptr<unsigned char>(i) + 1;
+        plane[p].mid = m.ptr<unsigned char>(i + 1) + 1;
+        plane[p].down = m.ptr<unsigned char>(i + 2) + 1;
+      }
+      unsigned char* out[6];
+      for (int k = 0; k < 6; k++)
+        out[k] = OCLBP[k].ptr<unsigned char>(i);
+
+      int j = 0;
+#if defined(LBP_SIMD_X86)
+      if (level == SIMD_256)
+        j = OCLBP_row_avx2(plane, out, j, cols);
+      else if (level == SIMD_128)
+        j = OCLBP_row_sse41(plane, out, j, cols);
+#elif defined(LBP_SIMD_NEON)
+      if (level != SIMD_SCALAR)
+        j = OCLBP_row_neon(plane, out, j, cols);
+#endif
+      OCLBP_row(plane, out, j, cols);
+    }
   }
 }
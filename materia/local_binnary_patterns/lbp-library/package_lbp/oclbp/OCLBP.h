@@ -8,15 +8,12 @@ namespace lbplibrary
 {
   class OCLBP : public LBP
   {
-  private:
-    int isEfficient;
-    int filtDimsX;
-    int filtDimsY;
-
   public:
     OCLBP();
     ~OCLBP();
 
+    using LBP::run;
     void run(const cv::Mat &img_input, std::vector<cv::Mat> &vec_output);
+    void run(const cv::Mat &img_input, std::vector<cv::Mat> &vec_output, LBPContext &context);
   };
 }
@@ -3,59 +3,174 @@
 #include <algorithm>
 
 #include "OLBP.h"
+#include "../simd/SIMD.h"
 
 namespace lbplibrary
 {
-  OLBP::OLBP()
+  OLBP::OLBP(LBPMapping mapping) : mapping(mapping), table(mappingTable(mapping, 8))
   {
-    std::cout << "OLBP()" << std::endl;
   }
 
   OLBP::~OLBP()
   {
-    std::cout << "~OLBP()" << std::endl;
   }
 
+  // one output row; column j of out is centred on column j + 1 of mid
+  template <typename _Tp>
+  static void OLBP_row_(const _Tp* up, const _Tp* mid, const _Tp* down, unsigned char* out, int j, int width)
+  {
+    for (; j < width; j++) {
+      _Tp center = mid[j + 1];
+      unsigned char code = 0;
+      code |= (up[j] > center) << 7;
+      code |= (up[j + 1] > center) << 6;
+      code |= (up[j + 2] > center) << 5;
+      code |= (mid[j + 2] > center) << 4;
+      code |= (down[j + 2] > center) << 3;
+      code |= (down[j + 1] > center) << 2;
+      code |= (down[j] > center) << 1;
+      code |= (mid[j] > center) << 0;
+      out[j] = code;
+    }
+  }
+
+  // maps a freshly computed row of codes to bins while it is still in cache
+  static inline void OLBP_map_row(unsigned char* out, int width, const unsigned short* table)
+  {
+    if (table)
+      for (int j = 0; j < width; j++)
+        out[j] = static_cast<unsigned char>(table[out[j]]);
+  }
+
+#if defined(LBP_SIMD_X86)
+  // SSE/AVX2 only have signed byte compares, so both sides are biased by 0x80
+  LBP_TARGET_SSE41 static inline __m128i OLBP_bit_sse(const unsigned char* p, __m128i center, char bit)
+  {
+    __m128i v = _mm_xor_si128(_mm_loadu_si128((const __m128i*)p), _mm_set1_epi8((char)0x80));
+    return _mm_and_si128(_mm_cmpgt_epi8(v, center), _mm_set1_epi8(bit));
+  }
+
+  LBP_TARGET_SSE41 static int OLBP_row_sse41(const unsigned char* up, const unsigned char* mid, const unsigned char* down, unsigned char* out, int width)
+  {
+    int j = 0;
+    for (; j <= width - 16; j += 16) {
+      __m128i center = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(mid + j + 1)), _mm_set1_epi8((char)0x80));
+      __m128i code = OLBP_bit_sse(up + j, center, (char)0x80);
+      code = _mm_or_si128(code, OLBP_bit_sse(up + j + 1, center, 0x40));
+      code = _mm_or_si128(code, OLBP_bit_sse(up + j + 2, center, 0x20));
+      code = _mm_or_si128(code, OLBP_bit_sse(mid + j + 2, center, 0x10));
+      code = _mm_or_si128(code, OLBP_bit_sse(down + j + 2, center, 0x08));
+      code = _mm_or_si128(code, OLBP_bit_sse(down + j + 1, center, 0x04));
+      code = _mm_or_si128(code, OLBP_bit_sse(down + j, center, 0x02));
+      code = _mm_or_si128(code, OLBP_bit_sse(mid + j, center, 0x01));
+      _mm_storeu_si128((__m128i*)(out + j), code);
+    }
+    return j;
+  }
+
+  LBP_TARGET_AVX2 static inline __m256i OLBP_bit_avx2(const unsigned char* p, __m256i center, char bit)
+  {
+    __m256i v = _mm256_xor_si256(_mm256_loadu_si256((const __m256i*)p), _mm256_set1_epi8((char)0x80));
+    return _mm256_and_si256(_mm256_cmpgt_epi8(v, center), _mm256_set1_epi8(bit));
+  }
+
+  LBP_TARGET_AVX2 static int OLBP_row_avx2(const unsigned char* up, const unsigned char* mid, const unsigned char* down, unsigned char* out, int width)
+  {
+    int j = 0;
+    for (; j <= width - 32; j += 32) {
+      __m256i center = _mm256_xor_si256(_mm256_loadu_si256((const __m256i*)(mid + j + 1)), _mm256_set1_epi8((char)0x80));
+      __m256i code = OLBP_bit_avx2(up + j, center, (char)0x80);
+      code = _mm256_or_si256(code, OLBP_bit_avx2(up + j + 1, center, 0x40));
+      code = _mm256_or_si256(code, OLBP_bit_avx2(up + j + 2, center, 0x20));
+      code = _mm256_or_si256(code, OLBP_bit_avx2(mid + j + 2, center, 0x10));
+      code = _mm256_or_si256(code, OLBP_bit_avx2(down + j + 2, center, 0x08));
+      code = _mm256_or_si256(code, OLBP_bit_avx2(down + j + 1, center, 0x04));
+      code = _mm256_or_si256(code, OLBP_bit_avx2(down + j, center, 0x02));
+      code = _mm256_or_si256(code, OLBP_bit_avx2(mid + j, center, 0x01));
+      _mm256_storeu_si256((__m256i*)(out + j), code);
+    }
+    // finish with a 16-wide step before the scalar tail
+    return j + OLBP_row_sse41(up + j, mid + j, down + j, out + j, width - j);
+  }
+#elif defined(LBP_SIMD_NEON)
+  static inline uint8x16_t OLBP_bit_neon(const unsigned char* p, uint8x16_t center, unsigned char bit)
+  {
+    return vandq_u8(vcgtq_u8(vld1q_u8(p), center), vdupq_n_u8(bit));
+  }
+
+  static int OLBP_row_neon(const unsigned char* up, const unsigned char* mid, const unsigned char* down, unsigned char* out, int width)
+  {
+    int j = 0;
+    for (; j <= width - 16; j += 16) {
+      uint8x16_t center = vld1q_u8(mid + j + 1);
+      uint8x16_t code = OLBP_bit_neon(up + j, center, 0x80);
+      code = vorrq_u8(code, OLBP_bit_neon(up + j + 1, center, 0x40));
+      code = vorrq_u8(code, OLBP_bit_neon(up + j + 2, center, 0x20));
+      code = vorrq_u8(code, OLBP_bit_neon(mid + j + 2, center, 0x10));
+      code = vorrq_u8(code, OLBP_bit_neon(down + j + 2, center, 0x08));
+      code = vorrq_u8(code, OLBP_bit_neon(down + j + 1, center, 0x04));
+      code = vorrq_u8(code, OLBP_bit_neon(down + j, center, 0x02));
+      code = vorrq_u8(code, OLBP_bit_neon(mid + j, center, 0x01));
+      vst1q_u8(out + j, code);
+    }
+    return j;
+  }
+#endif
+
   template <typename _Tp>
   void OLBP::OLBP_(const cv::Mat& src, cv::Mat& dst)
   {
-    dst = cv::Mat::zeros(src.rows - 2, src.cols - 2, CV_8UC1);
+    dst.create(src.rows - 2, src.cols - 2, CV_8UC1);
+    for (int i = 1; i < src.rows - 1; i++) {
+      OLBP_row_<_Tp>(src.ptr<_Tp>(i - 1), src.ptr<_Tp>(i), src.ptr<_Tp>(i + 1), dst.ptr<unsigned char>(i - 1), 0, dst.cols);
+      OLBP_map_row(dst.ptr<unsigned char>(i - 1), dst.cols, table);
+    }
+  }
+
+  // 8-bit path: 16 (SSE4.1/NEON) or 32 (AVX2) centres per step, bit-exact with OLBP_<unsigned char>
+  void OLBP::OLBP_8u(const cv::Mat& src, cv::Mat& dst)
+  {
+    SimdLevel level = simdLevel();
+    if (level == SIMD_SCALAR) {
+      OLBP_<unsigned char>(src, dst);
+      return;
+    }
+
+    dst.create(src.rows - 2, src.cols - 2, CV_8UC1);
     for (int i = 1; i < src.rows - 1; i++) {
-      for (int j = 1; j < src.cols - 1; j++) {
-        _Tp center = src.at<_Tp>(i, j);
-        unsigned char code = 0;
-        code |= (src.at<_Tp>(i - 1, j - 1) > center) << 7;
-        code |= (src.at<_Tp>(i - 1, j) > center) << 6;
-        code |= (src.at<_Tp>(i - 1, j + 1) > center) << 5;
-        code |= (src.at<_Tp>(i, j + 1) > center) << 4;
-        code |= (src.at<_Tp>(i + 1, j + 1) > center) << 3;
-        code |= (src.at<_Tp>(i + 1, j) > center) << 2;
-        code |= (src.at<_Tp>(i + 1, j - 1) > center) << 1;
-        code |= (src.at<_Tp>(i, j - 1) > center) << 0;
-        dst.at<unsigned char>(i - 1, j - 1) = code;
-      }
+      const unsigned char* up = src.ptr<unsigned char>(i - 1);
+      const unsigned char* mid = src.ptr<unsigned char>(i);
+      const unsigned char* down = src.ptr<unsigned char>(i + 1);
+      unsigned char* out = dst.ptr<unsigned char>(i - 1);
+      int j = 0;
+#if defined(LBP_SIMD_X86)
+      j = (level == SIMD_256) ? OLBP_row_avx2(up, mid, down, out, dst.cols) : OLBP_row_sse41(up, mid, down, out, dst.cols);
+#elif defined(LBP_SIMD_NEON)
+      j = OLBP_row_neon(up, mid, down, out, dst.cols);
+#endif
+      OLBP_row_<unsigned char>(up, mid, down, out, j, dst.cols);
+      OLBP_map_row(out, dst.cols, table);
     }
   }
 
   void OLBP::run(const cv::Mat &img_input, cv::Mat &img_output)
+  {
+    OLBP::run(img_input, img_output, context);
+  }
+
+  void OLBP::run(const cv::Mat &img_input, cv::Mat &img_output, LBPContext &context)
   {
     if (img_input.empty())
       return;
 
     //int height = img_input.size().height;
     //int width = img_input.size().width;
-    int channels = img_input.channels();
-
-    cv::Mat img_gray;
-    if (channels > 1)
-      cv::cvtColor(img_input, img_gray, cv::COLOR_BGR2GRAY);
-    else
-      img_input.copyTo(img_gray);
+    cv::Mat img_gray = context.gray(img_input, img_output);
 
     switch (img_gray.type())
     {
       case CV_8SC1: OLBP_<char>(img_gray, img_output); break;
-      case CV_8UC1: OLBP_<unsigned char>(img_gray, img_output); break;
+      case CV_8UC1: OLBP_8u(img_gray, img_output); break;
       case CV_16SC1: OLBP_<short>(img_gray, img_output); break;
       case CV_16UC1: OLBP_<unsigned short>(img_gray, img_output); break;
       case CV_32SC1: OLBP_<int>(img_gray, img_output); break;
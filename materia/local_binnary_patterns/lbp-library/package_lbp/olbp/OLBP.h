@@ -2,19 +2,32 @@
 #include <opencv2/opencv.hpp>
 
 #include "../LBP.h"
+#include "../mapping/Mapping.h"
 
 namespace lbplibrary
 {
   class OLBP : public LBP
   {
   private:
+    LBPMapping mapping;
+    const unsigned short* table; // code -> bin, 0 for raw codes
+
     template <typename _Tp>
     void OLBP_(const cv::Mat& src, cv::Mat& dst);
+    void OLBP_8u(const cv::Mat& src, cv::Mat& dst);
 
   public:
-    OLBP();
+    OLBP(LBPMapping mapping = LBP_MAPPING_NONE);
     ~OLBP();
 
+    using LBP::run;
     void run(const cv::Mat &img_input, cv::Mat &img_output);
+    void run(const cv::Mat &img_input, cv::Mat &img_output, LBPContext &context);
+
+    // histogram bins of the output codes
+    int numPatterns() const { return mappingBins(mapping, 8); }
+
+    int halo() const { return 1; }
+    LBPBorder border() const { return LBP_BORDER_CROP; }
   };
 }
@@ -0,0 +1,167 @@
+#include <iostream>
+#include <algorithm>
+
+#include "ParallelLBP.h"
+
+namespace lbplibrary
+{
+  ParallelLBP::ParallelLBP(LBP* lbp, int stripes) : lbp(lbp), stripes(stripes), inputType(-1)
+  {
+  }
+
+  ParallelLBP::~ParallelLBP()
+  {
+    delete lbp;
+  }
+
+  // computes the output rows [first[s], first[s + 1]) of stripe s
+  class ParallelLBPStripe : public cv::ParallelLoopBody
+  {
+  private:
+    LBP* lbp;
+    const cv::Mat& input;
+    const std::vector<int>& first;
+    std::vector<cv::Mat>& parts;
+    std::vector<LBPContext>& contexts;
+
+  public:
+    ParallelLBPStripe(LBP* lbp, const cv::Mat& input, const std::vector<int>& first, std::vector<cv::Mat>& parts,
+      std::vector<LBPContext>& contexts)
+      : lbp(lbp), input(input), first(first), parts(parts), contexts(contexts) {}
+
+    void operator()(const cv::Range& range) const
+    {
+      for (int s = range.start; s < range.end; s++)
+      {
+        int a = first[s], b = first[s + 1];
+        int top, bottom, offset;
+        lbp->stripeRows(input.rows, a, b, top, bottom, offset);
+
+        // each stripe has its own buffers, so the operator's own ones are never shared;
+        // the rows that saw the stripe edges instead of the image are dropped
+        cv::Mat& result = contexts[s].output();
+        lbp->run(input.rowRange(top, bottom), result, contexts[s]);
+        parts[s] = result.empty() ? cv::Mat() : result.rowRange(offset, offset + b - a);
+      }
+    }
+  };
+
+  class ParallelLBPCopy : public cv::ParallelLoopBody
+  {
+  private:
+    const std::vector<int>& first;
+    const std::vector<cv::Mat>& parts;
+    cv::Mat& output;
+
+  public:
+    ParallelLBPCopy(const std::vector<int>& first, const std::vector<cv::Mat>& parts, cv::Mat& output)
+      : first(first), parts(parts), output(output) {}
+
+    void operator()(const cv::Range& range) const
+    {
+      for (int s = range.start; s < range.end; s++) {
+        cv::Mat dst = output.rowRange(first[s], first[s + 1]);
+        parts[s].copyTo(dst);
+      }
+    }
+  };
+
+  void ParallelLBP::run(const cv::Mat &input, cv::Mat &output)
+  {
+    if (input.empty())
+      return;
+
+    const int halo = lbp->halo();
+    const int rows = lbp->codeSize(input.size()).height;
+
+    // several stripes per thread for load balance, but tall enough that the
+    // halo rows computed twice stay a small fraction of the work
+    int n = stripes > 0 ? stripes : 4 * cv::getNumThreads();
+    n = std::min(n, rows / std::max(16, 4 * halo));
+    if (halo < 0 || n < 2) {
+      lbp->run(input, output);
+      return;
+    }
+
+    // the stripe buffers are kept for the next frame; a new input type starts them
+    // afresh, so an operator that leaves its output alone cannot hand back stale codes
+    if (input.type() != inputType) {
+      contexts.clear();
+      inputType = input.type();
+    }
+    first.resize(n + 1);
+    parts.resize(n);
+    contexts.resize(n);
+    for (int s = 0; s <= n; s++)
+      first[s] = static_cast<int>(static_cast<long long>(rows) * s / n);
+
+    cv::parallel_for_(cv::Range(0, n), ParallelLBPStripe(lbp, input, first, parts, contexts));
+    for (int s = 0; s < n; s++)
+      if (parts[s].empty())
+        return; // type not handled by the operator
+
+    output.create(rows, parts[0].cols, parts[0].type());
+    cv::parallel_for_(cv::Range(0, n), ParallelLBPCopy(first, parts, output));
+  }
+
+  void ParallelLBP::run(const cv::Mat &input, std::vector<cv::Mat> &output)
+  {
+    // the multi-plane operators (OCLBP) keep per-frame state and are run as a whole
+    lbp->run(input, output);
+  }
+
+  class LBPRowStripes : public cv::ParallelLoopBody
+  {
+  private:
+    const LBPRowKernel& kernel;
+    const int* first;
+    int* hists;
+    int bins;
+
+  public:
+    LBPRowStripes(const LBPRowKernel& kernel, const int* first, int* hists, int bins)
+      : kernel(kernel), first(first), hists(hists), bins(bins) {}
+
+    void operator()(const cv::Range& range) const
+    {
+      for (int s = range.start; s < range.end; s++)
+        kernel.rows(first[s], first[s + 1], hists ? hists + (size_t)s * bins : 0);
+    }
+  };
+
+  void runRowStripes(const LBPRowKernel& kernel, int first, int last, int stripes, cv::Mat* hist, int bins)
+  {
+    const int rows = std::max(last - first, 0);
+    int n = stripes > 0 ? stripes : 4 * cv::getNumThreads();
+    n = std::max(1, std::min(n, rows / 16));
+
+    if (hist) {
+      hist->create(1, bins, CV_32SC1);
+      hist->setTo(cv::Scalar(0));
+    }
+    if (n == 1) {
+      int bounds[2] = { first, last };
+      LBPRowStripes(kernel, bounds, hist ? hist->ptr<int>() : 0, bins)(cv::Range(0, 1));
+      return;
+    }
+
+    cv::AutoBuffer<int> bounds(n + 1);
+    for (int s = 0; s <= n; s++)
+      bounds[s] = first + static_cast<int>(static_cast<long long>(rows) * s / n);
+
+    // one histogram per stripe, so the stripes never share a counter
+    cv::AutoBuffer<int> hists(hist ? (size_t)n * bins : 1);
+    if (hist)
+      std::fill(hists.data(), hists.data() + (size_t)n * bins, 0);
+    cv::parallel_for_(cv::Range(0, n), LBPRowStripes(kernel, bounds.data(), hist ? hists.data() : 0, bins));
+
+    if (hist) {
+      int* h = hist->ptr<int>();
+      for (int s = 0; s < n; s++) {
+        const int* p = hists.data() + (size_t)s * bins;
+        for (int b = 0; b < bins; b++)
+          h[b] += p[b];
+      }
+    }
+  }
+}
@@ -0,0 +1,53 @@
+#include <iostream>
+#include <opencv2/opencv.hpp>
+
+#include "../LBP.h"
+
+namespace lbplibrary
+{
+  // Runs another operator over horizontal stripes of the image on the OpenCV thread pool.
+  // Each stripe is handed to the operator together with halo() extra rows above and below,
+  // and only the rows that do not depend on the stripe edges are kept, so the result is the
+  // same as one call over the whole image for every border type. Operators that report a
+  // negative halo() are run on the whole image in the calling thread.
+  class ParallelLBP : public LBP
+  {
+  private:
+    LBP* lbp;
+    int stripes;
+    // per-stripe state, reused while the frames keep their geometry
+    int inputType;
+    std::vector<int> first;
+    std::vector<cv::Mat> parts;
+    std::vector<LBPContext> contexts;
+
+  public:
+    // takes ownership of lbp; stripes <= 0 picks a count from cv::getNumThreads()
+    ParallelLBP(LBP* lbp, int stripes = 0);
+    ~ParallelLBP();
+    // the operator is owned, so a copy would delete it twice
+    ParallelLBP(const ParallelLBP&) = delete;
+    ParallelLBP& operator=(const ParallelLBP&) = delete;
+
+    using LBP::run;
+    void run(const cv::Mat &img_input, cv::Mat &img_output);
+    void run(const cv::Mat &img_input, std::vector<cv::Mat> &vec_output);
+
+    int halo() const { return lbp->halo(); }
+    LBPBorder border() const { return lbp->border(); }
+  };
+
+  // code rows of an operator with a built-in row-stripe mode (XCSLBP, BGLBP)
+  class LBPRowKernel
+  {
+  public:
+    virtual ~LBPRowKernel() {}
+    // computes the code rows [first, last) and counts them in hist, unless it is 0
+    virtual void rows(int first, int last, int* hist) const = 0;
+  };
+
+  // runs kernel over stripes of the rows [first, last) on the OpenCV thread pool, each
+  // stripe with its own histogram, and sums those into hist (1 x bins, CV_32SC1) when given.
+  // stripes <= 0 picks a count from cv::getNumThreads(); 1 runs in the calling thread
+  void runRowStripes(const LBPRowKernel& kernel, int first, int last, int stripes, cv::Mat* hist = 0, int bins = 0);
+}
@@ -0,0 +1,127 @@
+#include <algorithm>
+
+#include "LBPPyramid.h"
+#include "../elbp/ELBP.h"
+
+namespace lbplibrary
+{
+  LBPPyramid::LBPPyramid(int gridx, int gridy, LBPMapping mapping)
+    : gridx(std::max(gridx, 1)), gridy(std::max(gridy, 1)), mapping(mapping), size(0)
+  {
+  }
+
+  LBPPyramid::~LBPPyramid()
+  {
+    for (size_t s = 0; s < scales_.size(); s++)
+      delete scales_[s].op;
+  }
+
+  void LBPPyramid::add(int radius, int neighbors, int octave)
+  {
+    if (octave < 0)
+      CV_Error(cv::Error::StsBadArg, "Octaves start at 0.");
+    if (mapping == LBP_MAPPING_NONE && neighbors > 16)
+      CV_Error(cv::Error::StsBadArg, "Raw codes of more than 16 neighbours have too many bins for a histogram.");
+
+    Scale scale;
+    scale.op = new ELBP(radius, neighbors, mapping);
+    scale.radius = scale.op->halo();
+    scale.octave = octave;
+    scale.numPatterns = scale.op->numPatterns();
+    scale.offset = size;
+    scales_.push_back(scale);
+    size += gridx * gridy * scale.numPatterns;
+  }
+
+  void LBPPyramid::addOctaves(int octaves, int radius, int neighbors)
+  {
+    for (int octave = 0; octave < octaves; octave++)
+      add(radius, neighbors, octave);
+  }
+
+  // adds the codes to the histograms of their cells, then divides every cell by its area.
+  // ELBP codes are below numPatterns (2^neighbors raw, the table size mapped); anything else
+  // is skipped rather than written outside the cell
+  static void bin_cells(const cv::Mat& codes, int gridx, int gridy, int numPatterns, float* hist)
+  {
+    std::fill(hist, hist + (size_t)gridx * gridy * numPatterns, 0.0f);
+    if (codes.rows < gridy || codes.cols < gridx)
+      return;
+    if (codes.type() != CV_32SC1)
+      CV_Error(cv::Error::StsBadArg, "ELBP codes must be CV_32SC1.");
+
+    for (int cy = 0; cy < gridy; cy++) {
+      const int top = codes.rows * cy / gridy, bottom = codes.rows * (cy + 1) / gridy;
+      for (int cx = 0; cx < gridx; cx++) {
+        const int left = codes.cols * cx / gridx, right = codes.cols * (cx + 1) / gridx;
+        float* cell = hist + (size_t)(cx * gridy + cy) * numPatterns;
+        for (int i = top; i < bottom; i++) {
+          const int* c = codes.ptr<int>(i);
+          for (int j = left; j < right; j++)
+            if ((unsigned)c[j] < (unsigned)numPatterns)
+              cell[c[j]] += 1.0f;
+        }
+        const float scale = 1.0f / ((bottom - top) * (right - left));
+        for (int b = 0; b < numPatterns; b++)
+          cell[b] *= scale;
+      }
+    }
+  }
+
+  class LBPPyramidScales : public cv::ParallelLoopBody
+  {
+  private:
+    std::vector<LBPPyramid::Scale>& scales;
+    const std::vector<cv::Mat>& levels;
+    int gridx, gridy;
+    float* descriptor;
+
+  public:
+    LBPPyramidScales(std::vector<LBPPyramid::Scale>& scales, const std::vector<cv::Mat>& levels, int gridx, int gridy, float* descriptor)
+      : scales(scales), levels(levels), gridx(gridx), gridy(gridy), descriptor(descriptor) {}
+
+    void operator()(const cv::Range& range) const
+    {
+      for (int s = range.start; s < range.end; s++) {
+        // each scale only touches its own buffers and slice of the descriptor
+        LBPPyramid::Scale& scale = scales[s];
+        const cv::Mat& level = levels[scale.octave];
+        if (level.rows > 2 * scale.radius && level.cols > 2 * scale.radius)
+          scale.op->run(level, scale.codes, scale.context);
+        else
+          scale.codes.release();
+        bin_cells(scale.codes, gridx, gridy, scale.numPatterns, descriptor + scale.offset);
+      }
+    }
+  };
+
+  void LBPPyramid::compute(const cv::Mat& image, cv::Mat& descriptor)
+  {
+    descriptor.create(1, size, CV_32FC1);
+    if (image.empty() || scales_.empty()) {
+      descriptor.setTo(cv::Scalar(0));
+      return;
+    }
+
+    int octaves = 0;
+    for (size_t s = 0; s < scales_.size(); s++)
+      octaves = std::max(octaves, scales_[s].octave + 1);
+    levels.resize(octaves);
+    levels[0] = context.gray(image, cv::Mat());
+    for (int k = 1; k < octaves; k++) {
+      if (levels[k - 1].rows > 1 && levels[k - 1].cols > 1)
+        cv::pyrDown(levels[k - 1], levels[k]);
+      else
+        levels[k].release();
+    }
+
+    cv::parallel_for_(cv::Range(0, scales()), LBPPyramidScales(scales_, levels, gridx, gridy, descriptor.ptr<float>()));
+  }
+
+  cv::Mat LBPPyramid::compute(const cv::Mat& image)
+  {
+    cv::Mat descriptor;
+    compute(image, descriptor);
+    return descriptor;
+  }
+}
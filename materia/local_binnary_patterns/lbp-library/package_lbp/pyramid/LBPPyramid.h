@@ -0,0 +1,72 @@
+#pragma once
+
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+#include "../LBP.h"
+#include "../mapping/Mapping.h"
+
+namespace lbplibrary
+{
+  class ELBP;
+
+  // Multi-scale ELBP descriptor in one call. The input is converted to gray once and halved
+  // into a Gaussian pyramid (octave 0 is the input itself); each scale then runs ELBP with its
+  // own (radius, neighbors) on one octave and bins the codes into a gridx x gridy grid of
+  // cells, straight into its slice of the descriptor. The sampling tables are built by add(),
+  // and the pyramid levels, code images and scratch buffers are kept for the next image of
+  // the same size, so a sequence of images costs no allocation after the first. The scales
+  // are computed in parallel.
+  class LBPPyramid
+  {
+  public:
+    // mappings need neighbors = 4, 8 or 16; raw codes are limited to 16 neighbours
+    LBPPyramid(int gridx = 4, int gridy = 4, LBPMapping mapping = LBP_MAPPING_U2);
+    ~LBPPyramid();
+    // the ELBP of every scale is owned, so a copy would delete them twice
+    LBPPyramid(const LBPPyramid&) = delete;
+    LBPPyramid& operator=(const LBPPyramid&) = delete;
+
+    // adds ELBP(radius, neighbors) on pyramid level octave
+    void add(int radius, int neighbors, int octave = 0);
+    // the same operator on the octaves [0, octaves)
+    void addOctaves(int octaves, int radius = 1, int neighbors = 8);
+
+    int scales() const { return (int)scales_.size(); }
+    int numPatterns(int scale) const { return scales_[scale].numPatterns; }
+    // first bin of scale in the descriptor
+    int offset(int scale) const { return scales_[scale].offset; }
+    int descriptorSize() const { return size; }
+
+    // 1 x descriptorSize(), CV_32FC1: the scales in the order they were added, each one the
+    // histograms of its cells stored column by column (cell (x, y) at x * gridy + y) as in
+    // spatial_histogram(), every cell divided by its area. Cells of an octave too small for
+    // the operator, or of fewer pixels than the grid, are zero
+    void compute(const cv::Mat& image, cv::Mat& descriptor);
+    cv::Mat compute(const cv::Mat& image);
+
+    // state of the last compute()
+    const cv::Mat& level(int octave) const { return levels[octave]; }
+    const cv::Mat& codes(int scale) const { return scales_[scale].codes; }
+
+  private:
+    struct Scale
+    {
+      ELBP* op;
+      int radius;
+      int octave;
+      int numPatterns;
+      int offset;
+      cv::Mat codes;
+      LBPContext context;
+    };
+    friend class LBPPyramidScales;
+
+    int gridx, gridy;
+    LBPMapping mapping;
+    int size;
+    std::vector<Scale> scales_;
+    std::vector<cv::Mat> levels;
+    LBPContext context; // colour conversion
+  };
+}
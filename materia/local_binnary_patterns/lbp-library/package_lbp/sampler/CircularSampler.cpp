@@ -0,0 +1,54 @@
+#include "CircularSampler.h"
+
+#define _USE_MATH_DEFINES
+#include <math.h>
+
+namespace lbplibrary
+{
+  CircularSampler::CircularSampler(int radius, int neighbors) : radius_(0), neighbors_(0)
+  {
+    set(radius, neighbors);
+  }
+
+  void CircularSampler::set(int radius, int neighbors)
+  {
+    if (radius == radius_ && neighbors == neighbors_)
+      return;
+
+    radius_ = radius;
+    neighbors_ = neighbors;
+    points.resize(neighbors);
+    for (int n = 0; n < neighbors; n++) {
+      // sample points
+      float x = static_cast<float>(radius)* cos(2.0*M_PI*n / static_cast<float>(neighbors));
+      float y = static_cast<float>(radius)* -sin(2.0*M_PI*n / static_cast<float>(neighbors));
+      // relative indices
+      Point& p = points[n];
+      p.fx = static_cast<int>(floor(x));
+      p.fy = static_cast<int>(floor(y));
+      p.cx = static_cast<int>(ceil(x));
+      p.cy = static_cast<int>(ceil(y));
+      // fractional part
+      float ty = y - p.fy;
+      float tx = x - p.fx;
+      // set interpolation weights
+      p.w1 = (1 - tx) * (1 - ty);
+      p.w2 = tx  * (1 - ty);
+      p.w3 = (1 - tx) *      ty;
+      p.w4 = tx  *      ty;
+      // round the weights to Q12 and give the rounding error to the largest one,
+      // so that a flat neighbourhood still samples to exactly its value
+      const int one = 1 << FIXED_SHIFT;
+      p.q1 = cvRound(p.w1 * one);
+      p.q2 = cvRound(p.w2 * one);
+      p.q3 = cvRound(p.w3 * one);
+      p.q4 = cvRound(p.w4 * one);
+      int* q[4] = { &p.q1, &p.q2, &p.q3, &p.q4 };
+      int* largest = q[0];
+      for (int k = 1; k < 4; k++)
+        if (*q[k] > *largest)
+          largest = q[k];
+      *largest += one - (p.q1 + p.q2 + p.q3 + p.q4);
+    }
+  }
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+namespace lbplibrary
+{
+  // Sampling table for the circular operators (ELBP, VARLBP): the bilinear taps and
+  // weights of each neighbour are computed once per (radius, neighbors) instead of
+  // once per call, and a whole row of centres is then sampled from 2*radius+1 rows.
+  class CircularSampler
+  {
+  public:
+    // fractional bits of the integer weights used by the 8-bit fixed-point paths
+    static const int FIXED_SHIFT = 12;
+
+    struct Point
+    {
+      int fy, fx, cy, cx;     // relative indices of the four interpolation taps
+      float w1, w2, w3, w4;   // interpolation weights
+      int q1, q2, q3, q4;     // the same weights in Q12, summing exactly to 1 << FIXED_SHIFT
+    };
+
+    // the four tap pointers of one neighbour, bound to an output row
+    template <typename _Tp>
+    struct Taps
+    {
+      const _Tp* p1;
+      const _Tp* p2;
+      const _Tp* p3;
+      const _Tp* p4;
+    };
+
+    CircularSampler(int radius = 1, int neighbors = 8);
+
+    // rebuilds the table only when the parameters change
+    void set(int radius, int neighbors);
+
+    int radius() const { return radius_; }
+    int neighbors() const { return neighbors_; }
+    const Point& operator[](int n) const { return points[n]; }
+
+    // taps[n] point at the samples of output column 0 of output row i (source row i + radius)
+    template <typename _Tp>
+    void bind(const cv::Mat& src, int i, Taps<_Tp>* taps) const
+    {
+      for (int n = 0; n < neighbors_; n++) {
+        const Point& p = points[n];
+        const _Tp* rowf = src.ptr<_Tp>(i + radius_ + p.fy) + radius_;
+        const _Tp* rowc = src.ptr<_Tp>(i + radius_ + p.cy) + radius_;
+        taps[n].p1 = rowf + p.fx;
+        taps[n].p2 = rowf + p.cx;
+        taps[n].p3 = rowc + p.fx;
+        taps[n].p4 = rowc + p.cx;
+      }
+    }
+
+    // interpolated value of neighbour n at output column j
+    template <typename _Tp>
+    inline float sample(const Taps<_Tp>* taps, int n, int j) const
+    {
+      const Point& p = points[n];
+      const Taps<_Tp>& t = taps[n];
+      return p.w1*t.p1[j] + p.w2*t.p2[j] + p.w3*t.p3[j] + p.w4*t.p4[j];
+    }
+
+    // fixed-point interpolated value of neighbour n at output column j, scaled by 1 << FIXED_SHIFT
+    inline int sampleFixed(const Taps<unsigned char>* taps, int n, int j) const
+    {
+      const Point& p = points[n];
+      const Taps<unsigned char>& t = taps[n];
+      return p.q1*t.p1[j] + p.q2*t.p2[j] + p.q3*t.p3[j] + p.q4*t.p4[j];
+    }
+
+  private:
+    int radius_;
+    int neighbors_;
+    std::vector<Point> points;
+  };
+}
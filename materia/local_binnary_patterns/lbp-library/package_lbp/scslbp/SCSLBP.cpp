@@ -1,33 +1,231 @@
 #include <iostream>
 #include <assert.h>
 #include <algorithm>
+#include <cstring>
+#include <type_traits>
 
 #include "SCSLBP.h"
+#include "../simd/SIMD.h"
 
 namespace lbplibrary
 {
-  SCSLBP::SCSLBP() : radius(2), neighbors(4)
+  SCSLBP::SCSLBP(int radius, int neighbors)
+    : radius(std::max(radius, 1)), neighbors(std::max(std::min(neighbors, 8), 1)) // set bounds...
   {
-    std::cout << "SCSLBP()" << std::endl;
   }
 
   SCSLBP::~SCSLBP()
   {
-    std::cout << "~SCSLBP()" << std::endl;
+  }
+
+  // bilinear sample at a fixed offset from the block origin: one tap with weight 1 when the
+  // point falls on the pixel grid, else the four pixels around it weighted w[0..3]
+  struct SCSLBP_sample
+  {
+    int taps;
+    int y[4], x[4];
+    float w[4];
+  };
+
+  // same operation order as the Mat expression w1*I1 + w2*I2 + w3*I3 + w4*I4 it replaces
+  template <typename _Tp>
+  static inline float SCSLBP_value(const SCSLBP_sample& s, const _Tp* const* rows, int j)
+  {
+    if (s.taps == 1)
+      return static_cast<float>(rows[0][j]);
+    return ((s.w[0] * static_cast<float>(rows[0][j]) + s.w[1] * static_cast<float>(rows[1][j])) +
+      s.w[2] * static_cast<float>(rows[2][j])) + s.w[3] * static_cast<float>(rows[3][j]);
+  }
+
+  template <typename _Tp>
+  static void SCSLBP_row_(const cv::Mat& src, int i, const SCSLBP_sample* samples, int pairs, unsigned char* out, int j, int end)
+  {
+    const _Tp* rows[2][8][4];
+    for (int p = 0; p < 2 * pairs; p++)
+      for (int t = 0; t < samples[p].taps; t++)
+        rows[p / pairs][p % pairs][t] = src.ptr<_Tp>(i + samples[p].y[t]) + samples[p].x[t];
+
+    for (; j < end; j++) {
+      int code = 0;
+      for (int k = 0; k < pairs; k++)
+        code |= (SCSLBP_value<_Tp>(samples[k], rows[0][k], j) - SCSLBP_value<_Tp>(samples[k + pairs], rows[1][k], j) >= 0) << k;
+      out[j] = static_cast<unsigned char>(code);
+    }
+  }
+
+#if defined(LBP_SIMD_X86)
+  LBP_TARGET_SSE41 static inline __m128 SCSLBP_load_sse(const unsigned char* p)
+  {
+    int v;
+    memcpy(&v, p, sizeof(v));
+    return _mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_cvtsi32_si128(v)));
+  }
+
+  // 16-bit pixels convert to float exactly, so every type gives the scalar result
+  LBP_TARGET_SSE41 static inline __m128 SCSLBP_load_sse(const unsigned short* p)
+  {
+    return _mm_cvtepi32_ps(_mm_cvtepu16_epi32(_mm_loadl_epi64((const __m128i*)p)));
+  }
+
+  LBP_TARGET_SSE41 static inline __m128 SCSLBP_load_sse(const float* p)
+  {
+    return _mm_loadu_ps(p);
+  }
+
+  template <typename _Tp>
+  LBP_TARGET_SSE41 static inline __m128 SCSLBP_value_sse(const SCSLBP_sample& s, const _Tp* const* rows, int j)
+  {
+    if (s.taps == 1)
+      return SCSLBP_load_sse(rows[0] + j);
+    __m128 v = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(s.w[0]), SCSLBP_load_sse(rows[0] + j)), _mm_mul_ps(_mm_set1_ps(s.w[1]), SCSLBP_load_sse(rows[1] + j)));
+    v = _mm_add_ps(v, _mm_mul_ps(_mm_set1_ps(s.w[2]), SCSLBP_load_sse(rows[2] + j)));
+    return _mm_add_ps(v, _mm_mul_ps(_mm_set1_ps(s.w[3]), SCSLBP_load_sse(rows[3] + j)));
+  }
+
+  template <typename _Tp>
+  LBP_TARGET_SSE41 static int SCSLBP_row_sse41(const _Tp* rows[][8][4], const SCSLBP_sample* samples, int pairs, unsigned char* out, int j, int end)
+  {
+    for (; j <= end - 4; j += 4) {
+      __m128i code = _mm_setzero_si128();
+      for (int k = 0; k < pairs; k++) {
+        __m128 d = _mm_sub_ps(SCSLBP_value_sse(samples[k], rows[0][k], j), SCSLBP_value_sse(samples[k + pairs], rows[1][k], j));
+        code = _mm_or_si128(code, _mm_and_si128(_mm_castps_si128(_mm_cmpge_ps(d, _mm_setzero_ps())), _mm_set1_epi32(1 << k)));
+      }
+      code = _mm_packus_epi16(_mm_packs_epi32(code, code), code);
+      int bytes = _mm_cvtsi128_si32(code);
+      memcpy(out + j, &bytes, sizeof(bytes));
+    }
+    return j;
+  }
+
+  LBP_TARGET_AVX2 static inline __m256 SCSLBP_load_avx2(const unsigned char* p)
+  {
+    return _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)p)));
+  }
+
+  LBP_TARGET_AVX2 static inline __m256 SCSLBP_load_avx2(const unsigned short* p)
+  {
+    return _mm256_cvtepi32_ps(_mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)p)));
+  }
+
+  LBP_TARGET_AVX2 static inline __m256 SCSLBP_load_avx2(const float* p)
+  {
+    return _mm256_loadu_ps(p);
+  }
+
+  template <typename _Tp>
+  LBP_TARGET_AVX2 static inline __m256 SCSLBP_value_avx2(const SCSLBP_sample& s, const _Tp* const* rows, int j)
+  {
+    if (s.taps == 1)
+      return SCSLBP_load_avx2(rows[0] + j);
+    __m256 v = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(s.w[0]), SCSLBP_load_avx2(rows[0] + j)), _mm256_mul_ps(_mm256_set1_ps(s.w[1]), SCSLBP_load_avx2(rows[1] + j)));
+    v = _mm256_add_ps(v, _mm256_mul_ps(_mm256_set1_ps(s.w[2]), SCSLBP_load_avx2(rows[2] + j)));
+    return _mm256_add_ps(v, _mm256_mul_ps(_mm256_set1_ps(s.w[3]), SCSLBP_load_avx2(rows[3] + j)));
+  }
+
+  template <typename _Tp>
+  LBP_TARGET_AVX2 static int SCSLBP_row_avx2(const _Tp* rows[][8][4], const SCSLBP_sample* samples, int pairs, unsigned char* out, int j, int end)
+  {
+    for (; j <= end - 8; j += 8) {
+      __m256i code = _mm256_setzero_si256();
+      for (int k = 0; k < pairs; k++) {
+        __m256 d = _mm256_sub_ps(SCSLBP_value_avx2(samples[k], rows[0][k], j), SCSLBP_value_avx2(samples[k + pairs], rows[1][k], j));
+        code = _mm256_or_si256(code, _mm256_and_si256(_mm256_castps_si256(_mm256_cmp_ps(d, _mm256_setzero_ps(), _CMP_GE_OQ)), _mm256_set1_epi32(1 << k)));
+      }
+      __m128i words = _mm_packs_epi32(_mm256_castsi256_si128(code), _mm256_extracti128_si256(code, 1));
+      _mm_storel_epi64((__m128i*)(out + j), _mm_packus_epi16(words, words));
+    }
+    return SCSLBP_row_sse41(rows, samples, pairs, out, j, end);
+  }
+#elif defined(LBP_SIMD_NEON)
+  static inline float32x4_t SCSLBP_load_neon(const unsigned char* p, bool high)
+  {
+    uint16x8_t v = vmovl_u8(vld1_u8(p));
+    return vcvtq_f32_u32(vmovl_u16(high ? vget_high_u16(v) : vget_low_u16(v)));
+  }
+
+  static inline float32x4_t SCSLBP_load_neon(const unsigned short* p, bool high)
+  {
+    return vcvtq_f32_u32(vmovl_u16(vld1_u16(high ? p + 4 : p)));
+  }
+
+  static inline float32x4_t SCSLBP_load_neon(const float* p, bool high)
+  {
+    return vld1q_f32(high ? p + 4 : p);
+  }
+
+  template <typename _Tp>
+  static inline float32x4_t SCSLBP_value_neon(const SCSLBP_sample& s, const _Tp* const* rows, int j, bool high)
+  {
+    if (s.taps == 1)
+      return SCSLBP_load_neon(rows[0] + j, high);
+    // multiply and add kept apart so the rounding matches the scalar path
+    float32x4_t r = vaddq_f32(vmulq_n_f32(SCSLBP_load_neon(rows[0] + j, high), s.w[0]), vmulq_n_f32(SCSLBP_load_neon(rows[1] + j, high), s.w[1]));
+    r = vaddq_f32(r, vmulq_n_f32(SCSLBP_load_neon(rows[2] + j, high), s.w[2]));
+    return vaddq_f32(r, vmulq_n_f32(SCSLBP_load_neon(rows[3] + j, high), s.w[3]));
+  }
+
+  template <typename _Tp>
+  static int SCSLBP_row_neon(const _Tp* rows[][8][4], const SCSLBP_sample* samples, int pairs, unsigned char* out, int j, int end)
+  {
+    for (; j <= end - 8; j += 8) {
+      uint32x4_t code[2] = { vdupq_n_u32(0), vdupq_n_u32(0) };
+      for (int h = 0; h < 2; h++)
+        for (int k = 0; k < pairs; k++) {
+          float32x4_t d = vsubq_f32(SCSLBP_value_neon(samples[k], rows[0][k], j, h == 1), SCSLBP_value_neon(samples[k + pairs], rows[1][k], j, h == 1));
+          code[h] = vorrq_u32(code[h], vandq_u32(vcgeq_f32(d, vdupq_n_f32(0)), vdupq_n_u32(1 << k)));
+        }
+      vst1_u8(out + j, vmovn_u16(vcombine_u16(vmovn_u32(code[0]), vmovn_u32(code[1]))));
+    }
+    return j;
+  }
+#endif
+
+  // pixel types with vector code
+  template <typename _Tp> struct SCSLBP_vector : std::false_type {};
+  template <> struct SCSLBP_vector<unsigned char> : std::true_type {};
+  template <> struct SCSLBP_vector<unsigned short> : std::true_type {};
+  template <> struct SCSLBP_vector<float> : std::true_type {};
+
+  // vector code of row i from column j on; returns the first column left to the scalar loop
+  template <typename _Tp>
+  static int SCSLBP_row_simd(SimdLevel level, const cv::Mat& src, int i, const SCSLBP_sample* samples, int pairs, unsigned char* out, int j, int end, std::true_type)
+  {
+#if defined(LBP_SIMD_X86) || defined(LBP_SIMD_NEON)
+    if (level == SIMD_SCALAR)
+      return j;
+    // tap rows of each pair: [0] the first point, [1] the centre-symmetric one
+    const _Tp* rows[2][8][4];
+    for (int p = 0; p < 2 * pairs; p++)
+      for (int t = 0; t < samples[p].taps; t++)
+        rows[p / pairs][p % pairs][t] = src.ptr<_Tp>(i + samples[p].y[t]) + samples[p].x[t];
+#if defined(LBP_SIMD_X86)
+    return level == SIMD_256 ? SCSLBP_row_avx2(rows, samples, pairs, out, j, end) : SCSLBP_row_sse41(rows, samples, pairs, out, j, end);
+#else
+    return SCSLBP_row_neon(rows, samples, pairs, out, j, end);
+#endif
+#else
+    return j;
+#endif
+  }
+
+  template <typename _Tp>
+  static int SCSLBP_row_simd(SimdLevel level, const cv::Mat& src, int i, const SCSLBP_sample* samples, int pairs, unsigned char* out, int j, int end, std::false_type)
+  {
+    return j;
   }
 
   // compute the scs-lbp code image
+  template <typename _Tp>
   void SCSLBP::lbpcompute(const cv::Mat &input1, cv::Mat &LBPImage)
   {
     int neighbors_ = 2 * neighbors;
 
-    float y, x, yd, xd, v;
+    float y, x;
     int fy, fx, cy, cx, ry, rx;
-    int fyd, fxd, cyd, cxd, ryd, rxd;
     float miny = 999, minx = 999;
     float maxy = 0, maxx = 0;
-    //int mapping = 0;
-    float spoints[2][2 * 4];
+    float spoints[2][2 * 8];
 
     // angle step
     float a = 2 * CV_PI / neighbors_;
@@ -60,139 +258,90 @@ namespace lbplibrary
 
     // minimum allowed size for the input image depends on the radius of the used LBP operator
     if (input1.cols < bsizex || input1.rows < bsizey)
+    {
       std::cout << "Too small input image. Should be at least " << (2 * radius + 1) * (2 * radius + 1) << std::endl;
+      return;
+    }
 
     // calculate dx and dy
     int dx = input1.cols - bsizex + 1;
     int dy = input1.rows - bsizey + 1;
 
-    cv::Mat comImage, comImageCen;
-    cv::Rect roi = cv::Rect(origx, origy, dx, dy); // because of transalation of coord from matlab
-    input1(roi).copyTo(comImage);
-
-    comImageCen = comImage.clone();
-
-    cv::Mat result(dy, dx, CV_8UC1, cv::Scalar(0));        // sign LBP computing image
-    cv::Mat D(comImage.rows, comImage.cols, CV_8UC1);
-    cv::Mat Diff(comImage.rows, comImage.cols, CV_8UC1);
-
-    cv::Mat newImage(comImage.rows, comImage.cols, CV_32FC1);
-    cv::Mat newImageD(comImage.rows, comImage.cols, CV_32FC1);
-    cv::Mat inputFloat(input1.rows, input1.cols, CV_32FC1);
-    input1.convertTo(inputFloat, CV_32F);
-
-    float* newImageData = (float*)newImage.data;
-    float* newImageDData = (float*)newImageD.data;
-
-    for (int i = 0; i < neighbors_ / 2; i++)
+    // sample points relative to the block origin, with their interpolation weights;
+    // samples[k + neighbors] is the centre-symmetric partner of samples[k]
+    SCSLBP_sample samples[2 * 8];
+    for (int k = 0; k < neighbors; k++)
     {
-      y = spoints[0][i] + origy;
-      x = spoints[1][i] + origx;
-
-      // calculate floors, ceils and rounds for the x and y.
-      fy = floor(y); cy = ceil(y); ry = roundLocal(y);
-      fx = floor(x); cx = ceil(x); rx = roundLocal(x);
+      // check if interpolation is needed (decided by the first point of the pair)
+      y = spoints[0][k] + origy;
+      x = spoints[1][k] + origx;
+      bool interpolate = !((std::abs(x - roundLocal(x)) < 1 / 100000.0) && (std::abs(y - roundLocal(y)) < 1 / 100000.0));
 
-      yd = spoints[0][i + neighbors_ / 2] + origy;
-      xd = spoints[1][i + neighbors_ / 2] + origx;
+      for (int i = k; i < neighbors_; i += neighbors)
+      {
+        SCSLBP_sample& s = samples[i];
+        y = spoints[0][i] + origy;
+        x = spoints[1][i] + origx;
 
-      fyd = floor(yd); cyd = ceil(yd); ryd = roundLocal(yd);
-      fxd = floor(xd); cxd = ceil(xd); rxd = roundLocal(xd);
+        // calculate floors, ceils and rounds for the x and y.
+        fy = floor(y); cy = ceil(y); ry = roundLocal(y);
+        fx = floor(x); cx = ceil(x); rx = roundLocal(x);
 
-      //int a = abs(x - rx);
-      //int b = abs(y - ry);
+        if (!interpolate)
+        {
+          s.taps = 1;
+          s.y[0] = ry; s.x[0] = rx; s.w[0] = 1;
+          continue;
+        }
 
-      // check if interpolation is needed
-      if ((abs(x - rx) < 1 / 100000.0) && (abs(y - ry) < 1 / 100000.0))
-      {
-        // --- interpolation is not needed, use original datatypes ---
-        inputFloat(cv::Rect(rx, ry, dx, dy)).copyTo(newImage);
-        inputFloat(cv::Rect(rxd, ryd, dx, dy)).copyTo(newImageD);
-
-        // compute difference between newImage and newImageD
-        for (int iRow = 0; iRow < newImage.rows; iRow++)
-          for (int iCol = 0; iCol < newImage.cols; iCol++)
-          {
-            if (newImageData[iCol + newImage.cols * iRow] - newImageDData[iCol + newImageD.cols * iRow] >= 0)
-              D.data[iCol + D.cols * iRow] = 1;
-            else
-              D.data[iCol + D.cols * iRow] = 0;
-          }
-      }
-      else
-      {
-        // --- interpolation needed, use double type images ---
         float ty = y - fy;
         float tx = x - fx;
 
         // calculate the interpolation weights
-        float w1 = (1 - tx) * (1 - ty);
-        float w2 = tx  * (1 - ty);
-        float w3 = (1 - tx) *      ty;
-        float w4 = tx  *      ty;
-
-        // compute interpolated pixel values
-        cv::Mat dImage1, dImage2, dImage3, dImage4;
-        inputFloat(cv::Rect(fx, fy, dx, dy)).copyTo(dImage1);
-        inputFloat(cv::Rect(cx, fy, dx, dy)).copyTo(dImage2);
-        inputFloat(cv::Rect(fx, cy, dx, dy)).copyTo(dImage3);
-        inputFloat(cv::Rect(cx, cy, dx, dy)).copyTo(dImage4);
-
-        newImage = w1*dImage1 + w2*dImage2 + w3*dImage3 + w4*dImage4;
-
-        /////////////////////////////////////////
-        float tyd = yd - fyd;
-        float txd = xd - fxd;
-
-        float w1d = (1 - txd) * (1 - tyd);
-        float w2d = txd  * (1 - tyd);
-        float w3d = (1 - txd) *      tyd;
-        float w4d = txd  *      tyd;
-
-        inputFloat(cv::Rect(fxd, fyd, dx, dy)).copyTo(dImage1);
-        inputFloat(cv::Rect(cxd, fyd, dx, dy)).copyTo(dImage2);
-        inputFloat(cv::Rect(fxd, cyd, dx, dy)).copyTo(dImage3);
-        inputFloat(cv::Rect(cxd, cyd, dx, dy)).copyTo(dImage4);
-
-        newImageD = w1d*dImage1 + w2d*dImage2 + w3d*dImage3 + w4d*dImage4;
-
-        // compute difference between newImage and newImageD
-        for (int iRow = 0; iRow < newImage.rows; iRow++)
-          for (int iCol = 0; iCol < newImage.cols; iCol++)
-          {
-            if (newImageData[iCol + newImage.cols * iRow] - newImageDData[iCol + newImageD.cols * iRow] >= 0)
-              D.data[iCol + D.cols * iRow] = 1;
-            else
-              D.data[iCol + D.cols * iRow] = 0;
-          }
+        s.taps = 4;
+        s.y[0] = fy; s.x[0] = fx; s.w[0] = (1 - tx) * (1 - ty);
+        s.y[1] = fy; s.x[1] = cx; s.w[1] = tx  * (1 - ty);
+        s.y[2] = cy; s.x[2] = fx; s.w[2] = (1 - tx) *      ty;
+        s.y[3] = cy; s.x[3] = cx; s.w[3] = tx  *      ty;
       }
-
-      // update the result matrix
-      v = std::pow(2.0, i);
-      result = result + (int)v*D;
     }
 
-    // save results taking into account margins
-    result.copyTo(LBPImage(cv::Rect(origx, origy, dx, dy)));
+    const SimdLevel level = simdLevel();
+    for (int i = 0; i < dy; i++)
+    {
+      unsigned char* out = LBPImage.ptr<unsigned char>(origy + i) + origx;
+      int j = SCSLBP_row_simd<_Tp>(level, input1, i, samples, neighbors, out, 0, dx, SCSLBP_vector<_Tp>());
+      SCSLBP_row_<_Tp>(input1, i, samples, neighbors, out, j, dx);
+    }
   }
 
   void SCSLBP::run(const cv::Mat &input, cv::Mat &SCSLBP)
+  {
+    SCSLBP::run(input, SCSLBP, context);
+  }
+
+  void SCSLBP::run(const cv::Mat &input, cv::Mat &SCSLBP, LBPContext &context)
   {
     if (input.empty())
       return;
 
     int height = input.size().height;
     int width = input.size().width;
-    int channels = input.channels();
 
     // convert input image to grayscale
-    cv::Mat gray;
-    if (channels > 1)
-      cv::cvtColor(input, gray, cv::COLOR_BGR2GRAY);
-    else
-      gray = input.clone();
-
-    SCSLBP = cv::Mat(height, width, CV_8UC1, cv::Scalar(0));
-    lbpcompute(gray, SCSLBP);
+    cv::Mat gray = context.gray(input, SCSLBP);
+
+    SCSLBP.create(height, width, CV_8UC1);
+    SCSLBP.setTo(cv::Scalar(0));
+    switch (gray.type())
+    {
+      case CV_8SC1: lbpcompute<char>(gray, SCSLBP); break;
+      case CV_8UC1: lbpcompute<unsigned char>(gray, SCSLBP); break;
+      case CV_16SC1: lbpcompute<short>(gray, SCSLBP); break;
+      case CV_16UC1: lbpcompute<unsigned short>(gray, SCSLBP); break;
+      case CV_32SC1: lbpcompute<int>(gray, SCSLBP); break;
+      case CV_32FC1: lbpcompute<float>(gray, SCSLBP); break;
+      case CV_64FC1: lbpcompute<double>(gray, SCSLBP); break;
+    }
   }
 }
@@ -9,8 +9,9 @@ namespace lbplibrary
   {
   private:
     int radius;
-    int neighbors;
+    int neighbors;    // centre-symmetric pairs, i.e. bits of the code (1 to 8)
 
+    template <typename _Tp>
     void lbpcompute(const cv::Mat &input, cv::Mat &LBPImage);
 
     inline float roundLocal(float d)
@@ -19,9 +20,14 @@ namespace lbplibrary
     }
 
   public:
-    SCSLBP();
+    SCSLBP(int radius = 2, int neighbors = 4);
     ~SCSLBP();
 
+    using LBP::run;
     void run(const cv::Mat &img_input, cv::Mat &img_output);
+    void run(const cv::Mat &img_input, cv::Mat &img_output, LBPContext &context);
+
+    int halo() const { return radius + 1; }
+    LBPBorder border() const { return LBP_BORDER_SKIP; }
   };
 }
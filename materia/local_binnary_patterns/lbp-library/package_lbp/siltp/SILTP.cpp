@@ -1,134 +1,536 @@
 #include <iostream>
 #include <assert.h>
 #include <algorithm>
+#include <type_traits>
 
 #include "SILTP.h"
+#include "../simd/SIMD.h"
 
 namespace lbplibrary
 {
-  SILTP::SILTP() : tau(0.03), r(1), numPoints(4), encoder(0)
+  SILTP::SILTP(float tau, int r, int numPoints, int encoder) : tau(tau), r(std::max(r, 1)), numPoints(numPoints), encoder(encoder)
   {
-    std::cout << "SILTP()" << std::endl;
+    if (numPoints != 4 && numPoints != 8)
+      CV_Error(cv::Error::StsBadArg, "SILTP supports 4 or 8 points.");
   }
 
   SILTP::~SILTP()
   {
-    std::cout << "~SILTP()" << std::endl;
   }
 
-  void processSILTP(cv::Mat &in, cv::Mat &out, float tau, int radius, const int numPoints, int encoder)
+  // the eight neighbours counter-clockwise from the right one; 4 points take every other one
+  static const int SILTP_dx[8] = { 1, 1, 0, -1, -1, -1, 0, 1 };
+  static const int SILTP_dy[8] = { 0, -1, -1, -1, 0, 1, 1, 1 };
+
+  // neighbour k of a centre is below the lower limit (ternary digit 1, bit pair 10)
+  // or above the upper one (digit 2, bit pair 01)
+  template <typename _Tp>
+  static inline int SILTP_encode(const _Tp* n, int points, _Tp lower, _Tp upper, int encoder)
   {
-    int heightIn = in.size().height;
-    int widthIn = in.size().width;
+    int code = 0;
+    for (int k = points - 1; k >= 0; k--) {
+      int below = n[k] < lower, above = n[k] > upper;
+      code = encoder == 0 ? code * 3 + below + 2 * above : (code << 2) | (below << 1) | above;
+    }
+    return code;
+  }
 
-    const int N = 255; // max value of a u8 pixel
+  // (1 -/+ tau) * centre, rounded and saturated to integer pixel types
+  template <typename _Tp>
+  static inline _Tp SILTP_limit(_Tp c, float scale)
+  {
+    return cv::saturate_cast<_Tp>(scale * c);
+  }
 
-    // put the image in a larger container and replicate border image pixels to the outer area
-    cv::Mat image_0 = in;
-    cv::copyMakeBorder(in, image_0, radius, radius, radius, radius, cv::BORDER_REPLICATE);
+  // rows of the 3 x 3 neighbourhood at distance r, clamped to the image (replicated border)
+  template <typename _Tp>
+  struct SILTP_rows
+  {
+    const _Tp* row[3];           // up, mid, down
+    int points;
+    int stride;                  // 8 / points
+  };
 
-    // declare mat images
-    cv::Mat image_1, image_3, image_5, image_7;
-    cv::Mat image_2, image_4, image_6, image_8;
-    //int height = image_0.size().height;
-    //int width = image_0.size().width;
+  template <typename _Tp, typename _Ot>
+  static void SILTP_row_(const SILTP_rows<_Tp>& rows, _Ot* out, int j, int end, int r, int cols, int encoder, float lowScale, float upScale)
+  {
+    const _Tp* mid = rows.row[1];
+    for (; j < end; j++) {
+      _Tp n[8];
+      for (int k = 0; k < rows.points; k++) {
+        int d = k * rows.stride;
+        int x = std::min(std::max(j + SILTP_dx[d] * r, 0), cols - 1);
+        n[k] = rows.row[SILTP_dy[d] + 1][x];
+      }
+      out[j] = static_cast<_Ot>(SILTP_encode(n, rows.points, SILTP_limit(mid[j], lowScale), SILTP_limit(mid[j], upScale), encoder));
+    }
+  }
 
-    // copy image in specified directions
-    cv::Rect roi_1(2 * radius, radius, widthIn, heightIn);
-    image_0(roi_1).copyTo(image_1);
+#if defined(LBP_SIMD_X86)
+  // (1 -/+ tau) * centre rounded and saturated to 8 bits as saturate_cast does, 16 centres
+  LBP_TARGET_SSE41 static inline __m128i SILTP_limit_sse(__m128i c, __m128 scale)
+  {
+    __m128i g0 = _mm_cvtps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(_mm_cvtepu8_epi32(c)), scale));
+    __m128i g1 = _mm_cvtps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_srli_si128(c, 4))), scale));
+    __m128i g2 = _mm_cvtps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_srli_si128(c, 8))), scale));
+    __m128i g3 = _mm_cvtps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_srli_si128(c, 12))), scale));
+    return _mm_packus_epi16(_mm_packs_epi32(g0, g1), _mm_packs_epi32(g2, g3));
+  }
+
+  LBP_TARGET_SSE41 static int SILTP_row_sse41(const SILTP_rows<unsigned char>& rows, void* out, int j, int end, int r, int encoder, float tau)
+  {
+    const __m128i bias = _mm_set1_epi8((char)0x80);
+    const __m128 lowScale = _mm_set1_ps(1 - tau);
+    const __m128 upScale = _mm_set1_ps(1 + tau);
+    const unsigned char* nb[8];
+    for (int k = 0; k < rows.points; k++) {
+      int d = k * rows.stride;
+      nb[k] = rows.row[SILTP_dy[d] + 1] + SILTP_dx[d] * r;
+    }
 
-    cv::Rect roi_3(radius, 0, widthIn, heightIn);
-    image_0(roi_3).copyTo(image_3);
+    for (; j <= end - 16; j += 16) {
+      __m128i c = _mm_loadu_si128((const __m128i*)(rows.row[1] + j));
+      // biased so the signed byte compares order unsigned values
+      __m128i lower = _mm_xor_si128(SILTP_limit_sse(c, lowScale), bias);
+      __m128i upper = _mm_xor_si128(SILTP_limit_sse(c, upScale), bias);
+      __m128i below[8], above[8];
+      for (int k = 0; k < rows.points; k++) {
+        __m128i n = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(nb[k] + j)), bias);
+        below[k] = _mm_cmpgt_epi8(lower, n);
+        above[k] = _mm_cmpgt_epi8(n, upper);
+      }
 
-    cv::Rect roi_5(0, radius, widthIn, heightIn);
-    image_0(roi_5).copyTo(image_5);
+      if (rows.points == 4) {
+        __m128i code = _mm_setzero_si128();
+        for (int k = 0; k < 4; k++) {
+          int w = encoder == 0 ? (k == 0 ? 1 : k == 1 ? 3 : k == 2 ? 9 : 27) : 1 << (2 * k);
+          code = _mm_add_epi8(code, _mm_and_si128(below[k], _mm_set1_epi8((char)(encoder == 0 ? w : 2 * w))));
+          code = _mm_add_epi8(code, _mm_and_si128(above[k], _mm_set1_epi8((char)(encoder == 0 ? 2 * w : w))));
+        }
+        _mm_storeu_si128((__m128i*)((unsigned char*)out + j), code);
+      }
+      else if (encoder == 0) {
+        // base 3 does not fit in bytes: Horner in 16-bit lanes
+        __m128i lo = _mm_setzero_si128(), hi = _mm_setzero_si128();
+        for (int k = 7; k >= 0; k--) {
+          __m128i digit = _mm_or_si128(_mm_and_si128(below[k], _mm_set1_epi8(1)), _mm_and_si128(above[k], _mm_set1_epi8(2)));
+          lo = _mm_add_epi16(_mm_add_epi16(lo, _mm_add_epi16(lo, lo)), _mm_cvtepu8_epi16(digit));
+          hi = _mm_add_epi16(_mm_add_epi16(hi, _mm_add_epi16(hi, hi)), _mm_unpackhi_epi8(digit, _mm_setzero_si128()));
+        }
+        _mm_storeu_si128((__m128i*)((unsigned short*)out + j), lo);
+        _mm_storeu_si128((__m128i*)((unsigned short*)out + j + 8), hi);
+      }
+      else {
+        // points 0-3 make the low byte of each code, 4-7 the high byte
+        __m128i bytes[2] = { _mm_setzero_si128(), _mm_setzero_si128() };
+        for (int k = 0; k < 8; k++) {
+          int w = 1 << (2 * (k & 3));
+          bytes[k >> 2] = _mm_or_si128(bytes[k >> 2], _mm_and_si128(below[k], _mm_set1_epi8((char)(2 * w))));
+          bytes[k >> 2] = _mm_or_si128(bytes[k >> 2], _mm_and_si128(above[k], _mm_set1_epi8((char)w)));
+        }
+        _mm_storeu_si128((__m128i*)((unsigned short*)out + j), _mm_unpacklo_epi8(bytes[0], bytes[1]));
+        _mm_storeu_si128((__m128i*)((unsigned short*)out + j + 8), _mm_unpackhi_epi8(bytes[0], bytes[1]));
+      }
+    }
+    return j;
+  }
 
-    cv::Rect roi_7(radius, 2 * radius, widthIn, heightIn);
-    image_0(roi_7).copyTo(image_7);
+  LBP_TARGET_AVX2 static inline __m256i SILTP_limit_avx2(__m256i c, __m256 scale)
+  {
+    __m128i lo = _mm256_castsi256_si128(c), hi = _mm256_extracti128_si256(c, 1);
+    __m256i g0 = _mm256_cvtps_epi32(_mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(lo)), scale));
+    __m256i g1 = _mm256_cvtps_epi32(_mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_srli_si128(lo, 8))), scale));
+    __m256i g2 = _mm256_cvtps_epi32(_mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(hi)), scale));
+    __m256i g3 = _mm256_cvtps_epi32(_mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_srli_si128(hi, 8))), scale));
+    // packs work per 128-bit lane, the permute restores the column order
+    __m256i bytes = _mm256_packus_epi16(_mm256_packs_epi32(g0, g1), _mm256_packs_epi32(g2, g3));
+    return _mm256_permutevar8x32_epi32(bytes, _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7));
+  }
 
-    if (numPoints == 8)
-    {
-      cv::Rect roi_2(2 * radius, 0, widthIn, heightIn);
-      image_0(roi_1).copyTo(image_1);
+  LBP_TARGET_AVX2 static int SILTP_row_avx2(const SILTP_rows<unsigned char>& rows, void* out, int j, int end, int r, int encoder, float tau)
+  {
+    const __m256i bias = _mm256_set1_epi8((char)0x80);
+    const __m256 lowScale = _mm256_set1_ps(1 - tau);
+    const __m256 upScale = _mm256_set1_ps(1 + tau);
+    const unsigned char* nb[8];
+    for (int k = 0; k < rows.points; k++) {
+      int d = k * rows.stride;
+      nb[k] = rows.row[SILTP_dy[d] + 1] + SILTP_dx[d] * r;
+    }
 
-      cv::Rect roi_3(0, 0, widthIn, heightIn);
-      image_0(roi_3).copyTo(image_3);
+    for (; j <= end - 32; j += 32) {
+      __m256i c = _mm256_loadu_si256((const __m256i*)(rows.row[1] + j));
+      __m256i lower = _mm256_xor_si256(SILTP_limit_avx2(c, lowScale), bias);
+      __m256i upper = _mm256_xor_si256(SILTP_limit_avx2(c, upScale), bias);
+      __m256i below[8], above[8];
+      for (int k = 0; k < rows.points; k++) {
+        __m256i n = _mm256_xor_si256(_mm256_loadu_si256((const __m256i*)(nb[k] + j)), bias);
+        below[k] = _mm256_cmpgt_epi8(lower, n);
+        above[k] = _mm256_cmpgt_epi8(n, upper);
+      }
 
-      cv::Rect roi_5(0, 2 * radius, widthIn, heightIn);
-      image_0(roi_5).copyTo(image_5);
+      if (rows.points == 4) {
+        __m256i code = _mm256_setzero_si256();
+        for (int k = 0; k < 4; k++) {
+          int w = encoder == 0 ? (k == 0 ? 1 : k == 1 ? 3 : k == 2 ? 9 : 27) : 1 << (2 * k);
+          code = _mm256_add_epi8(code, _mm256_and_si256(below[k], _mm256_set1_epi8((char)(encoder == 0 ? w : 2 * w))));
+          code = _mm256_add_epi8(code, _mm256_and_si256(above[k], _mm256_set1_epi8((char)(encoder == 0 ? 2 * w : w))));
+        }
+        _mm256_storeu_si256((__m256i*)((unsigned char*)out + j), code);
+      }
+      else if (encoder == 0) {
+        __m256i lo = _mm256_setzero_si256(), hi = _mm256_setzero_si256();
+        for (int k = 7; k >= 0; k--) {
+          __m256i digit = _mm256_or_si256(_mm256_and_si256(below[k], _mm256_set1_epi8(1)), _mm256_and_si256(above[k], _mm256_set1_epi8(2)));
+          lo = _mm256_add_epi16(_mm256_add_epi16(lo, _mm256_add_epi16(lo, lo)), _mm256_cvtepu8_epi16(_mm256_castsi256_si128(digit)));
+          hi = _mm256_add_epi16(_mm256_add_epi16(hi, _mm256_add_epi16(hi, hi)), _mm256_cvtepu8_epi16(_mm256_extracti128_si256(digit, 1)));
+        }
+        _mm256_storeu_si256((__m256i*)((unsigned short*)out + j), lo);
+        _mm256_storeu_si256((__m256i*)((unsigned short*)out + j + 16), hi);
+      }
+      else {
+        __m256i bytes[2] = { _mm256_setzero_si256(), _mm256_setzero_si256() };
+        for (int k = 0; k < 8; k++) {
+          int w = 1 << (2 * (k & 3));
+          bytes[k >> 2] = _mm256_or_si256(bytes[k >> 2], _mm256_and_si256(below[k], _mm256_set1_epi8((char)(2 * w))));
+          bytes[k >> 2] = _mm256_or_si256(bytes[k >> 2], _mm256_and_si256(above[k], _mm256_set1_epi8((char)w)));
+        }
+        // the unpacks interleave per 128-bit lane
+        __m256i a = _mm256_unpacklo_epi8(bytes[0], bytes[1]), b = _mm256_unpackhi_epi8(bytes[0], bytes[1]);
+        _mm256_storeu_si256((__m256i*)((unsigned short*)out + j), _mm256_permute2x128_si256(a, b, 0x20));
+        _mm256_storeu_si256((__m256i*)((unsigned short*)out + j + 16), _mm256_permute2x128_si256(a, b, 0x31));
+      }
+    }
+    return SILTP_row_sse41(rows, out, j, end, r, encoder, tau);
+  }
 
-      cv::Rect roi_7(2 * radius, 2 * radius, widthIn, heightIn);
-      image_0(roi_7).copyTo(image_7);
+  // 16-bit and float pixels: 8 centres per vector, the digits and codes in 16-bit lanes
+  // (3^8 - 1 and 2^16 - 1 both fit), from the below / above masks of each neighbour
+  LBP_TARGET_SSE41 static inline __m128i SILTP_code16_sse(const __m128i* below, const __m128i* above, int points, int encoder)
+  {
+    __m128i code = _mm_setzero_si128();
+    for (int k = points - 1; k >= 0; k--) {
+      if (encoder == 0) {
+        __m128i digit = _mm_or_si128(_mm_and_si128(below[k], _mm_set1_epi16(1)), _mm_and_si128(above[k], _mm_set1_epi16(2)));
+        code = _mm_add_epi16(_mm_add_epi16(code, _mm_add_epi16(code, code)), digit);
+      }
+      else {
+        __m128i bits = _mm_or_si128(_mm_and_si128(below[k], _mm_set1_epi16(2)), _mm_and_si128(above[k], _mm_set1_epi16(1)));
+        code = _mm_or_si128(_mm_slli_epi16(code, 2), bits);
+      }
     }
+    return code;
+  }
 
-    // compute the upper and lower range
-    cv::Mat inF32(heightIn, widthIn, CV_32FC1);
-    cv::Mat lowRangeF32(heightIn, widthIn, CV_32FC1);
-    cv::Mat upperRangeF32(heightIn, widthIn, CV_32FC1);
+  LBP_TARGET_SSE41 static inline void SILTP_store16_sse(void* out, int j, int points, __m128i code)
+  {
+    if (points == 4)
+      _mm_storel_epi64((__m128i*)((unsigned char*)out + j), _mm_packus_epi16(code, code));
+    else
+      _mm_storeu_si128((__m128i*)((unsigned short*)out + j), code);
+  }
 
-    in.convertTo(inF32, CV_32F);
-    lowRangeF32 = (1 - tau) * inF32;
-    upperRangeF32 = (1 + tau) * inF32;
+  // limits of 8 16-bit centres, rounded and saturated as saturate_cast does
+  LBP_TARGET_SSE41 static inline __m128i SILTP_limit16_sse(__m128i c, __m128 scale)
+  {
+    __m128i lo = _mm_cvtps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(_mm_cvtepu16_epi32(c)), scale));
+    __m128i hi = _mm_cvtps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(_mm_cvtepu16_epi32(_mm_srli_si128(c, 8))), scale));
+    return _mm_packus_epi32(lo, hi);
+  }
 
-    cv::Mat L, U;
-    lowRangeF32.convertTo(L, CV_8U);
-    upperRangeF32.convertTo(U, CV_8U);
+  LBP_TARGET_SSE41 static int SILTP_row_sse41(const SILTP_rows<unsigned short>& rows, void* out, int j, int end, int r, int encoder, float tau)
+  {
+    const __m128i bias = _mm_set1_epi16((short)0x8000);
+    const __m128 lowScale = _mm_set1_ps(1 - tau);
+    const __m128 upScale = _mm_set1_ps(1 + tau);
+    const unsigned short* nb[8];
+    for (int k = 0; k < rows.points; k++) {
+      int d = k * rows.stride;
+      nb[k] = rows.row[SILTP_dy[d] + 1] + SILTP_dx[d] * r;
+    }
 
-    // compute the scale invariant local ternary patterns
-    if (encoder == 0)
-      if (numPoints == 4)
-      {
-        out = (image_1 < L) / N + (image_1 > U) / N * 2 + ((image_3 < L) / N + (image_3 > U) / N * 2) * 3 + ((image_5 < L) / N + (image_5 > U) / N * 2) * 9 + ((image_7 < L) / N + (image_7 > U) / N * 2) * 27;
+    for (; j <= end - 8; j += 8) {
+      __m128i c = _mm_loadu_si128((const __m128i*)(rows.row[1] + j));
+      // biased so the signed word compares order unsigned values
+      __m128i lower = _mm_xor_si128(SILTP_limit16_sse(c, lowScale), bias);
+      __m128i upper = _mm_xor_si128(SILTP_limit16_sse(c, upScale), bias);
+      __m128i below[8], above[8];
+      for (int k = 0; k < rows.points; k++) {
+        __m128i n = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(nb[k] + j)), bias);
+        below[k] = _mm_cmpgt_epi16(lower, n);
+        above[k] = _mm_cmpgt_epi16(n, upper);
       }
-      else
-      {
-        out = (image_1 < L) + (image_1 > U) * 2 + ((image_2 < L) + (image_2 > U) * 2) * 3 + ((image_3 < L) + (image_3 > U) * 2) * pow(3.0, 2) +
-          ((image_4 < L) + (image_4 > U) * 2) * pow(3.0, 3) + ((image_5 < L) + (image_5 > U) * 2) * pow(3.0, 4) + ((image_6 < L) + (image_6 > U) * 2) * pow(3.0, 5) +
-          ((image_7 < L) + (image_7> U) * 2) * pow(3.0, 6) + ((image_8 < L) + (image_8 > U) * 2) * pow(3.0, 7);
+      SILTP_store16_sse(out, j, rows.points, SILTP_code16_sse(below, above, rows.points, encoder));
+    }
+    return j;
+  }
+
+  LBP_TARGET_SSE41 static int SILTP_row_sse41(const SILTP_rows<float>& rows, void* out, int j, int end, int r, int encoder, float tau)
+  {
+    const __m128 lowScale = _mm_set1_ps(1 - tau);
+    const __m128 upScale = _mm_set1_ps(1 + tau);
+    const float* nb[8];
+    for (int k = 0; k < rows.points; k++) {
+      int d = k * rows.stride;
+      nb[k] = rows.row[SILTP_dy[d] + 1] + SILTP_dx[d] * r;
+    }
+
+    for (; j <= end - 8; j += 8) {
+      __m128 c0 = _mm_loadu_ps(rows.row[1] + j), c1 = _mm_loadu_ps(rows.row[1] + j + 4);
+      __m128 lower0 = _mm_mul_ps(c0, lowScale), lower1 = _mm_mul_ps(c1, lowScale);
+      __m128 upper0 = _mm_mul_ps(c0, upScale), upper1 = _mm_mul_ps(c1, upScale);
+      __m128i below[8], above[8];
+      for (int k = 0; k < rows.points; k++) {
+        __m128 n0 = _mm_loadu_ps(nb[k] + j), n1 = _mm_loadu_ps(nb[k] + j + 4);
+        // the all-ones masks pack to all-ones words
+        below[k] = _mm_packs_epi32(_mm_castps_si128(_mm_cmplt_ps(n0, lower0)), _mm_castps_si128(_mm_cmplt_ps(n1, lower1)));
+        above[k] = _mm_packs_epi32(_mm_castps_si128(_mm_cmpgt_ps(n0, upper0)), _mm_castps_si128(_mm_cmpgt_ps(n1, upper1)));
       }
+      SILTP_store16_sse(out, j, rows.points, SILTP_code16_sse(below, above, rows.points, encoder));
+    }
+    return j;
+  }
+
+  // 16-bit and float pixels have no 256-bit kernel: the 8 codes of a vector are already 16
+  // bits each, so the wider registers would only split the work over two lanes
+  static int SILTP_row_avx2(const SILTP_rows<unsigned short>& rows, void* out, int j, int end, int r, int encoder, float tau)
+  {
+    return SILTP_row_sse41(rows, out, j, end, r, encoder, tau);
+  }
+
+  static int SILTP_row_avx2(const SILTP_rows<float>& rows, void* out, int j, int end, int r, int encoder, float tau)
+  {
+    return SILTP_row_sse41(rows, out, j, end, r, encoder, tau);
+  }
+#elif defined(LBP_SIMD_NEON)
+  static inline uint8x8_t SILTP_limit_neon(uint8x8_t c, float scale)
+  {
+    uint16x8_t c16 = vmovl_u8(c);
+    int32x4_t lo = vcvtnq_s32_f32(vmulq_n_f32(vcvtq_f32_u32(vmovl_u16(vget_low_u16(c16))), scale));
+    int32x4_t hi = vcvtnq_s32_f32(vmulq_n_f32(vcvtq_f32_u32(vmovl_u16(vget_high_u16(c16))), scale));
+    return vqmovn_u16(vcombine_u16(vqmovun_s32(lo), vqmovun_s32(hi)));
+  }
+
+  static int SILTP_row_neon(const SILTP_rows<unsigned char>& rows, void* out, int j, int end, int r, int encoder, float tau)
+  {
+    const unsigned char* nb[8];
+    for (int k = 0; k < rows.points; k++) {
+      int d = k * rows.stride;
+      nb[k] = rows.row[SILTP_dy[d] + 1] + SILTP_dx[d] * r;
+    }
+
+    for (; j <= end - 16; j += 16) {
+      uint8x16_t c = vld1q_u8(rows.row[1] + j);
+      uint8x16_t lower = vcombine_u8(SILTP_limit_neon(vget_low_u8(c), 1 - tau), SILTP_limit_neon(vget_high_u8(c), 1 - tau));
+      uint8x16_t upper = vcombine_u8(SILTP_limit_neon(vget_low_u8(c), 1 + tau), SILTP_limit_neon(vget_high_u8(c), 1 + tau));
+      uint8x16_t below[8], above[8];
+      for (int k = 0; k < rows.points; k++) {
+        uint8x16_t n = vld1q_u8(nb[k] + j);
+        below[k] = vcltq_u8(n, lower);
+        above[k] = vcgtq_u8(n, upper);
+      }
+
+      if (rows.points == 4) {
+        uint8x16_t code = vdupq_n_u8(0);
+        for (int k = 0; k < 4; k++) {
+          int w = encoder == 0 ? (k == 0 ? 1 : k == 1 ? 3 : k == 2 ? 9 : 27) : 1 << (2 * k);
+          code = vaddq_u8(code, vandq_u8(below[k], vdupq_n_u8(encoder == 0 ? w : 2 * w)));
+          code = vaddq_u8(code, vandq_u8(above[k], vdupq_n_u8(encoder == 0 ? 2 * w : w)));
+        }
+        vst1q_u8((unsigned char*)out + j, code);
+      }
+      else if (encoder == 0) {
+        uint16x8_t lo = vdupq_n_u16(0), hi = vdupq_n_u16(0);
+        for (int k = 7; k >= 0; k--) {
+          uint8x16_t digit = vorrq_u8(vandq_u8(below[k], vdupq_n_u8(1)), vandq_u8(above[k], vdupq_n_u8(2)));
+          lo = vmlaq_n_u16(vmovl_u8(vget_low_u8(digit)), lo, 3);
+          hi = vmlaq_n_u16(vmovl_u8(vget_high_u8(digit)), hi, 3);
+        }
+        vst1q_u16((unsigned short*)out + j, lo);
+        vst1q_u16((unsigned short*)out + j + 8, hi);
+      }
+      else {
+        uint8x16_t bytes[2] = { vdupq_n_u8(0), vdupq_n_u8(0) };
+        for (int k = 0; k < 8; k++) {
+          int w = 1 << (2 * (k & 3));
+          bytes[k >> 2] = vorrq_u8(bytes[k >> 2], vandq_u8(below[k], vdupq_n_u8(2 * w)));
+          bytes[k >> 2] = vorrq_u8(bytes[k >> 2], vandq_u8(above[k], vdupq_n_u8(w)));
+        }
+        uint8x16x2_t codes = vzipq_u8(bytes[0], bytes[1]);
+        vst1q_u16((unsigned short*)out + j, vreinterpretq_u16_u8(codes.val[0]));
+        vst1q_u16((unsigned short*)out + j + 8, vreinterpretq_u16_u8(codes.val[1]));
+      }
+    }
+    return j;
+  }
+  static inline uint16x8_t SILTP_code16_neon(const uint16x8_t* below, const uint16x8_t* above, int points, int encoder)
+  {
+    uint16x8_t code = vdupq_n_u16(0);
+    for (int k = points - 1; k >= 0; k--) {
+      if (encoder == 0) {
+        uint16x8_t digit = vorrq_u16(vandq_u16(below[k], vdupq_n_u16(1)), vandq_u16(above[k], vdupq_n_u16(2)));
+        code = vmlaq_n_u16(digit, code, 3);
+      }
+      else {
+        uint16x8_t bits = vorrq_u16(vandq_u16(below[k], vdupq_n_u16(2)), vandq_u16(above[k], vdupq_n_u16(1)));
+        code = vorrq_u16(vshlq_n_u16(code, 2), bits);
+      }
+    }
+    return code;
+  }
+
+  static inline void SILTP_store16_neon(void* out, int j, int points, uint16x8_t code)
+  {
+    if (points == 4)
+      vst1_u8((unsigned char*)out + j, vmovn_u16(code));
     else
-      if (numPoints == 4)
-      {
-        out = (image_1 > U) + (image_1 < L) * 2 + (image_3 > U) * pow(2.0, 2) + (image_3 < L) * pow(2.0, 3) +
-          (image_5 > U) * pow(2.0, 4) + (image_5 < L) * pow(2.0, 5) + (image_7 > U) * pow(2.0, 6) + (image_7 < L) * pow(2.0, 7);
+      vst1q_u16((unsigned short*)out + j, code);
+  }
+
+  static inline uint16x4_t SILTP_limit16_neon(uint16x4_t c, float scale)
+  {
+    return vqmovun_s32(vcvtnq_s32_f32(vmulq_n_f32(vcvtq_f32_u32(vmovl_u16(c)), scale)));
+  }
+
+  static int SILTP_row_neon(const SILTP_rows<unsigned short>& rows, void* out, int j, int end, int r, int encoder, float tau)
+  {
+    const unsigned short* nb[8];
+    for (int k = 0; k < rows.points; k++) {
+      int d = k * rows.stride;
+      nb[k] = rows.row[SILTP_dy[d] + 1] + SILTP_dx[d] * r;
+    }
+
+    for (; j <= end - 8; j += 8) {
+      uint16x8_t c = vld1q_u16(rows.row[1] + j);
+      uint16x8_t lower = vcombine_u16(SILTP_limit16_neon(vget_low_u16(c), 1 - tau), SILTP_limit16_neon(vget_high_u16(c), 1 - tau));
+      uint16x8_t upper = vcombine_u16(SILTP_limit16_neon(vget_low_u16(c), 1 + tau), SILTP_limit16_neon(vget_high_u16(c), 1 + tau));
+      uint16x8_t below[8], above[8];
+      for (int k = 0; k < rows.points; k++) {
+        uint16x8_t n = vld1q_u16(nb[k] + j);
+        below[k] = vcltq_u16(n, lower);
+        above[k] = vcgtq_u16(n, upper);
       }
-      else
-      {
-        out = (image_1 > U) + (image_1 < L) * 2 + (image_2 > U) * pow(2.0, 2) + (image_2 < L) * pow(2.0, 3) + (image_3 > U) * pow(2.0, 4) + (image_3 < L) * pow(2.0, 5) +
-          (image_4 > U) * pow(2.0, 6) + (image_4 < L) * pow(2.0, 7) + (image_5 > U) * pow(2.0, 8) + (image_5 < L) * pow(2.0, 9) + (image_6 > U) * pow(2.0, 10) +
-          (image_6 < L) * pow(2.0, 11) + (image_7 > U) * pow(2.0, 12) + (image_7 < L) * pow(2.0, 13) + (image_8 > U) * pow(2.0, 14) + (image_8 < L) * pow(2.0, 15);
+      SILTP_store16_neon(out, j, rows.points, SILTP_code16_neon(below, above, rows.points, encoder));
+    }
+    return j;
+  }
+
+  static int SILTP_row_neon(const SILTP_rows<float>& rows, void* out, int j, int end, int r, int encoder, float tau)
+  {
+    const float* nb[8];
+    for (int k = 0; k < rows.points; k++) {
+      int d = k * rows.stride;
+      nb[k] = rows.row[SILTP_dy[d] + 1] + SILTP_dx[d] * r;
+    }
+
+    for (; j <= end - 8; j += 8) {
+      float32x4_t c0 = vld1q_f32(rows.row[1] + j), c1 = vld1q_f32(rows.row[1] + j + 4);
+      float32x4_t lower0 = vmulq_n_f32(c0, 1 - tau), lower1 = vmulq_n_f32(c1, 1 - tau);
+      float32x4_t upper0 = vmulq_n_f32(c0, 1 + tau), upper1 = vmulq_n_f32(c1, 1 + tau);
+      uint16x8_t below[8], above[8];
+      for (int k = 0; k < rows.points; k++) {
+        float32x4_t n0 = vld1q_f32(nb[k] + j), n1 = vld1q_f32(nb[k] + j + 4);
+        below[k] = vcombine_u16(vmovn_u32(vcltq_f32(n0, lower0)), vmovn_u32(vcltq_f32(n1, lower1)));
+        above[k] = vcombine_u16(vmovn_u32(vcgtq_f32(n0, upper0)), vmovn_u32(vcgtq_f32(n1, upper1)));
       }
+      SILTP_store16_neon(out, j, rows.points, SILTP_code16_neon(below, above, rows.points, encoder));
+    }
+    return j;
+  }
+#endif
+
+  // pixel types with vector code
+  template <typename _Tp> struct SILTP_vector : std::false_type {};
+  template <> struct SILTP_vector<unsigned char> : std::true_type {};
+  template <> struct SILTP_vector<unsigned short> : std::true_type {};
+  template <> struct SILTP_vector<float> : std::true_type {};
+
+  // vector code of the columns [j, end), whose neighbours all lie inside the row; returns
+  // the first column left to the scalar loop
+  template <typename _Tp>
+  static int SILTP_row_simd(SimdLevel level, const SILTP_rows<_Tp>& rows, void* out, int j, int end, int r, int encoder, float tau, std::true_type)
+  {
+#if defined(LBP_SIMD_X86)
+    if (level == SIMD_256)
+      return SILTP_row_avx2(rows, out, j, end, r, encoder, tau);
+    if (level != SIMD_SCALAR)
+      return SILTP_row_sse41(rows, out, j, end, r, encoder, tau);
+#elif defined(LBP_SIMD_NEON)
+    if (level != SIMD_SCALAR)
+      return SILTP_row_neon(rows, out, j, end, r, encoder, tau);
+#endif
+    return j;
+  }
+
+  template <typename _Tp>
+  static int SILTP_row_simd(SimdLevel level, const SILTP_rows<_Tp>& rows, void* out, int j, int end, int r, int encoder, float tau, std::false_type)
+  {
+    return j;
+  }
+
+  // one pass over the rows, the neighbours read in place with the border replicated;
+  // _Tp is the pixel type, _Ot the code type
+  template <typename _Tp, typename _Ot>
+  void SILTP::SILTP_(const cv::Mat& gray, cv::Mat& dst)
+  {
+    const int rows = gray.rows;
+    const int cols = gray.cols;
+    const SimdLevel level = simdLevel();
+
+    dst.create(rows, cols, sizeof(_Ot) == 1 ? CV_8UC1 : CV_16UC1);
+    SILTP_rows<_Tp> nb;
+    nb.points = numPoints;
+    nb.stride = 8 / numPoints;
+    // columns whose neighbours all lie inside the row
+    const int first = std::min(r, cols), last = std::max(first, cols - r);
+    for (int i = 0; i < rows; i++)
+    {
+      nb.row[0] = gray.ptr<_Tp>(std::max(i - r, 0));
+      nb.row[1] = gray.ptr<_Tp>(i);
+      nb.row[2] = gray.ptr<_Tp>(std::min(i + r, rows - 1));
+      _Ot* out = dst.ptr<_Ot>(i);
+
+      SILTP_row_(nb, out, 0, first, r, cols, encoder, 1 - tau, 1 + tau);
+      int j = SILTP_row_simd(level, nb, out, first, last, r, encoder, tau, SILTP_vector<_Tp>());
+      SILTP_row_(nb, out, j, cols, r, cols, encoder, 1 - tau, 1 + tau);
+    }
+  }
+
+  template <typename _Tp>
+  void SILTP::SILTP_(const cv::Mat& gray, cv::Mat& dst)
+  {
+    if (numPoints == 4)
+      SILTP_<_Tp, unsigned char>(gray, dst);
+    else
+      SILTP_<_Tp, unsigned short>(gray, dst);
   }
 
   void SILTP::run(const cv::Mat &input, cv::Mat &SILTP)
+  {
+    SILTP::run(input, SILTP, context);
+  }
+
+  void SILTP::run(const cv::Mat &input, cv::Mat &SILTP, LBPContext &context)
   {
     if (input.empty())
       return;
 
-    int height = input.size().height;
-    int width = input.size().width;
-    int channels = input.channels();
-
     // convert input image to grayscale
-    cv::Mat gray;
-    if (channels > 1)
-      cv::cvtColor(input, gray, cv::COLOR_BGR2GRAY);
-    else
-      gray = input.clone();
-
-    // create output background model
-    /*cv::Mat*/ SILTP = cv::Mat(height, width, CV_8UC1);
-    memset(SILTP.data, 0x00, SILTP.cols * SILTP.rows);
+    cv::Mat gray = context.gray(input, SILTP);
 
     // check parameters
     assert(tau > 0);
-    //assert(floor(r) = ~r | r < 1); TODO
 
-    // check images size
-    assert(width > (2 * r + 1));
-    assert(height > (2 * r + 1));
-
-    // compute SILTP 
-    processSILTP(gray, SILTP, tau, r, numPoints, encoder);
+    // compute SILTP: 8-bit codes for 4 points, 16-bit for 8, whatever the pixel type
+    switch (gray.type())
+    {
+      case CV_8SC1: SILTP_<char>(gray, SILTP); break;
+      case CV_8UC1: SILTP_<unsigned char>(gray, SILTP); break;
+      case CV_16SC1: SILTP_<short>(gray, SILTP); break;
+      case CV_16UC1: SILTP_<unsigned short>(gray, SILTP); break;
+      case CV_32SC1: SILTP_<int>(gray, SILTP); break;
+      case CV_32FC1: SILTP_<float>(gray, SILTP); break;
+      case CV_64FC1: SILTP_<double>(gray, SILTP); break;
+    }
   }
 }
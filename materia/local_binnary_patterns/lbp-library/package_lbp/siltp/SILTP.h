@@ -24,10 +24,21 @@ namespace lbplibrary
     /* 0: encoded as 0 ~ 3^numPoints-1, suitable for histogram calculation.
     1: encoded as 0 ~ 2^(2*numPoints), as the way in the reference paper, suitable for calculating hamming distance. */
 
+    template <typename _Tp, typename _Ot>
+    void SILTP_(const cv::Mat& gray, cv::Mat& dst);
+    template <typename _Tp>
+    void SILTP_(const cv::Mat& gray, cv::Mat& dst);
+
   public:
-    SILTP();
+    // the output is CV_8UC1 for 4 points and CV_16UC1 for 8
+    SILTP(float tau = 0.03, int r = 1, int numPoints = 4, int encoder = 0);
     ~SILTP();
 
+    using LBP::run;
     void run(const cv::Mat &img_input, cv::Mat &img_output);
+    void run(const cv::Mat &img_input, cv::Mat &img_output, LBPContext &context);
+
+    int halo() const { return r; }
+    LBPBorder border() const { return LBP_BORDER_REPLICATE; }
   };
 }
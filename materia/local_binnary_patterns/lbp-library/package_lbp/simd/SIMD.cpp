@@ -0,0 +1,48 @@
+#include <algorithm>
+
+#include "SIMD.h"
+
+namespace lbplibrary
+{
+  static SimdLevel detectSimdLevel()
+  {
+#if defined(LBP_SIMD_X86)
+    if (cv::checkHardwareSupport(CV_CPU_AVX2))
+      return SIMD_256;
+    if (cv::checkHardwareSupport(CV_CPU_SSE4_1))
+      return SIMD_128;
+    return SIMD_SCALAR;
+#elif defined(LBP_SIMD_NEON)
+    return SIMD_128;
+#else
+    return SIMD_SCALAR;
+#endif
+  }
+
+  static SimdLevel simdLimit = SIMD_256;
+
+  SimdLevel simdLevel()
+  {
+    static const SimdLevel detected = detectSimdLevel();
+    return std::min(detected, simdLimit);
+  }
+
+  void setSimdLevel(SimdLevel level)
+  {
+    simdLimit = level;
+  }
+
+  const char* simdLevelName(SimdLevel level)
+  {
+    switch (level)
+    {
+#if defined(LBP_SIMD_NEON)
+      case SIMD_128: return "NEON";
+#else
+      case SIMD_128: return "SSE4.1";
+#endif
+      case SIMD_256: return "AVX2";
+      default: return "scalar";
+    }
+  }
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+
+// x86 kernels are compiled per function with target attributes and selected at
+// runtime, so the library itself can still be built for the baseline ISA.
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define LBP_SIMD_X86 1
+#include <immintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define LBP_SIMD_NEON 1
+#include <arm_neon.h>
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define LBP_TARGET_SSE41 __attribute__((target("sse4.1")))
+#define LBP_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define LBP_TARGET_SSE41
+#define LBP_TARGET_AVX2
+#endif
+
+namespace lbplibrary
+{
+  enum SimdLevel
+  {
+    SIMD_SCALAR = 0,
+    SIMD_128 = 1,   // SSE4.1 or NEON
+    SIMD_256 = 2    // AVX2
+  };
+
+  // widest instruction set available on this CPU, limited by setSimdLevel()
+  SimdLevel simdLevel();
+
+  // limits the kernels to the given level, e.g. SIMD_SCALAR to time or verify the reference path
+  void setSimdLevel(SimdLevel level);
+
+  const char* simdLevelName(SimdLevel level);
+}
@@ -0,0 +1,245 @@
+#include <cstring>
+#include <algorithm>
+
+#include "StreamingLBP.h"
+
+namespace lbplibrary
+{
+  StreamingLBP::StreamingLBP(LBP* lbp, int numPatterns, const cv::Size& tile, double threshold)
+    : lbp(lbp), numPatterns(numPatterns), tile(tile), threshold(threshold), dirtyCount_(0)
+  {
+    if (tile.width <= 0 || tile.height <= 0)
+      CV_Error(cv::Error::StsBadArg, "Tiles must not be empty.");
+  }
+
+  StreamingLBP::~StreamingLBP()
+  {
+    delete lbp;
+  }
+
+  void StreamingLBP::reset()
+  {
+    previous.release();
+  }
+
+  cv::Rect StreamingLBP::inputRect(int tx, int ty, cv::Point& offset) const
+  {
+    int left, right, top, bottom;
+    lbp->stripeRows(gray.cols, xs[tx], xs[tx + 1], left, right, offset.x);
+    lbp->stripeRows(gray.rows, ys[ty], ys[ty + 1], top, bottom, offset.y);
+    return cv::Rect(left, top, right - left, bottom - top);
+  }
+
+  // tile bounds along one axis: as many whole tiles as fit, the last one taking the remainder
+  static void tile_bounds(int length, int tile, std::vector<int>& bounds)
+  {
+    int n = std::max(1, length / tile);
+    bounds.resize(n + 1);
+    for (int i = 0; i < n; i++)
+      bounds[i] = i * tile;
+    bounds[n] = length;
+  }
+
+  void StreamingLBP::layout(const cv::Size& size)
+  {
+    tile_bounds(size.width, tile.width, xs);
+    tile_bounds(size.height, tile.height, ys);
+    const cv::Size n = tiles();
+    dirty_.create(n.height, n.width, CV_8UC1);
+    contexts.resize(n.height);
+    patches.resize(n.height);
+    if (numPatterns > 0)
+      histograms_.create(n.area(), numPatterns, CV_32SC1);
+  }
+
+  // counts the codes of rect in hist, skipping those outside [0, numPatterns)
+  template <typename _Tp>
+  static void tile_histogram_(const cv::Mat& codes, const cv::Rect& rect, int* hist, int numPatterns)
+  {
+    std::fill(hist, hist + numPatterns, 0);
+    for (int i = rect.y; i < rect.y + rect.height; i++) {
+      const _Tp* c = codes.ptr<_Tp>(i) + rect.x;
+      for (int j = 0; j < rect.width; j++) {
+        int bin = static_cast<int>(c[j]);
+        if ((unsigned)bin < (unsigned)numPatterns)
+          hist[bin] += 1;
+      }
+    }
+  }
+
+  static void tile_histogram(const cv::Mat& codes, const cv::Rect& rect, int* hist, int numPatterns)
+  {
+    switch (codes.type()) {
+      case CV_8SC1: tile_histogram_<char>(codes, rect, hist, numPatterns); break;
+      case CV_8UC1: tile_histogram_<unsigned char>(codes, rect, hist, numPatterns); break;
+      case CV_16SC1: tile_histogram_<short>(codes, rect, hist, numPatterns); break;
+      case CV_16UC1: tile_histogram_<unsigned short>(codes, rect, hist, numPatterns); break;
+      case CV_32SC1: tile_histogram_<int>(codes, rect, hist, numPatterns); break;
+      case CV_32FC1: tile_histogram_<float>(codes, rect, hist, numPatterns); break;
+      default: std::fill(hist, hist + numPatterns, 0); break;
+    }
+  }
+
+  // whether some pixel of rect differs between a and b by more than threshold; a row is
+  // scanned to the end before testing, so the loop has no exit and vectorises
+  template <typename _Tp, typename _Dt>
+  static bool changed_(const cv::Mat& a, const cv::Mat& b, const cv::Rect& rect, _Dt threshold)
+  {
+    for (int i = rect.y; i < rect.y + rect.height; i++) {
+      const _Tp* p = a.ptr<_Tp>(i) + rect.x;
+      const _Tp* q = b.ptr<_Tp>(i) + rect.x;
+      _Dt diff = 0;
+      for (int j = 0; j < rect.width; j++)
+        diff = std::max(diff, static_cast<_Dt>(std::abs(static_cast<_Dt>(p[j]) - static_cast<_Dt>(q[j]))));
+      if (diff > threshold)
+        return true;
+    }
+    return false;
+  }
+
+  static bool changed(const cv::Mat& a, const cv::Mat& b, const cv::Rect& rect, double threshold)
+  {
+    if (threshold <= 0) {
+      const size_t bytes = rect.width * a.elemSize();
+      for (int i = rect.y; i < rect.y + rect.height; i++)
+        if (memcmp(a.ptr(i, rect.x), b.ptr(i, rect.x), bytes) != 0)
+          return true;
+      return false;
+    }
+    // integer pixels differ by whole steps, so only the integer part of threshold matters
+    switch (a.depth()) {
+      case CV_8U: return changed_<unsigned char, int>(a, b, rect, static_cast<int>(threshold));
+      case CV_8S: return changed_<char, int>(a, b, rect, static_cast<int>(threshold));
+      case CV_16U: return changed_<unsigned short, int>(a, b, rect, static_cast<int>(threshold));
+      case CV_16S: return changed_<short, int>(a, b, rect, static_cast<int>(threshold));
+      case CV_32S: return changed_<int, double>(a, b, rect, threshold);
+      case CV_32F: return changed_<float, float>(a, b, rect, static_cast<float>(threshold));
+      default: return changed_<double, double>(a, b, rect, threshold);
+    }
+  }
+
+  // marks the tiles of the rows [range) whose input neighbourhood changed
+  class StreamingLBPChanges : public cv::ParallelLoopBody
+  {
+  private:
+    const StreamingLBP& stream;
+    const cv::Mat& gray;
+    const cv::Mat& previous;
+    cv::Mat& dirty;
+    double threshold;
+
+  public:
+    StreamingLBPChanges(const StreamingLBP& stream, const cv::Mat& gray, const cv::Mat& previous, cv::Mat& dirty, double threshold)
+      : stream(stream), gray(gray), previous(previous), dirty(dirty), threshold(threshold) {}
+
+    void operator()(const cv::Range& range) const
+    {
+      for (int ty = range.start; ty < range.end; ty++) {
+        unsigned char* d = dirty.ptr<unsigned char>(ty);
+        for (int tx = 0; tx < dirty.cols; tx++) {
+          cv::Point offset;
+          d[tx] = changed(gray, previous, stream.inputRect(tx, ty, offset), threshold) ? 255 : 0;
+        }
+      }
+    }
+  };
+
+  // recomputes the dirty tiles of the rows [range), one operator call per stretch of
+  // neighbouring dirty tiles
+  class StreamingLBPTiles : public cv::ParallelLoopBody
+  {
+  private:
+    const StreamingLBP& stream;
+    const cv::Mat& gray;
+    const cv::Mat& dirty;
+    cv::Mat& codes;
+    cv::Mat& histograms;
+    std::vector<LBPContext>& contexts;
+    std::vector<cv::Mat>& patches;
+
+  public:
+    StreamingLBPTiles(const StreamingLBP& stream, const cv::Mat& gray, const cv::Mat& dirty, cv::Mat& codes, cv::Mat& histograms,
+      std::vector<LBPContext>& contexts, std::vector<cv::Mat>& patches)
+      : stream(stream), gray(gray), dirty(dirty), codes(codes), histograms(histograms), contexts(contexts), patches(patches) {}
+
+    void operator()(const cv::Range& range) const
+    {
+      for (int ty = range.start; ty < range.end; ty++) {
+        const unsigned char* d = dirty.ptr<unsigned char>(ty);
+        LBPContext& context = contexts[ty];
+        for (int tx = 0; tx < dirty.cols; tx++) {
+          if (!d[tx])
+            continue;
+          int last = tx;
+          while (last + 1 < dirty.cols && d[last + 1])
+            last++;
+
+          cv::Point offset, unused;
+          cv::Rect first = stream.inputRect(tx, ty, offset);
+          cv::Rect input = first | stream.inputRect(last, ty, unused);
+          cv::Rect area = stream.tileRect(tx, ty) | stream.tileRect(last, ty);
+
+          // the kernels expect continuous input
+          cv::Mat& patch = patches[ty];
+          gray(input).copyTo(patch);
+          cv::Mat& result = context.output();
+          stream.op()->run(patch, result, context);
+          if (result.type() == codes.type()) {
+            cv::Mat dst = codes(area);
+            result(cv::Rect(offset.x, offset.y, area.width, area.height)).copyTo(dst);
+          }
+
+          if (!histograms.empty())
+            for (int k = tx; k <= last; k++)
+              tile_histogram(codes, stream.tileRect(k, ty), histograms.ptr<int>(ty * dirty.cols + k), histograms.cols);
+          tx = last;
+        }
+      }
+    }
+  };
+
+  void StreamingLBP::full()
+  {
+    lbp->run(gray, codes_, context);
+    gray.copyTo(previous);
+    if (codes_.empty())
+      return; // type not handled by the operator
+
+    layout(codes_.size());
+    dirty_.setTo(cv::Scalar(255));
+    dirtyCount_ = dirty_.rows * dirty_.cols;
+    if (numPatterns > 0)
+      for (int ty = 0; ty < dirty_.rows; ty++)
+        for (int tx = 0; tx < dirty_.cols; tx++)
+          tile_histogram(codes_, tileRect(tx, ty), histograms_.ptr<int>(ty * dirty_.cols + tx), numPatterns);
+  }
+
+  const cv::Mat& StreamingLBP::process(const cv::Mat& frame)
+  {
+    if (frame.empty())
+      return codes_;
+
+    gray = frames.gray(frame, codes_);
+    if (lbp->halo() < 0 || codes_.empty() || previous.size() != gray.size() || previous.type() != gray.type()) {
+      full();
+      return codes_;
+    }
+
+    cv::parallel_for_(cv::Range(0, dirty_.rows), StreamingLBPChanges(*this, gray, previous, dirty_, threshold));
+    dirtyCount_ = cv::countNonZero(dirty_);
+    if (dirtyCount_ == 0)
+      return codes_;
+    cv::parallel_for_(cv::Range(0, dirty_.rows), StreamingLBPTiles(*this, gray, dirty_, codes_, histograms_, contexts, patches));
+
+    // the recomputed tiles now describe this frame
+    for (int ty = 0; ty < dirty_.rows; ty++)
+      for (int tx = 0; tx < dirty_.cols; tx++)
+        if (dirty_.at<unsigned char>(ty, tx)) {
+          cv::Point offset;
+          cv::Rect rect = inputRect(tx, ty, offset);
+          cv::Mat dst = previous(rect);
+          gray(rect).copyTo(dst);
+        }
+    return codes_;
+  }
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+#include "../LBP.h"
+
+namespace lbplibrary
+{
+  // Runs an operator over a video, recomputing only what changed since the previous frame.
+  // The code image is split into tiles, and a tile is recomputed when a pixel of its input
+  // neighbourhood (the tile plus halo() pixels on every side) differs from the previous frame
+  // by more than threshold; the others keep their codes and histograms. With threshold 0 the
+  // codes are exactly those of a full run on every frame, for every border type. The tiles
+  // are recomputed in parallel, one row of tiles per task, each with its own LBPContext.
+  //
+  // The neighbourhood is assumed to reach as far across as it does up and down, which holds
+  // for every operator of the library. Operators with a negative halo() (OCLBP) are run on
+  // every frame as a whole.
+  class StreamingLBP
+  {
+  public:
+    // takes ownership of lbp; numPatterns > 0 also keeps one histogram per tile. The last
+    // tile of a row or column takes the remainder of the code image, so tiles are between
+    // one and two tile sizes across
+    StreamingLBP(LBP* lbp, int numPatterns = 0, const cv::Size& tile = cv::Size(32, 32), double threshold = 0);
+    ~StreamingLBP();
+    // the operator is owned, so a copy would delete it twice
+    StreamingLBP(const StreamingLBP&) = delete;
+    StreamingLBP& operator=(const StreamingLBP&) = delete;
+
+    // updates the codes with the next frame and returns them; a frame of another size or
+    // type starts over with a full run
+    const cv::Mat& process(const cv::Mat& frame);
+    // the next frame is computed as a whole
+    void reset();
+
+    const cv::Mat& codes() const { return codes_; }
+    // one row of numPatterns counts (CV_32SC1) per tile, tile (tx, ty) in row ty * tiles().width + tx
+    const cv::Mat& histograms() const { return histograms_; }
+    // tiles().height x tiles().width, CV_8UC1: 255 where the last frame recomputed the tile
+    const cv::Mat& dirty() const { return dirty_; }
+    // tiles recomputed by the last frame
+    int dirtyCount() const { return dirtyCount_; }
+
+    cv::Size tiles() const { return cv::Size((int)xs.size() - 1, (int)ys.size() - 1); }
+    // code image rectangle of tile (tx, ty)
+    cv::Rect tileRect(int tx, int ty) const { return cv::Rect(xs[tx], ys[ty], xs[tx + 1] - xs[tx], ys[ty + 1] - ys[ty]); }
+    // input rectangle the codes of tile (tx, ty) depend on, and the position of the tile in it
+    cv::Rect inputRect(int tx, int ty, cv::Point& offset) const;
+
+    LBP* op() const { return lbp; }
+
+  private:
+    LBP* lbp;
+    int numPatterns;
+    cv::Size tile;
+    double threshold;
+
+    cv::Mat gray;      // the frame as the operator sees it, single channel
+    cv::Mat previous;  // the frame the codes were last computed from
+    cv::Mat codes_, histograms_, dirty_;
+    int dirtyCount_;
+    std::vector<int> xs, ys;  // tile bounds in the code image
+    LBPContext frames;        // colour conversion
+    LBPContext context;       // full runs
+    // per row of tiles: the operator's buffers and the input of the tiles being recomputed
+    std::vector<LBPContext> contexts;
+    std::vector<cv::Mat> patches;
+
+    void layout(const cv::Size& size);
+    void full();
+  };
+}
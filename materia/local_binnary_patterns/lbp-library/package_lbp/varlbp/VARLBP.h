@@ -2,6 +2,7 @@
 #include <opencv2/opencv.hpp>
 
 #include "../LBP.h"
+#include "../sampler/CircularSampler.h"
 
 namespace lbplibrary
 {
@@ -10,14 +11,22 @@ namespace lbplibrary
   private:
     int radius;
     int neighbors;
+    bool fixedPoint;  // integer sampling and accumulation for 8-bit input
+    CircularSampler sampler;
 
     template <typename _Tp>
-    void VARLBP_(const cv::Mat& src, cv::Mat& dst);
+    void VARLBP_(const cv::Mat& src, cv::Mat& dst, LBPContext& context);
+    void VARLBP_fixed(const cv::Mat& src, cv::Mat& dst, LBPContext& context);
 
   public:
-    VARLBP();
+    VARLBP(int radius = 1, int neighbors = 8, bool fixedPoint = false);
     ~VARLBP();
 
+    using LBP::run;
     void run(const cv::Mat &img_input, cv::Mat &img_output);
+    void run(const cv::Mat &img_input, cv::Mat &img_output, LBPContext &context);
+
+    int halo() const { return radius; }
+    LBPBorder border() const { return LBP_BORDER_CROP; }
   };
 }
@@ -3,122 +3,126 @@
 #include <algorithm>
 
 #include "XCSLBP.h"
+#include "../parallel/ParallelLBP.h"
 
 namespace lbplibrary
 {
-  XCSLBP::XCSLBP() : fxRadius(1), fyRadius(1), borderLength(1)
+  // offsets of the 8 neighbours at radius 1, counter-clockwise from the right one
+  static const int XCSLBP_dx[8] = { 1, 1, 0, -1, -1, -1, 0, 1 };
+  static const int XCSLBP_dy[8] = { 0, -1, -1, -1, 0, 1, 1, 1 };
+
+  XCSLBP::XCSLBP(int stripes) : fxRadius(1), fyRadius(1), borderLength(1), stripes(stripes)
   {
-    std::cout << "XCSLBP()" << std::endl;
   }
 
   XCSLBP::~XCSLBP()
   {
-    std::cout << "~XCSLBP()" << std::endl;
   }
 
-  void processXCSLBP(cv::Mat &gray, cv::Mat &out, int fxRadius, int fyRadius, const int neighborPoints[3], int borderLength)
+  // bit k compares the pair across the centre with the product of two other neighbours;
+  // _Wt holds the products: int for 8-bit pixels, double for the wider types
+  template <typename _Wt>
+  static inline int XCSLBP_code(_Wt c, const _Wt* v)
   {
-    int height = gray.size().height;
-    int width = gray.size().width;
-    int xyNeighborPoints = neighborPoints[0];
-    double nDim = pow(2.0, xyNeighborPoints / 2.0); // dimensionality of basic XC-LBP
+    int code = 0;
+    code |= ((v[0] - v[4] + c) + (v[0] - c) * (v[4] - c) <= 0) << 0;
+    code |= ((v[7] - v[3] + c) + (v[2] - c) * (v[6] - c) <= 0) << 1;
+    code |= ((v[6] - v[2] + c) + (v[1] - c) * (v[5] - c) <= 0) << 2;
+    code |= ((v[5] - v[1] + c) + (v[3] - c) * (v[7] - c) <= 0) << 3;
+    return code;
+  }
 
-    cv::Mat histogram(1, nDim, CV_8UC1);
+  template <typename _Tp, typename _Wt>
+  struct XCSLBPRows : public LBPRowKernel
+  {
+    const cv::Mat& gray;
+    cv::Mat& dst;
+    int borderLength;
 
-    int p1XY, pXY, pcXY;
+    XCSLBPRows(const cv::Mat& gray, cv::Mat& dst, int borderLength)
+      : gray(gray), dst(dst), borderLength(borderLength) {}
 
-    for (int yc = borderLength; yc < (height - borderLength); yc++)
+    void rows(int first, int last, int* hist) const
     {
-      for (int xc = borderLength; xc < (width - borderLength); xc++)
+      const int cols = gray.cols;
+      for (int y = first; y < last; y++)
       {
-        // obtain center value
-        int centerVal = gray.data[xc + yc * gray.cols];
-
-        // XY plane
-        int basicLBP = 0;
-        int featureBin = 0;
-        int countXY = 0;
-        int vXYNeighbor[8];
-
-        // store the neighbors in a vector
-        for (int k = 0; k < xyNeighborPoints; k++)
+        const _Tp* n[8];
+        for (int k = 0; k < 8; k++)
+          n[k] = gray.ptr<_Tp>(y + XCSLBP_dy[k]) + XCSLBP_dx[k];
+        const _Tp* center = gray.ptr<_Tp>(y);
+        unsigned char* out = dst.ptr<unsigned char>(y);
+
+        std::fill(out, out + borderLength, 0);
+        std::fill(out + cols - borderLength, out + cols, 0);
+        for (int x = borderLength; x < cols - borderLength; x++)
         {
-          float x = floor((double)xc + (double)fxRadius * cos((2 * M_PI * k) / xyNeighborPoints) + 0.5);
-          float y = floor((double)yc - (double)fyRadius * sin((2 * M_PI * k) / xyNeighborPoints) + 0.5);
-
-          vXYNeighbor[k] = gray.data[(int)x + (int)y * gray.cols];
-          countXY++;
+          _Wt v[8];
+          for (int k = 0; k < 8; k++)
+            v[k] = n[k][x];
+          int code = XCSLBP_code<_Wt>(center[x], v);
+          out[x] = static_cast<unsigned char>(code);
+          if (hist)
+            hist[code]++;
         }
+      }
+    }
+  };
 
-        // loop to calculate XCSLBP
-        for (int kXY = 0; kXY < 4; kXY++)
-        {
-          if (kXY == 0)
-          {
-            p1XY = vXYNeighbor[0] - vXYNeighbor[4];
-            pXY = vXYNeighbor[0] - centerVal;
-            pcXY = vXYNeighbor[4] - centerVal;
-          }
-
-          if (kXY == 1)
-          {
-            p1XY = vXYNeighbor[7] - vXYNeighbor[3];
-            pXY = vXYNeighbor[2] - centerVal;
-            pcXY = vXYNeighbor[6] - centerVal;
-          }
-
-          if (kXY == 2)
-          {
-            p1XY = vXYNeighbor[6] - vXYNeighbor[2];
-            pXY = vXYNeighbor[1] - centerVal;
-            pcXY = vXYNeighbor[5] - centerVal;
-          }
-
-          if (kXY == 3)
-          {
-            p1XY = vXYNeighbor[5] - vXYNeighbor[1];
-            pXY = vXYNeighbor[3] - centerVal;
-            pcXY = vXYNeighbor[7] - centerVal;
-          }
-
-          int currentVal = (p1XY + centerVal) + (pXY*pcXY);
-
-          if (currentVal <= 0)
-            basicLBP += pow(2.0, featureBin);
-
-          featureBin++;
-        }
-        // save pixel in output
-        out.data[xc + yc * gray.cols] = basicLBP;
-        histogram.data[basicLBP] += 1;
+  template <typename _Tp, typename _Wt>
+  void XCSLBP::XCSLBP_(const cv::Mat& gray, cv::Mat& dst, cv::Mat* hist)
+  {
+    const int rows = gray.rows;
+    const int cols = gray.cols;
+
+    // the codes along the image border stay zero
+    dst.create(rows, cols, CV_8UC1);
+    if (rows <= 2 * borderLength || cols <= 2 * borderLength) {
+      dst.setTo(cv::Scalar(0));
+      if (hist) {
+        hist->create(1, numPatterns(), CV_32SC1);
+        hist->setTo(cv::Scalar(0));
       }
+      return;
     }
+    dst.rowRange(0, borderLength).setTo(cv::Scalar(0));
+    dst.rowRange(rows - borderLength, rows).setTo(cv::Scalar(0));
+
+    runRowStripes(XCSLBPRows<_Tp, _Wt>(gray, dst, borderLength), borderLength, rows - borderLength, stripes, hist, numPatterns());
   }
 
   void XCSLBP::run(const cv::Mat &input, cv::Mat &XCSLBP)
   {
-    if (input.empty())
-      return;
+    XCSLBP_(input, XCSLBP, 0, context);
+  }
 
-    int height = input.size().height;
-    int width = input.size().width;
-    int channels = input.channels();
+  void XCSLBP::run(const cv::Mat &input, cv::Mat &XCSLBP, LBPContext &context)
+  {
+    XCSLBP_(input, XCSLBP, 0, context);
+  }
 
-    // convert input image to grayscale
-    cv::Mat gray;
-    if (channels > 1)
-      cv::cvtColor(input, gray, cv::COLOR_BGR2GRAY);
-    else
-      gray = input.clone();
+  void XCSLBP::run(const cv::Mat &input, cv::Mat &XCSLBP, cv::Mat &hist)
+  {
+    XCSLBP_(input, XCSLBP, &hist, context);
+  }
 
-    const int neighborPoints[3] = { 8, 8, 8 };
-    //int xyNeighborPoints = neighborPoints[0];
+  void XCSLBP::XCSLBP_(const cv::Mat &input, cv::Mat &XCSLBP, cv::Mat* hist, LBPContext& context)
+  {
+    if (input.empty())
+      return;
 
-    // create output background model
-    /*cv::Mat*/ XCSLBP = cv::Mat(height, width, CV_8UC1);
-    memset(XCSLBP.data, 0x00, XCSLBP.cols * XCSLBP.rows);
+    // convert input image to grayscale
+    cv::Mat gray = context.gray(input, XCSLBP);
 
-    // compute XCSLBP 
-    processXCSLBP(gray, XCSLBP, fxRadius, fyRadius, neighborPoints, borderLength);
+    switch (gray.type())
+    {
+      case CV_8SC1: XCSLBP_<char, int>(gray, XCSLBP, hist); break;
+      case CV_8UC1: XCSLBP_<unsigned char, int>(gray, XCSLBP, hist); break;
+      case CV_16SC1: XCSLBP_<short, double>(gray, XCSLBP, hist); break;
+      case CV_16UC1: XCSLBP_<unsigned short, double>(gray, XCSLBP, hist); break;
+      case CV_32SC1: XCSLBP_<int, double>(gray, XCSLBP, hist); break;
+      case CV_32FC1: XCSLBP_<float, double>(gray, XCSLBP, hist); break;
+      case CV_64FC1: XCSLBP_<double, double>(gray, XCSLBP, hist); break;
+    }
   }
 }
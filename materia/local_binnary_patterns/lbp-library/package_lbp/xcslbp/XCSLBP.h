@@ -11,11 +11,27 @@ namespace lbplibrary
     int fxRadius;
     int fyRadius;
     int borderLength;
-    
+    int stripes;
+
+    void XCSLBP_(const cv::Mat& input, cv::Mat& dst, cv::Mat* hist, LBPContext& context);
+    template <typename _Tp, typename _Wt>
+    void XCSLBP_(const cv::Mat& gray, cv::Mat& dst, cv::Mat* hist);
+
   public:
-    XCSLBP();
+    // stripes: 1 computes in the calling thread, n > 1 on n row stripes of the
+    // OpenCV thread pool, 0 picks the count from cv::getNumThreads()
+    XCSLBP(int stripes = 1);
     ~XCSLBP();
 
+    using LBP::run;
     void run(const cv::Mat &img_input, cv::Mat &img_output);
+    void run(const cv::Mat &img_input, cv::Mat &img_output, LBPContext &context);
+    // also counts the codes of the inner pixels in a 1 x numPatterns() CV_32SC1 histogram
+    void run(const cv::Mat &img_input, cv::Mat &img_output, cv::Mat &hist);
+
+    int numPatterns() const { return 16; }
+
+    int halo() const { return std::max(fyRadius, borderLength); }
+    LBPBorder border() const { return LBP_BORDER_SKIP; }
   };
 }
@@ -0,0 +1,456 @@
+// Golden-output regression test of the LBP operators.
+//
+//   lbp_golden DIR            compares every operator against the code images stored in DIR
+//   lbp_golden --update DIR   (re)writes them from the current implementation
+//
+// The inputs are generated here from a fixed seed, so they do not depend on the OpenCV
+// version: random, gradient, constant and odd-sized frames, 8U with 1 and 3 channels and
+// 16U / 32F with 1. The 3-channel frames repeat the gray value in every channel, so their
+// conversion to gray is exact in any OpenCV build; OCLBP, which reads the colours
+// themselves, gets true colour frames. Every operator is run at every SIMD level the CPU
+// has. The codes must match bit for bit, except for ELBP, whose bilinear interpolation may
+// flip single codes with a change of rounding, and VARLBP, whose codes are floating point.
+// Cases in the golden files that the run no longer produces fail as well.
+// Without golden files, StreamingLBP is checked against full runs and the LBPPyramid
+// descriptor against cells binned here.
+//
+// Golden files are one per operator, DIR/<name>.lbpg, little-endian: "LBPG", uint32 version,
+// uint32 case count, then per case uint32 name length, the name, int32 rows, cols and type,
+// and the rows of the code image.
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <map>
+#include <cstring>
+#include <opencv2/opencv.hpp>
+
+#include "lbplibrary.hpp"
+using namespace lbplibrary;
+
+struct GoldenOperator
+{
+	const char *name;      // file name
+	const char *op;        // LBPFactory name
+	LBPParams params;
+	double mismatch;       // fraction of codes allowed to differ, 0 for bit-exact
+	double tolerance;      // relative tolerance of floating point codes
+};
+
+static std::vector<GoldenOperator> golden_operators()
+{
+	std::vector<GoldenOperator> ops;
+	GoldenOperator list[] = {
+		{ "olbp", "olbp", LBPParams(), 0, 0 },
+		{ "olbp_u2", "olbp", { { "mapping", LBP_MAPPING_U2 } }, 0, 0 },
+		{ "elbp", "elbp", LBPParams(), 0.005, 0 },
+		{ "elbp_r2_p16_riu2", "elbp", { { "radius", 2 }, { "neighbors", 16 }, { "mapping", LBP_MAPPING_RIU2 } }, 0.005, 0 },
+		{ "varlbp", "varlbp", LBPParams(), 0, 1e-4 },
+		{ "varlbp_fixed", "varlbp", { { "fixedPoint", 1 } }, 0, 1e-4 },
+		{ "cslbp", "cslbp", LBPParams(), 0, 0 },
+		{ "csldp", "csldp", LBPParams(), 0, 0 },
+		{ "cssiltp", "cssiltp", LBPParams(), 0, 0 },
+		{ "xcslbp", "xcslbp", LBPParams(), 0, 0 },
+		{ "bglbp", "bglbp", LBPParams(), 0, 0 },
+		{ "siltp", "siltp", LBPParams(), 0, 0 },
+		{ "siltp_p8", "siltp", { { "neighbors", 8 } }, 0, 0 },
+		{ "scslbp", "scslbp", LBPParams(), 0, 0 },
+		{ "oclbp", "oclbp", LBPParams(), 0, 0 }
+	};
+	for (size_t i = 0; i < sizeof(list) / sizeof(list[0]); i++)
+		ops.push_back(list[i]);
+	return ops;
+}
+
+// xorshift32, the same sequence on every platform
+static unsigned int next_random(unsigned int &state)
+{
+	state ^= state << 13;
+	state ^= state >> 17;
+	state ^= state << 5;
+	return state;
+}
+
+static cv::Mat random_frame(int rows, int cols, int type, unsigned int seed)
+{
+	cv::Mat m(rows, cols, type);
+	unsigned int state = seed;
+	for (int i = 0; i < rows; i++)
+		for (int j = 0; j < cols * m.channels(); j++)
+		{
+			unsigned int v = next_random(state);
+			switch (m.depth())
+			{
+				case CV_8U: m.ptr<unsigned char>(i)[j] = (unsigned char)(v >> 24); break;
+				case CV_16U: m.ptr<unsigned short>(i)[j] = (unsigned short)(v >> 16); break;
+				case CV_32F: m.ptr<float>(i)[j] = (v >> 8) / 16777216.0f; break;
+			}
+		}
+	return m;
+}
+
+// diagonal ramp with flat runs, so that neighbours are equal, larger and smaller
+static cv::Mat gradient_frame(int rows, int cols)
+{
+	cv::Mat m(rows, cols, CV_8UC1);
+	for (int i = 0; i < rows; i++)
+		for (int j = 0; j < cols; j++)
+			m.at<unsigned char>(i, j) = (unsigned char)(((3 * j + 5 * i) / 2) * 4 % 256);
+	return m;
+}
+
+// the gray value in every channel
+static cv::Mat replicate(const cv::Mat &gray)
+{
+	std::vector<cv::Mat> planes(3, gray);
+	cv::Mat m;
+	cv::merge(planes, m);
+	return m;
+}
+
+static std::vector<std::pair<std::string, cv::Mat> > golden_inputs(bool colour)
+{
+	std::vector<std::pair<std::string, cv::Mat> > inputs;
+	if (colour)
+	{
+		inputs.push_back(std::make_pair(std::string("random_48x32_8uc3"), random_frame(32, 48, CV_8UC3, 1)));
+		inputs.push_back(std::make_pair(std::string("random_33x17_8uc3"), random_frame(17, 33, CV_8UC3, 2)));
+		inputs.push_back(std::make_pair(std::string("gradient_40x30_8uc3"), replicate(gradient_frame(30, 40))));
+		inputs.push_back(std::make_pair(std::string("constant_16x16_8uc3"), cv::Mat(16, 16, CV_8UC3, cv::Scalar(90, 128, 200))));
+		return inputs;
+	}
+	inputs.push_back(std::make_pair(std::string("random_48x32_8u"), random_frame(32, 48, CV_8UC1, 1)));
+	inputs.push_back(std::make_pair(std::string("random_33x17_8u"), random_frame(17, 33, CV_8UC1, 2)));
+	inputs.push_back(std::make_pair(std::string("gradient_40x30_8u"), gradient_frame(30, 40)));
+	inputs.push_back(std::make_pair(std::string("constant_16x16_8u"), cv::Mat(16, 16, CV_8UC1, cv::Scalar(128))));
+	inputs.push_back(std::make_pair(std::string("random_31x23_8uc3"), replicate(random_frame(23, 31, CV_8UC1, 3))));
+	inputs.push_back(std::make_pair(std::string("random_40x30_16u"), random_frame(30, 40, CV_16UC1, 4)));
+	inputs.push_back(std::make_pair(std::string("random_40x30_32f"), random_frame(30, 40, CV_32FC1, 5)));
+	return inputs;
+}
+
+// code images of one operator by case name; operators that leave a type alone give an empty Mat
+static std::map<std::string, cv::Mat> golden_run(const GoldenOperator &g)
+{
+	std::map<std::string, cv::Mat> codes;
+	const bool planes = std::string(g.op) == "oclbp";
+	std::vector<std::pair<std::string, cv::Mat> > inputs = golden_inputs(planes);
+	for (size_t i = 0; i < inputs.size(); i++)
+	{
+		LBP *lbp = LBPFactory::create(g.op, g.params);
+		if (planes)
+		{
+			std::vector<cv::Mat> out;
+			lbp->run(inputs[i].second, out);
+			for (size_t k = 0; k < out.size(); k++)
+			{
+				std::stringstream name;
+				name << inputs[i].first << "/" << k;
+				codes[name.str()] = out[k].clone();
+			}
+		}
+		else
+		{
+			cv::Mat out;
+			lbp->run(inputs[i].second, out);
+			codes[inputs[i].first] = out.clone();
+		}
+		delete lbp;
+	}
+	return codes;
+}
+
+static void write_u32(std::ostream &out, unsigned int v)
+{
+	unsigned char b[4] = { (unsigned char)v, (unsigned char)(v >> 8), (unsigned char)(v >> 16), (unsigned char)(v >> 24) };
+	out.write((const char *)b, 4);
+}
+
+static unsigned int read_u32(std::istream &in)
+{
+	unsigned char b[4] = { 0, 0, 0, 0 };
+	in.read((char *)b, 4);
+	return b[0] | (b[1] << 8) | (b[2] << 16) | ((unsigned int)b[3] << 24);
+}
+
+static bool write_golden(const std::string &path, const std::map<std::string, cv::Mat> &codes)
+{
+	std::ofstream out(path.c_str(), std::ios::binary);
+	out.write("LBPG", 4);
+	write_u32(out, 1);
+	write_u32(out, (unsigned int)codes.size());
+	for (std::map<std::string, cv::Mat>::const_iterator it = codes.begin(); it != codes.end(); ++it)
+	{
+		const cv::Mat &m = it->second;
+		write_u32(out, (unsigned int)it->first.size());
+		out.write(it->first.data(), it->first.size());
+		write_u32(out, (unsigned int)m.rows);
+		write_u32(out, (unsigned int)m.cols);
+		write_u32(out, (unsigned int)m.type());
+		for (int i = 0; i < m.rows; i++)
+			out.write((const char *)m.ptr(i), m.cols * m.elemSize());
+	}
+	return (bool)out;
+}
+
+static bool read_golden(const std::string &path, std::map<std::string, cv::Mat> &codes)
+{
+	std::ifstream in(path.c_str(), std::ios::binary);
+	char magic[4] = { 0, 0, 0, 0 };
+	in.read(magic, 4);
+	if (!in || memcmp(magic, "LBPG", 4) != 0 || read_u32(in) != 1)
+		return false;
+	unsigned int count = read_u32(in);
+	for (unsigned int c = 0; c < count && in; c++)
+	{
+		std::string name(read_u32(in), ' ');
+		in.read(&name[0], name.size());
+		int rows = (int)read_u32(in), cols = (int)read_u32(in), type = (int)read_u32(in);
+		cv::Mat m;
+		if (rows > 0 && cols > 0)
+		{
+			m.create(rows, cols, type);
+			for (int i = 0; i < rows; i++)
+				in.read((char *)m.ptr(i), cols * m.elemSize());
+		}
+		codes[name] = m;
+	}
+	return (bool)in;
+}
+
+// empty when the codes match within the operator's tolerance, otherwise what differs
+static std::string compare(const GoldenOperator &g, const cv::Mat &golden, const cv::Mat &codes)
+{
+	std::stringstream msg;
+	if (golden.empty() != codes.empty() || golden.size() != codes.size() || golden.type() != codes.type())
+	{
+		msg << "expected " << golden.cols << "x" << golden.rows << " type " << golden.type()
+			<< ", got " << codes.cols << "x" << codes.rows << " type " << codes.type();
+		return msg.str();
+	}
+
+	long differing = 0;
+	int first_i = -1, first_j = -1;
+	double expected = 0, got = 0;
+	const int n = golden.cols * golden.channels();
+	for (int i = 0; i < golden.rows; i++)
+		for (int j = 0; j < n; j++)
+		{
+			double a, b;
+			switch (golden.depth())
+			{
+				case CV_8U: a = golden.ptr<unsigned char>(i)[j]; b = codes.ptr<unsigned char>(i)[j]; break;
+				case CV_16U: a = golden.ptr<unsigned short>(i)[j]; b = codes.ptr<unsigned short>(i)[j]; break;
+				case CV_32S: a = golden.ptr<int>(i)[j]; b = codes.ptr<int>(i)[j]; break;
+				case CV_32F: a = golden.ptr<float>(i)[j]; b = codes.ptr<float>(i)[j]; break;
+				default: a = golden.ptr<double>(i)[j]; b = codes.ptr<double>(i)[j]; break;
+			}
+			if (std::abs(a - b) > g.tolerance * std::max(1.0, std::abs(a)))
+			{
+				if (differing++ == 0)
+				{
+					first_i = i;
+					first_j = j;
+					expected = a;
+					got = b;
+				}
+			}
+		}
+
+	if (differing > g.mismatch * golden.rows * n)
+	{
+		msg << differing << " of " << (long)golden.rows * n << " codes differ, first at row " << first_i
+			<< " column " << first_j << ": expected " << expected << ", got " << got;
+		return msg.str();
+	}
+	return "";
+}
+
+// StreamingLBP over a square moving across a random background must give, frame after
+// frame, the codes of a full run; one operator per border type. Returns the failures.
+static int check_streaming(int &checked)
+{
+	const char *names[] = { "olbp", "cslbp", "siltp", "bglbp" }; // crop, zero, replicate, skip
+	int failures = 0;
+	for (size_t o = 0; o < sizeof(names) / sizeof(names[0]); o++)
+	{
+		StreamingLBP stream(LBPFactory::create(names[o]), 0, cv::Size(16, 16));
+		LBP *lbp = LBPFactory::create(names[o]);
+		const cv::Mat background = random_frame(48, 64, CV_8UC1, 7);
+		int skipped = 0;
+		for (int f = 0; f < 6; f++)
+		{
+			cv::Mat frame = background.clone();
+			frame(cv::Rect(4 + 9 * f, 6 + 5 * f, 10, 10)).setTo(cv::Scalar(255));
+			cv::Mat expected;
+			lbp->run(frame, expected);
+			const cv::Mat &codes = stream.process(frame);
+			const cv::Size tiles = stream.tiles();
+			skipped += tiles.area() - stream.dirtyCount();
+			checked++;
+			GoldenOperator exact = { names[o], names[o], LBPParams(), 0, 0 };
+			std::string error = compare(exact, expected, codes);
+			if (!error.empty())
+			{
+				std::cout << "FAIL streaming " << names[o] << " frame " << f << ": " << error << std::endl;
+				failures++;
+			}
+		}
+		if (skipped == 0)
+		{
+			std::cout << "FAIL streaming " << names[o] << ": every tile was recomputed on every frame" << std::endl;
+			failures++;
+		}
+		delete lbp;
+	}
+	return failures;
+}
+
+// LBPPyramid descriptor layout: every scale in its slice, cell (x, y) at x * gridy + y, each
+// cell the histogram of its codes divided by its area, computed here from a separate ELBP.
+// Returns the failures.
+static int check_pyramid(int &checked)
+{
+	const int gridx = 3, gridy = 2;
+	LBPPyramid pyramid(gridx, gridy, LBP_MAPPING_U2);
+	pyramid.add(1, 8, 0);
+	pyramid.add(2, 8, 1);
+	pyramid.add(1, 8, 5); // 1x2 pixels, too small: zero
+	const cv::Mat frame = random_frame(40, 57, CV_8UC1, 11);
+	const cv::Mat descriptor = pyramid.compute(frame);
+
+	int failures = 0, size = 0;
+	const int radius[] = { 1, 2, 1 }, octave[] = { 0, 1, 5 };
+	for (int s = 0; s < pyramid.scales(); s++)
+	{
+		checked++;
+		const int n = pyramid.numPatterns(s);
+		std::stringstream error;
+		if (pyramid.offset(s) != size)
+			error << "offset " << pyramid.offset(s) << ", expected " << size;
+		cv::Mat level = frame;
+		for (int k = 0; k < octave[s] && !level.empty(); k++)
+		{
+			cv::Mat down;
+			if (level.rows > 1 && level.cols > 1)
+				cv::pyrDown(level, down);
+			level = down;
+		}
+		cv::Mat codes;
+		if (level.rows > 2 * radius[s] && level.cols > 2 * radius[s])
+		{
+			LBP *lbp = LBPFactory::create("elbp", { { "radius", radius[s] }, { "neighbors", 8 }, { "mapping", LBP_MAPPING_U2 } });
+			lbp->run(level, codes);
+			delete lbp;
+		}
+		for (int x = 0; x < gridx && error.str().empty(); x++)
+			for (int y = 0; y < gridy && error.str().empty(); y++)
+			{
+				std::vector<float> expected(n, 0.0f);
+				if (codes.rows >= gridy && codes.cols >= gridx)
+				{
+					cv::Rect cell(codes.cols * x / gridx, codes.rows * y / gridy, 0, 0);
+					cell.width = codes.cols * (x + 1) / gridx - cell.x;
+					cell.height = codes.rows * (y + 1) / gridy - cell.y;
+					for (int i = cell.y; i < cell.y + cell.height; i++)
+						for (int j = cell.x; j < cell.x + cell.width; j++)
+							expected[codes.at<int>(i, j)] += 1.0f;
+					for (int b = 0; b < n; b++)
+						expected[b] *= 1.0f / cell.area();
+				}
+				const float *got = descriptor.ptr<float>() + size + (x * gridy + y) * n;
+				for (int b = 0; b < n; b++)
+					if (got[b] != expected[b])
+					{
+						error << "cell (" << x << ", " << y << ") bin " << b << ": expected " << expected[b] << ", got " << got[b];
+						break;
+					}
+			}
+		if (!error.str().empty())
+		{
+			std::cout << "FAIL pyramid scale " << s << ": " << error.str() << std::endl;
+			failures++;
+		}
+		size += gridx * gridy * n;
+	}
+	checked++;
+	if (pyramid.descriptorSize() != size || descriptor.cols != size || descriptor.rows != 1 || descriptor.type() != CV_32FC1)
+	{
+		std::cout << "FAIL pyramid: descriptor " << descriptor.cols << "x" << descriptor.rows << " type " << descriptor.type()
+			<< ", expected " << size << "x1 type " << CV_32FC1 << std::endl;
+		failures++;
+	}
+	return failures;
+}
+
+int main(int argc, const char **argv)
+{
+	bool update = argc == 3 && std::string(argv[1]) == "--update";
+	if (argc != 2 && !update)
+	{
+		std::cerr << "usage: lbp_golden [--update] DIR" << std::endl;
+		return 2;
+	}
+	const std::string dir = argv[argc - 1];
+
+	std::vector<GoldenOperator> ops = golden_operators();
+	if (update)
+	{
+		setSimdLevel(SIMD_SCALAR); // the reference is the portable path
+		for (size_t o = 0; o < ops.size(); o++)
+		{
+			std::string path = dir + "/" + ops[o].name + ".lbpg";
+			if (!write_golden(path, golden_run(ops[o])))
+			{
+				std::cerr << "cannot write " << path << std::endl;
+				return 1;
+			}
+			std::cout << "wrote " << path << std::endl;
+		}
+		return 0;
+	}
+
+	int failures = 0, checked = 0;
+	const SimdLevel best = simdLevel();
+	for (size_t o = 0; o < ops.size(); o++)
+	{
+		std::map<std::string, cv::Mat> golden;
+		std::string path = dir + "/" + ops[o].name + ".lbpg";
+		if (!read_golden(path, golden))
+		{
+			std::cout << "FAIL " << ops[o].name << ": cannot read " << path << std::endl;
+			failures++;
+			continue;
+		}
+
+		for (int level = SIMD_SCALAR; level <= best; level++)
+		{
+			setSimdLevel((SimdLevel)level);
+			std::map<std::string, cv::Mat> codes = golden_run(ops[o]);
+			for (std::map<std::string, cv::Mat>::const_iterator it = codes.begin(); it != codes.end(); ++it)
+			{
+				checked++;
+				std::map<std::string, cv::Mat>::const_iterator g = golden.find(it->first);
+				std::string error = g == golden.end() ? "no golden codes, run lbp_golden --update" : compare(ops[o], g->second, it->second);
+				if (!error.empty())
+				{
+					std::cout << "FAIL " << ops[o].name << " " << it->first << " (" << simdLevelName((SimdLevel)level) << "): " << error << std::endl;
+					failures++;
+				}
+			}
+			// a case that disappeared from the run would otherwise go unnoticed
+			for (std::map<std::string, cv::Mat>::const_iterator g = golden.begin(); g != golden.end(); ++g)
+				if (codes.find(g->first) == codes.end())
+				{
+					checked++;
+					std::cout << "FAIL " << ops[o].name << " " << g->first << " (" << simdLevelName((SimdLevel)level) << "): not produced by the run" << std::endl;
+					failures++;
+				}
+		}
+		setSimdLevel(best);
+	}
+	failures += check_streaming(checked);
+	failures += check_pyramid(checked);
+
+	std::cout << checked - failures << " of " << checked << " code images match" << std::endl;
+	return failures == 0 ? 0 : 1;
+}
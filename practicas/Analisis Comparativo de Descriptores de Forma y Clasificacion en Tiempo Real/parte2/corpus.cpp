@@ -0,0 +1,353 @@
+#include "corpus.h"
+
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <sstream>
+#include <map>
+#include <cstring>
+#include <algorithm>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+// UTILIDADES: CARGAR/GUARDAR CORPUS CSV (IMPORTAR/EXPORTAR)
+
+
+void saveCorpus(const vector<ShapeDescriptor>& corpus, const string& filename) {
+    ofstream file(filename);
+    if (!file.is_open()) {
+        cerr << " No se pudo crear archivo: " << filename << endl;
+        return;
+    }
+    
+    for (const auto& desc : corpus) {
+        file << desc.label;
+        for (float f : desc.features) {
+            file << "," << f;
+        }
+        file << "\n";
+    }
+    
+    file.close();
+    cout << "✓ Corpus guardado: " << filename << " (" 
+         << corpus.size() << " ejemplos)" << endl;
+}
+
+
+vector<ShapeDescriptor> loadCorpus(const string& filename) {
+    vector<ShapeDescriptor> corpus;
+    ifstream file(filename);
+    
+    if (!file.is_open()) {
+        cerr << " No se pudo abrir archivo: " << filename << endl;
+        return corpus;
+    }
+    
+    string line;
+    while (getline(file, line)) {
+        stringstream ss(line);
+        string label;
+        getline(ss, label, ',');
+        
+        vector<float> features;
+        string value;
+        while (getline(ss, value, ',')) {
+            features.push_back(stof(value));
+        }
+        
+        corpus.push_back(ShapeDescriptor(features, label));
+    }
+    
+    file.close();
+    cout << "✓ Corpus cargado: " << filename << " (" 
+         << corpus.size() << " ejemplos)" << endl;
+    
+    return corpus;
+}
+
+// CORPUS BINARIO (MAPEADO EN MEMORIA)
+
+/**
+ * Formato de data/corpus.bin (little-endian, versión 2):
+ *
+ *   CorpusHeader (72 bytes)
+ *   diccionario de etiquetas: numLabels x (uint32 longitud + caracteres)
+ *   nombres de archivo, alineados a 8 bytes: (count + 1) uint64 desplazamientos
+ *     + caracteres
+ *   matriz de descriptores: count filas de stride float32, alineada a 64 bytes;
+ *     las columnas dim..stride-1 van a cero
+ *   etiquetas: count int32, índices en el diccionario
+ *
+ * La cabecera guarda el desplazamiento de cada bloque, así que classify
+ * hace mmap del archivo y lee la matriz sin copiarla ni parsearla.
+ */
+struct CorpusHeader {
+    char magic[4];           // "SHPC"
+    uint32_t version;
+    uint32_t dim;            // floats útiles por descriptor
+    uint32_t stride;         // floats por fila (dim redondeado a 8)
+    uint32_t numHarmonics;   // NUM_HARMONICS con que se entrenó
+    uint32_t numPoints;      // NUM_POINTS con que se entrenó
+    uint64_t count;          // descriptores
+    uint32_t numLabels;
+    uint32_t reserved;
+    uint64_t labelsOffset;
+    uint64_t namesOffset;
+    uint64_t matrixOffset;
+    uint64_t idsOffset;
+};
+
+static_assert(sizeof(CorpusHeader) == 72, "CorpusHeader no debe tener relleno");
+
+// Versión 2: los desplazamientos de los nombres van alineados a 8 bytes
+const uint32_t CORPUS_VERSION = 2;
+
+bool writeCorpusBinary(const vector<ShapeDescriptor>& corpus, const string& filename) {
+    const uint32_t dim = corpus.empty() ? NUM_HARMONICS : corpus[0].features.size();
+    const uint32_t stride = corpusStride(dim);
+
+    // Diccionario de etiquetas en orden de aparición
+    vector<string> labels;
+    map<string, int32_t> labelIds;
+    vector<int32_t> ids;
+    ids.reserve(corpus.size());
+    for (const auto& desc : corpus) {
+        if (desc.features.size() != dim) {
+            cerr << " Descriptores de diferente tamaño en el corpus" << endl;
+            return false;
+        }
+        auto it = labelIds.find(desc.label);
+        if (it == labelIds.end()) {
+            it = labelIds.emplace(desc.label, (int32_t)labels.size()).first;
+            labels.push_back(desc.label);
+        }
+        ids.push_back(it->second);
+    }
+
+    CorpusHeader header = {};
+    memcpy(header.magic, "SHPC", 4);
+    header.version = CORPUS_VERSION;
+    header.dim = dim;
+    header.stride = stride;
+    header.numHarmonics = NUM_HARMONICS;
+    header.numPoints = NUM_POINTS;
+    header.count = corpus.size();
+    header.numLabels = labels.size();
+
+    uint64_t offset = sizeof(CorpusHeader);
+    header.labelsOffset = offset;
+    for (const auto& l : labels) offset += sizeof(uint32_t) + l.size();
+    const uint64_t labelsEnd = offset;
+    // los uint64 de los nombres se leen directamente del mapeo
+    header.namesOffset = offset = (offset + 7) / 8 * 8;
+    vector<uint64_t> nameOffsets(corpus.size() + 1, 0);
+    for (size_t i = 0; i < corpus.size(); i++) {
+        nameOffsets[i + 1] = nameOffsets[i] + corpus[i].filename.size();
+    }
+    offset += nameOffsets.size() * sizeof(uint64_t) + nameOffsets.back();
+    header.matrixOffset = (offset + 63) / 64 * 64;
+    header.idsOffset = header.matrixOffset + (uint64_t)corpus.size() * stride * sizeof(float);
+
+    string tmp = filename + ".tmp";
+    ofstream file(tmp, ios::binary);
+    if (!file.is_open()) {
+        cerr << " No se pudo crear archivo: " << tmp << endl;
+        return false;
+    }
+
+    file.write((const char*)&header, sizeof(header));
+    for (const auto& l : labels) {
+        uint32_t len = l.size();
+        file.write((const char*)&len, sizeof(len));
+        file.write(l.data(), len);
+    }
+    vector<char> padding(header.namesOffset - labelsEnd, 0);
+    file.write(padding.data(), padding.size());
+    file.write((const char*)nameOffsets.data(), nameOffsets.size() * sizeof(uint64_t));
+    for (const auto& desc : corpus) file.write(desc.filename.data(), desc.filename.size());
+
+    padding.assign(header.matrixOffset - offset, 0);
+    file.write(padding.data(), padding.size());
+    vector<float> row(stride, 0.0f);
+    for (const auto& desc : corpus) {
+        copy(desc.features.begin(), desc.features.end(), row.begin());
+        file.write((const char*)row.data(), stride * sizeof(float));
+    }
+    file.write((const char*)ids.data(), ids.size() * sizeof(int32_t));
+
+    file.close();
+    if (!file) {
+        cerr << " Error escribiendo: " << tmp << endl;
+        return false;
+    }
+
+    error_code ec;
+    filesystem::rename(tmp, filename, ec);
+    if (ec) {
+        cerr << " No se pudo renombrar " << tmp << ": " << ec.message() << endl;
+        return false;
+    }
+
+    cout << "✓ Corpus binario guardado: " << filename << " (" << corpus.size()
+         << " ejemplos, " << labels.size() << " clases)" << endl;
+    return true;
+}
+
+void CorpusMap::close() {
+#ifdef _WIN32
+    buffer.clear();
+#else
+    if (base) munmap((void*)base, length);
+#endif
+    base = nullptr;
+    length = 0;
+    count = 0;
+    labelNames.clear();
+    features = nullptr;
+    ids = nullptr;
+    nameOffsets = nullptr;
+    names = nullptr;
+}
+
+bool CorpusMap::open(const string& filename) {
+    close();
+#ifdef _WIN32
+    ifstream file(filename, ios::binary);
+    if (!file.is_open()) {
+        cerr << " No se pudo abrir archivo: " << filename << endl;
+        return false;
+    }
+    file.seekg(0, ios::end);
+    length = file.tellg();
+    file.seekg(0, ios::beg);
+    // 63 bytes de margen para empezar en una dirección múltiplo de 64
+    buffer.assign(length + 63, 0);
+    char* aligned = buffer.data();
+    while ((uintptr_t)aligned % 64 != 0) aligned++;
+    if (!file.read(aligned, length)) {
+        buffer.clear();
+        length = 0;
+        cerr << " No se pudo leer archivo: " << filename << endl;
+        return false;
+    }
+    base = aligned;
+#else
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        cerr << " No se pudo abrir archivo: " << filename << endl;
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(CorpusHeader)) {
+        ::close(fd);
+        cerr << " Corpus binario inválido: " << filename << endl;
+        return false;
+    }
+    length = st.st_size;
+    void* p = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (p == MAP_FAILED) {
+        length = 0;
+        cerr << " No se pudo mapear archivo: " << filename << endl;
+        return false;
+    }
+    base = (const char*)p;
+#endif
+    if (!parse(filename)) {
+        close();
+        return false;
+    }
+    cout << "✓ Corpus cargado: " << filename << " (" << count << " ejemplos, "
+         << labelNames.size() << " clases)" << endl;
+    return true;
+}
+
+// Comprueba la cabecera y que cada bloque cabe en el archivo
+bool CorpusMap::parse(const string& filename) {
+    auto corrupt = [&]() {
+        cerr << " Corpus binario corrupto: " << filename << endl;
+        return false;
+    };
+
+    CorpusHeader h;
+    if (length < sizeof(h)) return corrupt();
+    memcpy(&h, base, sizeof(h));
+    if (memcmp(h.magic, "SHPC", 4) != 0 || h.version != CORPUS_VERSION) {
+        cerr << " Corpus binario inválido o de otra versión: " << filename
+             << " (vuelve a ejecutar train o import)" << endl;
+        return false;
+    }
+    // Cada tamaño se acota con una división antes de multiplicar o sumar, así
+    // ninguna cuenta en 64 bits desborda por muy corrupta que esté la cabecera
+    if (h.dim == 0 || h.stride < h.dim || h.stride % 8 != 0 ||
+        h.labelsOffset != sizeof(h) || h.namesOffset < h.labelsOffset || h.namesOffset % 8 != 0 ||
+        h.matrixOffset % 64 != 0 || h.matrixOffset > length || h.namesOffset > h.matrixOffset ||
+        h.count >= (h.matrixOffset - h.namesOffset) / sizeof(uint64_t)) {
+        return corrupt();
+    }
+    const uint64_t rowBytes = (uint64_t)h.stride * sizeof(float);
+    if (h.count > (length - h.matrixOffset) / rowBytes ||
+        h.idsOffset != h.matrixOffset + h.count * rowBytes ||
+        h.count > (length - h.idsOffset) / sizeof(int32_t)) {
+        return corrupt();
+    }
+    if (h.numHarmonics != (uint32_t)NUM_HARMONICS || h.numPoints != (uint32_t)NUM_POINTS) {
+        cerr << " El corpus se generó con otros parámetros (" << h.numHarmonics << " armónicos, "
+             << h.numPoints << " puntos); vuelve a ejecutar train" << endl;
+        return false;
+    }
+
+    const char* p = base + h.labelsOffset;
+    const char* end = base + h.namesOffset;
+    for (uint32_t i = 0; i < h.numLabels; i++) {
+        uint32_t len;
+        if (end - p < (ptrdiff_t)sizeof(len)) return corrupt();
+        memcpy(&len, p, sizeof(len));
+        p += sizeof(len);
+        if (end - p < (ptrdiff_t)len) return corrupt();
+        labelNames.emplace_back(p, len);
+        p += len;
+    }
+
+    nameOffsets = (const uint64_t*)(base + h.namesOffset);
+    names = (const char*)(nameOffsets + h.count + 1);
+    // Desplazamientos crecientes y el último dentro del bloque: todo nombre cabe
+    for (uint64_t i = 0; i < h.count; i++) {
+        if (nameOffsets[i] > nameOffsets[i + 1]) return corrupt();
+    }
+    if (nameOffsets[h.count] > (uint64_t)(base + h.matrixOffset - names)) return corrupt();
+    features = (const float*)(base + h.matrixOffset);
+    ids = (const int32_t*)(base + h.idsOffset);
+    for (uint64_t i = 0; i < h.count; i++) {
+        if (ids[i] < 0 || (uint32_t)ids[i] >= h.numLabels) return corrupt();
+    }
+
+    count = h.count;
+    dim_ = h.dim;
+    stride_ = h.stride;
+    return true;
+}
+
+vector<ShapeDescriptor> CorpusMap::toDescriptors() const {
+    vector<ShapeDescriptor> corpus;
+    corpus.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        corpus.emplace_back(vector<float>(row(i), row(i) + dim_), label(i), filename(i));
+    }
+    return corpus;
+}
+
+bool openCorpus(CorpusMap& corpus) {
+    if (!filesystem::exists(CORPUS_BIN) && filesystem::exists(CORPUS_CSV)) {
+        cout << "  Importando " << CORPUS_CSV << " → " << CORPUS_BIN << endl;
+        if (!writeCorpusBinary(loadCorpus(CORPUS_CSV), CORPUS_BIN)) return false;
+    }
+    return corpus.open(CORPUS_BIN);
+}
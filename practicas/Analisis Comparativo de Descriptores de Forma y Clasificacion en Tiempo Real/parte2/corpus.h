@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// CONSTANTES DEL DESCRIPTOR Y DEL CORPUS
+
+const int NUM_POINTS = 1024;        // Interpolación a 1024 puntos
+const int NUM_HARMONICS = 15;       // Número de armónicos para el descriptor
+const std::string CORPUS_BIN = "data/corpus.bin";  // Corpus binario (el que usan test y classify)
+const std::string CORPUS_CSV = "data/corpus.csv";  // Corpus en texto (solo importar/exportar)
+
+// ESTRUCTURA: Descriptor de Forma
+
+struct ShapeDescriptor {
+    std::vector<float> features;    
+    std::string label;              
+    std::string filename;           
+    
+    ShapeDescriptor() {}
+    ShapeDescriptor(const std::vector<float>& f, const std::string& l, const std::string& fn = "") 
+        : features(f), label(l), filename(fn) {}
+};
+
+// UTILIDADES: CARGAR/GUARDAR CORPUS CSV (IMPORTAR/EXPORTAR)
+
+void saveCorpus(const std::vector<ShapeDescriptor>& corpus, const std::string& filename);
+std::vector<ShapeDescriptor> loadCorpus(const std::string& filename);
+
+// CORPUS BINARIO (MAPEADO EN MEMORIA)
+
+// Filas de la matriz redondeadas a 8 floats (un registro AVX)
+inline uint32_t corpusStride(uint32_t dim) {
+    return (dim + 7) / 8 * 8;
+}
+
+/**
+ * Escribe el corpus en formato binario. Se escribe en un temporal que luego
+ * se renombra, para no romper un corpus que otro proceso tenga mapeado.
+ */
+bool writeCorpusBinary(const std::vector<ShapeDescriptor>& corpus, const std::string& filename);
+
+/**
+ * Corpus binario abierto con mmap: la matriz de descriptores y las etiquetas
+ * se leen directamente de las páginas del archivo, sin copias.
+ * (En Windows se lee el archivo entero a un búfer alineado a 64 bytes, como
+ * las páginas de mmap, para que los kernels puedan usar cargas alineadas.)
+ */
+class CorpusMap {
+public:
+    CorpusMap() {}
+    ~CorpusMap() { close(); }
+    CorpusMap(const CorpusMap&) = delete;
+    CorpusMap& operator=(const CorpusMap&) = delete;
+
+    bool open(const std::string& filename);
+    void close();
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    uint32_t dim() const { return dim_; }
+    uint32_t stride() const { return stride_; }
+
+    // Fila i de la matriz (stride floats, los dim primeros útiles)
+    const float* row(size_t i) const { return features + i * stride_; }
+    const float* data() const { return features; }
+    const int32_t* labelIds() const { return ids; }
+    const std::vector<std::string>& labels() const { return labelNames; }
+    const std::string& label(size_t i) const { return labelNames[ids[i]]; }
+    std::string filename(size_t i) const {
+        return std::string(names + nameOffsets[i], nameOffsets[i + 1] - nameOffsets[i]);
+    }
+
+    // Copia a descriptores sueltos (para exportar a CSV)
+    std::vector<ShapeDescriptor> toDescriptors() const;
+
+private:
+    const char* base = nullptr;
+    size_t length = 0;
+#ifdef _WIN32
+    std::vector<char> buffer;
+#endif
+    size_t count = 0;
+    uint32_t dim_ = 0, stride_ = 0;
+    std::vector<std::string> labelNames;
+    const float* features = nullptr;
+    const int32_t* ids = nullptr;
+    const uint64_t* nameOffsets = nullptr;
+    const char* names = nullptr;
+
+    bool parse(const std::string& filename);
+};
+
+/**
+ * Abre el corpus binario. Si todavía no existe pero hay un corpus.csv de una
+ * versión anterior, lo importa primero.
+ */
+bool openCorpus(CorpusMap& corpus);
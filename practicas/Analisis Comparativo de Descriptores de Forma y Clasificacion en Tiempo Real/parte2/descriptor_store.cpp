@@ -0,0 +1,226 @@
+#include "descriptor_store.h"
+
+#include <iostream>
+#include <cmath>
+#include <map>
+#include <limits>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+using namespace std;
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SHAPE_SIMD_AVX2
+#define SHAPE_TARGET_AVX2 __attribute__((target("avx2")))
+#elif defined(__aarch64__)
+#define SHAPE_SIMD_NEON
+#endif
+
+DescriptorStore::DescriptorStore(const CorpusMap& corpus)
+    : count(corpus.size()), dim_(corpus.dim()), stride_(corpus.stride()),
+      features(corpus.data()), ids(corpus.labelIds()), labelNames(corpus.labels()) {}
+
+DescriptorStore::DescriptorStore(const vector<ShapeDescriptor>& corpus) {
+    dim_ = corpus.empty() ? NUM_HARMONICS : corpus[0].features.size();
+    stride_ = corpusStride(dim_);
+    count = corpus.size();
+
+    // 16 floats de margen para alinear el inicio a 64 bytes
+    ownFeatures.assign(count * stride_ + 16, 0.0f);
+    float* aligned = ownFeatures.data();
+    while ((uintptr_t)aligned % 64 != 0) aligned++;
+
+    map<string, int32_t> labelIds;
+    ownIds.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        const auto& desc = corpus[i];
+        copy(desc.features.begin(), desc.features.begin() + min<size_t>(dim_, desc.features.size()), aligned + i * stride_);
+        auto it = labelIds.find(desc.label);
+        if (it == labelIds.end()) {
+            it = labelIds.emplace(desc.label, (int32_t)labelNames.size()).first;
+            labelNames.push_back(desc.label);
+        }
+        ownIds.push_back(it->second);
+    }
+    features = aligned;
+    ids = ownIds.data();
+}
+
+vector<float> DescriptorStore::padQuery(const vector<float>& f) const {
+    vector<float> q(stride_, 0.0f);
+    copy(f.begin(), f.begin() + min<size_t>(dim_, f.size()), q.begin());
+    return q;
+}
+
+#if defined(SHAPE_SIMD_AVX2)
+// Suma de cuadrados de una fila de Stride floats (8 por registro) contra la consulta
+template <uint32_t Stride>
+SHAPE_TARGET_AVX2 static inline __m256 rowL2Avx2(const __m256* q, const float* row) {
+    __m256 diff = _mm256_sub_ps(q[0], _mm256_load_ps(row));
+    __m256 sum = _mm256_mul_ps(diff, diff);
+    for (uint32_t k = 1; k < Stride / 8; k++) {
+        diff = _mm256_sub_ps(q[k], _mm256_load_ps(row + 8 * k));
+        sum = _mm256_add_ps(sum, _mm256_mul_ps(diff, diff));
+    }
+    return sum;
+}
+
+/**
+ * 8 filas por iteración: la suma de cuadrados de cada fila queda en un registro
+ * y tres niveles de hadd los reducen a un único registro con las 8 distancias.
+ * Cada carril guarda su mínimo y la fila correspondiente; al final se reduce.
+ * La consulta se carga una vez en registros, por eso Stride es fijo.
+ */
+template <uint32_t Stride>
+SHAPE_TARGET_AVX2 static size_t scanL2Avx2(const float* query, const float* rows,
+                                           size_t begin, size_t end, Neighbor& best) {
+    size_t i = begin;
+    // los índices de fila van en carriles de 32 bits
+    if (end - begin < 8 || end > (size_t)INT32_MAX) return i;
+
+    __m256 q[Stride / 8];
+    for (uint32_t k = 0; k < Stride / 8; k++) q[k] = _mm256_loadu_ps(query + 8 * k);
+
+    __m256 bestD = _mm256_set1_ps(best.distance);
+    __m256i bestI = _mm256_set1_epi32(-1);
+    __m256i idx = _mm256_add_epi32(_mm256_set1_epi32((int)begin), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+    for (; i + 8 <= end; i += 8) {
+        const float* row = rows + i * Stride;
+        __m256 acc[8];
+        for (int r = 0; r < 8; r++) acc[r] = rowL2Avx2<Stride>(q, row + r * Stride);
+        // [fila 0..3 | fila 0..3] parciales de cada mitad; sumar mitades da las 8 filas en orden
+        __m256 a = _mm256_hadd_ps(_mm256_hadd_ps(acc[0], acc[1]), _mm256_hadd_ps(acc[2], acc[3]));
+        __m256 b = _mm256_hadd_ps(_mm256_hadd_ps(acc[4], acc[5]), _mm256_hadd_ps(acc[6], acc[7]));
+        __m256 d = _mm256_add_ps(_mm256_permute2f128_ps(a, b, 0x20), _mm256_permute2f128_ps(a, b, 0x31));
+
+        __m256 closer = _mm256_cmp_ps(d, bestD, _CMP_LT_OQ);
+        bestD = _mm256_blendv_ps(bestD, d, closer);
+        bestI = _mm256_castps_si256(_mm256_blendv_ps(_mm256_castsi256_ps(bestI), _mm256_castsi256_ps(idx), closer));
+        idx = _mm256_add_epi32(idx, _mm256_set1_epi32(8));
+    }
+
+    alignas(32) float distances[8];
+    alignas(32) int32_t indices[8];
+    _mm256_store_ps(distances, bestD);
+    _mm256_store_si256((__m256i*)indices, bestI);
+    for (int l = 0; l < 8; l++) {
+        if (indices[l] >= 0) keepNearest(best, indices[l], distances[l]);
+    }
+    return i;
+}
+
+// Kernels para los descriptores de hasta 32 armónicos; el resto va por la versión escalar
+static size_t scanL2Avx2(const float* query, const float* rows, uint32_t stride,
+                         size_t begin, size_t end, Neighbor& best) {
+    switch (stride) {
+        case 8: return scanL2Avx2<8>(query, rows, begin, end, best);
+        case 16: return scanL2Avx2<16>(query, rows, begin, end, best);
+        case 24: return scanL2Avx2<24>(query, rows, begin, end, best);
+        case 32: return scanL2Avx2<32>(query, rows, begin, end, best);
+        default: return begin;
+    }
+}
+
+static bool hasAvx2() {
+    static const bool supported = __builtin_cpu_supports("avx2");
+    return supported;
+}
+#elif defined(SHAPE_SIMD_NEON)
+// Igual que la versión AVX2 con 4 filas por iteración, reducidas con vpaddq
+static size_t scanL2Neon(const float* query, const float* rows, uint32_t stride,
+                         size_t begin, size_t end, Neighbor& best) {
+    size_t i = begin;
+    for (; i + 4 <= end; i += 4) {
+        float32x4_t acc[4];
+        for (int r = 0; r < 4; r++) {
+            const float* row = rows + (i + r) * stride;
+            float32x4_t sum = vdupq_n_f32(0.0f);
+            for (uint32_t k = 0; k < stride; k += 4) {
+                float32x4_t diff = vsubq_f32(vld1q_f32(query + k), vld1q_f32(row + k));
+                sum = vmlaq_f32(sum, diff, diff);
+            }
+            acc[r] = sum;
+        }
+        float32x4_t d = vpaddq_f32(vpaddq_f32(acc[0], acc[1]), vpaddq_f32(acc[2], acc[3]));
+        float distances[4];
+        vst1q_f32(distances, d);
+        for (int l = 0; l < 4; l++) keepNearest(best, i + l, distances[l]);
+    }
+    return i;
+}
+#endif
+
+void DescriptorStore::scan(const float* query, size_t begin, size_t end, Neighbor& best) const {
+    size_t i = begin;
+#if defined(SHAPE_SIMD_AVX2)
+    if (hasAvx2()) i = scanL2Avx2(query, features, stride_, begin, end, best);
+#elif defined(SHAPE_SIMD_NEON)
+    i = scanL2Neon(query, features, stride_, begin, end, best);
+#endif
+    for (; i < end; i++) keepNearest(best, i, squaredL2(query, row(i), stride_));
+}
+
+Neighbor DescriptorStore::nearest(const float* query) const {
+    Neighbor best = {0, numeric_limits<float>::infinity()};
+    scan(query, 0, count, best);
+    return best;
+}
+
+void DescriptorStore::nearest(const float* queries, size_t n, vector<Neighbor>& out) const {
+    out.assign(n, Neighbor{0, numeric_limits<float>::infinity()});
+    // bloques de ~256 KB de matriz, que se quedan en L2 mientras pasan todas las consultas
+    const size_t tile = max<size_t>(8, (256 * 1024 / (stride_ * sizeof(float))) / 8 * 8);
+    for (size_t begin = 0; begin < count; begin += tile) {
+        size_t end = min(count, begin + tile);
+        for (size_t q = 0; q < n; q++) {
+            scan(queries + q * stride_, begin, end, out[q]);
+        }
+    }
+}
+
+uint64_t corpusFingerprint(const DescriptorStore& store) {
+    uint64_t h = 1469598103934665603ull;
+    auto mix = [&](const void* data, size_t bytes) {
+        const unsigned char* p = (const unsigned char*)data;
+        for (size_t i = 0; i < bytes; i++) {
+            h = (h ^ p[i]) * 1099511628211ull;
+        }
+    };
+    uint64_t count = store.size();
+    uint32_t dim = store.dim();
+    mix(&count, sizeof(count));
+    mix(&dim, sizeof(dim));
+    for (size_t s = 0; s < 64 && count > 0; s++) {
+        size_t i = s * (count - 1) / 63;
+        mix(store.row(i), dim * sizeof(float));
+        int32_t id = store.labelId(i);
+        mix(&id, sizeof(id));
+    }
+    return h;
+}
+
+pair<string, float> voteNeighbors(const DescriptorStore& store, const vector<Neighbor>& neighbors,
+                                  float threshold) {
+    if (neighbors.empty()) return {"unknown", 1e9};
+    const float nearest = sqrt(neighbors[0].distance);
+    size_t voters = 0;
+    vector<int> votes(store.labels().size(), 0);
+    for (const auto& n : neighbors) {
+        if (sqrt(n.distance) > threshold) break;
+        votes[store.labelId(n.index)]++;
+        voters++;
+    }
+    // los vecinos van de más cerca a más lejos: solo cambia con más votos
+    int winner = -1;
+    for (size_t i = 0; i < voters; i++) {
+        int id = store.labelId(neighbors[i].index);
+        if (winner < 0 || votes[id] > votes[winner]) winner = id;
+    }
+
+    if (winner < 0) return {"unknown", nearest};
+    return {store.labels()[winner], nearest};
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "corpus.h"
+
+// ALMACÉN DE DESCRIPTORES (BÚSQUEDA EXACTA VECTORIZADA)
+
+// Vecino encontrado: fila del almacén y distancia euclídea AL CUADRADO
+struct Neighbor {
+    size_t index;
+    float distance;
+};
+
+/**
+ * Todos los descriptores en una matriz float32 fila a fila, alineada a 64 bytes,
+ * con stride floats por fila (dim redondeado a 8, relleno a cero) y la etiqueta
+ * de cada fila como id en un diccionario.
+ *
+ * Sobre un CorpusMap es una vista del archivo mapeado, sin copias. Las consultas
+ * también van rellenas a stride floats (padQuery), así el relleno no suma nada y
+ * los kernels recorren filas completas de 8 en 8 floats.
+ */
+class DescriptorStore {
+public:
+    DescriptorStore() {}
+    explicit DescriptorStore(const CorpusMap& corpus);
+    explicit DescriptorStore(const std::vector<ShapeDescriptor>& corpus);
+    // features e ids pueden apuntar a ownFeatures/ownIds: una copia apuntaría al original
+    DescriptorStore(const DescriptorStore&) = delete;
+    DescriptorStore& operator=(const DescriptorStore&) = delete;
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    uint32_t dim() const { return dim_; }
+    uint32_t stride() const { return stride_; }
+
+    const float* row(size_t i) const { return features + i * stride_; }
+    int32_t labelId(size_t i) const { return ids[i]; }
+    const std::string& label(size_t i) const { return labelNames[ids[i]]; }
+    const std::vector<std::string>& labels() const { return labelNames; }
+
+    // Descriptor rellenado a stride floats
+    std::vector<float> padQuery(const std::vector<float>& features) const;
+
+    // Fila más cercana a query (stride floats)
+    Neighbor nearest(const float* query) const;
+    // Lo mismo para n consultas contiguas de stride floats cada una; recorre la
+    // matriz por bloques que caben en caché y pasa todas las consultas por cada uno
+    void nearest(const float* queries, size_t n, std::vector<Neighbor>& out) const;
+
+private:
+    size_t count = 0;
+    uint32_t dim_ = 0, stride_ = 0;
+    const float* features = nullptr;
+    const int32_t* ids = nullptr;
+    std::vector<std::string> labelNames;
+    // Memoria propia cuando no es una vista
+    std::vector<float> ownFeatures;
+    std::vector<int32_t> ownIds;
+
+    void scan(const float* query, size_t begin, size_t end, Neighbor& best) const;
+};
+
+// Distancia al cuadrado, escalar (también para las filas sueltas de los kernels)
+inline float squaredL2(const float* a, const float* b, uint32_t n) {
+    float sum = 0.0f;
+    for (uint32_t k = 0; k < n; k++) {
+        float diff = a[k] - b[k];
+        sum += diff * diff;
+    }
+    return sum;
+}
+
+// Se queda con el candidato si está más cerca; a igual distancia, la fila menor
+inline void keepNearest(Neighbor& best, size_t index, float distance) {
+    if (distance < best.distance || (distance == best.distance && index < best.index)) {
+        best.index = index;
+        best.distance = distance;
+    }
+}
+
+// Orden total de los vecinos: distancia y, a igualdad, fila
+inline bool closerThan(const Neighbor& a, const Neighbor& b) {
+    return a.distance < b.distance || (a.distance == b.distance && a.index < b.index);
+}
+
+// Montículo de máximos con los k mejores candidatos vistos; el peor, en front()
+inline void keepNearestK(std::vector<Neighbor>& heap, const Neighbor& candidate, size_t k) {
+    if (heap.size() < k) {
+        heap.push_back(candidate);
+        std::push_heap(heap.begin(), heap.end(), closerThan);
+    } else if (closerThan(candidate, heap.front())) {
+        std::pop_heap(heap.begin(), heap.end(), closerThan);
+        heap.back() = candidate;
+        std::push_heap(heap.begin(), heap.end(), closerThan);
+    }
+}
+
+/**
+ * Huella FNV-1a del tamaño del corpus y de 64 filas repartidas por la matriz:
+ * basta para detectar un corpus regenerado sin tener que leerlo entero.
+ */
+uint64_t corpusFingerprint(const DescriptorStore& store);
+
+/**
+ * Voto de los vecinos, ordenados del más cercano al más lejano: vota cada vecino
+ * a menos de threshold (distancia euclídea) y gana la clase con más votos; a
+ * igualdad, la del vecino más cercano. Si ningún vecino está a menos de
+ * threshold, la forma es "unknown". Devuelve también la distancia al más cercano.
+ */
+std::pair<std::string, float> voteNeighbors(const DescriptorStore& store, const std::vector<Neighbor>& neighbors,
+                                            float threshold);
@@ -0,0 +1,318 @@
+#include "ivfpq.h"
+
+#include <opencv2/opencv.hpp>
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <limits>
+
+using namespace cv;
+using namespace std;
+
+// Centroides de k-means (OpenCV) de las filas de samples, k x samples.cols
+static Mat trainKmeans(const Mat& samples, int k) {
+    Mat labels, centers;
+    kmeans(samples, k, labels, TermCriteria(TermCriteria::COUNT + TermCriteria::EPS, 20, 1e-4),
+           1, KMEANS_PP_CENTERS, centers);
+    return centers;
+}
+
+// Centroide del subespacio i más cercano al subvector residual
+uint8_t IvfPqIndex::encode(uint32_t i, const float* residual) const {
+    const uint32_t sub = subdim();
+    const float* book = &codebooks[(size_t)i * ksub * sub];
+    Neighbor best = {0, numeric_limits<float>::infinity()};
+    for (uint32_t j = 0; j < ksub; j++) {
+        keepNearest(best, j, squaredL2(residual, book + j * sub, sub));
+    }
+    return (uint8_t)best.index;
+}
+
+void IvfPqIndex::build(const DescriptorStore& store, uint32_t lists, uint32_t sub) {
+    count = store.size();
+    dim_ = store.dim();
+    stride_ = store.stride();
+    fingerprint = corpusFingerprint(store);
+    if (sub == 0 || stride_ % sub != 0) sub = IVF_SUBDIM;
+    m = stride_ / sub;
+    nlist = count == 0 ? 0 : (uint32_t)min<uint64_t>(lists ? lists : max(1.0, round(sqrt((double)count))), count);
+    ksub = (uint32_t)min<uint64_t>(IVF_KSUB, count);
+    offsets.assign(1, 0);
+    ids.clear();
+    codes.clear();
+    if (count == 0) return;
+
+    // Mismo índice para el mismo corpus
+    theRNG().state = 0x5eed;
+
+    // Muestra repartida por la matriz para los k-means
+    const size_t numSamples = min<size_t>(count, 32 * (size_t)max(nlist, ksub));
+    Mat samples(numSamples, stride_, CV_32F);
+    for (size_t s = 0; s < numSamples; s++) {
+        const float* row = store.row(s * count / numSamples);
+        copy(row, row + stride_, samples.ptr<float>(s));
+    }
+
+    Mat centers = trainKmeans(samples, nlist);
+    coarse.assign(centers.ptr<float>(0), centers.ptr<float>(0) + (size_t)nlist * stride_);
+    // Los centroides en un almacén: la asignación usa su búsqueda vectorizada
+    vector<ShapeDescriptor> centroids;
+    for (uint32_t l = 0; l < nlist; l++) {
+        centroids.emplace_back(vector<float>(&coarse[(size_t)l * stride_], &coarse[(size_t)l * stride_] + dim_), "");
+    }
+    DescriptorStore coarseStore(centroids);
+
+    // Diccionarios de cada subespacio, entrenados con los residuos de la muestra
+    vector<Neighbor> nearest;
+    coarseStore.nearest(samples.ptr<float>(0), numSamples, nearest);
+    Mat residuals(numSamples, stride_, CV_32F);
+    for (size_t s = 0; s < numSamples; s++) {
+        const float* c = &coarse[nearest[s].index * stride_];
+        for (uint32_t d = 0; d < stride_; d++) {
+            residuals.ptr<float>(s)[d] = samples.ptr<float>(s)[d] - c[d];
+        }
+    }
+    codebooks.assign((size_t)m * ksub * sub, 0.0f);
+    for (uint32_t i = 0; i < m; i++) {
+        Mat book = trainKmeans(residuals.colRange(i * sub, (i + 1) * sub).clone(), ksub);
+        copy(book.ptr<float>(0), book.ptr<float>(0) + (size_t)ksub * sub, &codebooks[(size_t)i * ksub * sub]);
+    }
+
+    // Lista de cada fila, por bloques para no duplicar el corpus
+    vector<uint32_t> assignment(count);
+    const size_t block = 4096;
+    for (size_t begin = 0; begin < count; begin += block) {
+        size_t n = min(block, count - begin);
+        coarseStore.nearest(store.row(begin), n, nearest);
+        for (size_t r = 0; r < n; r++) assignment[begin + r] = nearest[r].index;
+    }
+
+    // Filas agrupadas por lista, en el orden del corpus dentro de cada una
+    offsets.assign(nlist + 1, 0);
+    for (uint32_t l : assignment) offsets[l + 1]++;
+    for (uint32_t l = 0; l < nlist; l++) offsets[l + 1] += offsets[l];
+    vector<uint64_t> next(offsets.begin(), offsets.end() - 1);
+    ids.resize(count);
+    codes.resize(count * m);
+    vector<float> residual(stride_);
+    for (size_t r = 0; r < count; r++) {
+        const uint64_t pos = next[assignment[r]]++;
+        const float* row = store.row(r);
+        const float* c = &coarse[(size_t)assignment[r] * stride_];
+        for (uint32_t d = 0; d < stride_; d++) residual[d] = row[d] - c[d];
+        ids[pos] = r;
+        for (uint32_t i = 0; i < m; i++) codes[pos * m + i] = encode(i, &residual[i * sub]);
+    }
+
+    // Término de cada lista: ||r_ij||² + 2<c_l,i, r_ij>
+    listTerms.resize((size_t)nlist * m * ksub);
+    for (uint32_t l = 0; l < nlist; l++) {
+        for (uint32_t i = 0; i < m; i++) {
+            const float* c = &coarse[(size_t)l * stride_ + i * sub];
+            for (uint32_t j = 0; j < ksub; j++) {
+                const float* r = &codebooks[((size_t)i * ksub + j) * sub];
+                float term = 0.0f;
+                for (uint32_t d = 0; d < sub; d++) term += r[d] * (r[d] + 2.0f * c[d]);
+                listTerms[((size_t)l * m + i) * ksub + j] = term;
+            }
+        }
+    }
+}
+
+// Distancia aproximada de las filas de la lista l: m búsquedas en table por fila.
+// Solo pasan por el montículo de candidatos las que pueden entrar (bound)
+void IvfPqIndex::scanCodes(uint32_t l, float base, const float* table, size_t keep, float& bound,
+                           vector<Neighbor>& candidates) const {
+    const uint32_t subs = m, books = ksub;
+    const uint64_t end = offsets[l + 1];
+    const uint8_t* code = codes.data() + offsets[l] * subs;
+    for (uint64_t pos = offsets[l]; pos < end; pos++, code += subs) {
+        float distance = base;
+        for (uint32_t i = 0; i < subs; i++) distance += table[i * books + code[i]];
+        if (distance > bound) continue;
+        keepNearestK(candidates, {ids[pos], distance}, keep);
+        if (candidates.size() == keep) bound = candidates.front().distance;
+    }
+}
+
+size_t IvfPqIndex::memoryBytes() const {
+    return (coarse.size() + codebooks.size() + listTerms.size()) * sizeof(float) +
+           offsets.size() * sizeof(uint64_t) + ids.size() * sizeof(uint32_t) + codes.size();
+}
+
+void IvfPqIndex::search(const DescriptorStore& store, const float* query, size_t k, size_t nprobe,
+                        size_t rerank, vector<Neighbor>& out) const {
+    out.clear();
+    if (count == 0 || k == 0) return;
+    nprobe = min<size_t>(max<size_t>(nprobe, 1), nlist);
+
+    // Listas más cercanas
+    vector<Neighbor> probes(nlist);
+    for (uint32_t l = 0; l < nlist; l++) {
+        probes[l] = {l, squaredL2(query, &coarse[(size_t)l * stride_], stride_)};
+    }
+    partial_sort(probes.begin(), probes.begin() + nprobe, probes.end(), closerThan);
+
+    // Tabla de la consulta: -2<q_i, r_ij>
+    const uint32_t sub = subdim();
+    vector<float> inner((size_t)m * ksub), table((size_t)m * ksub);
+    for (uint32_t i = 0; i < m; i++) {
+        for (uint32_t j = 0; j < ksub; j++) {
+            const float* r = &codebooks[((size_t)i * ksub + j) * sub];
+            float dot = 0.0f;
+            for (uint32_t d = 0; d < sub; d++) dot += query[i * sub + d] * r[d];
+            inner[(size_t)i * ksub + j] = -2.0f * dot;
+        }
+    }
+
+    // Candidatos por distancia aproximada
+    const size_t keep = max(k, rerank);
+    vector<Neighbor> candidates;
+    candidates.reserve(keep + 1);
+    float bound = numeric_limits<float>::infinity();
+    for (size_t p = 0; p < nprobe; p++) {
+        const uint32_t l = probes[p].index;
+        const float* terms = &listTerms[(size_t)l * m * ksub];
+        for (size_t t = 0; t < table.size(); t++) table[t] = terms[t] + inner[t];
+        scanCodes(l, probes[p].distance, table.data(), keep, bound, candidates);
+    }
+
+    // Reordenación con la distancia exacta
+    out.reserve(k + 1);
+    for (const auto& c : candidates) {
+        keepNearestK(out, {c.index, squaredL2(query, store.row(c.index), stride_)}, k);
+    }
+    sort_heap(out.begin(), out.end(), closerThan);
+}
+
+bool IvfPqIndex::save(const string& filename) const {
+    string tmp = filename + ".tmp";
+    ofstream file(tmp, ios::binary);
+    if (!file.is_open()) {
+        cerr << " No se pudo crear archivo: " << tmp << endl;
+        return false;
+    }
+    file.write("SHPQ", 4);
+    file.write((const char*)&IVF_VERSION, sizeof(IVF_VERSION));
+    file.write((const char*)&dim_, sizeof(dim_));
+    file.write((const char*)&stride_, sizeof(stride_));
+    file.write((const char*)&nlist, sizeof(nlist));
+    file.write((const char*)&m, sizeof(m));
+    file.write((const char*)&ksub, sizeof(ksub));
+    file.write((const char*)&count, sizeof(count));
+    file.write((const char*)&fingerprint, sizeof(fingerprint));
+    file.write((const char*)coarse.data(), coarse.size() * sizeof(float));
+    file.write((const char*)codebooks.data(), codebooks.size() * sizeof(float));
+    file.write((const char*)listTerms.data(), listTerms.size() * sizeof(float));
+    file.write((const char*)offsets.data(), offsets.size() * sizeof(uint64_t));
+    file.write((const char*)ids.data(), ids.size() * sizeof(uint32_t));
+    file.write((const char*)codes.data(), codes.size());
+    file.close();
+    if (!file) {
+        cerr << " Error escribiendo: " << tmp << endl;
+        return false;
+    }
+
+    error_code ec;
+    filesystem::rename(tmp, filename, ec);
+    if (ec) {
+        cerr << " No se pudo renombrar " << tmp << ": " << ec.message() << endl;
+        return false;
+    }
+    cout << "✓ Índice IVF-PQ guardado: " << filename << " (" << nlist << " listas, "
+         << m << " bytes de código por fila)" << endl;
+    return true;
+}
+
+// Carga el índice si se construyó para este corpus y es coherente
+bool IvfPqIndex::load(const string& filename, const DescriptorStore& store) {
+    count = 0;
+    ifstream file(filename, ios::binary);
+    if (!file.is_open()) return false;
+
+    char magic[4];
+    uint32_t version, dim, stride, lists, subs, books;
+    uint64_t rows, print;
+    file.read(magic, 4);
+    file.read((char*)&version, sizeof(version));
+    file.read((char*)&dim, sizeof(dim));
+    file.read((char*)&stride, sizeof(stride));
+    file.read((char*)&lists, sizeof(lists));
+    file.read((char*)&subs, sizeof(subs));
+    file.read((char*)&books, sizeof(books));
+    file.read((char*)&rows, sizeof(rows));
+    file.read((char*)&print, sizeof(print));
+    if (!file || memcmp(magic, "SHPQ", 4) != 0 || version != IVF_VERSION ||
+        dim != store.dim() || stride != store.stride() || rows != store.size() ||
+        print != corpusFingerprint(store) || rows == 0 || lists == 0 || lists > rows ||
+        subs == 0 || stride % subs != 0 || books == 0 || books > IVF_KSUB) {
+        return false;
+    }
+
+    vector<float> c((size_t)lists * stride), b((size_t)books * stride), t((size_t)lists * subs * books);
+    vector<uint64_t> o(lists + 1);
+    vector<uint32_t> i(rows);
+    vector<uint8_t> q(rows * subs);
+    file.read((char*)c.data(), c.size() * sizeof(float));
+    file.read((char*)b.data(), b.size() * sizeof(float));
+    file.read((char*)t.data(), t.size() * sizeof(float));
+    file.read((char*)o.data(), o.size() * sizeof(uint64_t));
+    file.read((char*)i.data(), i.size() * sizeof(uint32_t));
+    file.read((char*)q.data(), q.size());
+    if (!file) return false;
+
+    // Listas consecutivas que cubren todas las filas, ids y códigos en rango
+    if (o[0] != 0 || o[lists] != rows) return false;
+    for (uint32_t l = 0; l < lists; l++) {
+        if (o[l] > o[l + 1]) return false;
+    }
+    for (uint32_t r : i) {
+        if (r >= rows) return false;
+    }
+    for (uint8_t code : q) {
+        if (code >= books) return false;
+    }
+
+    coarse.swap(c);
+    codebooks.swap(b);
+    listTerms.swap(t);
+    offsets.swap(o);
+    ids.swap(i);
+    codes.swap(q);
+    dim_ = dim;
+    stride_ = stride;
+    nlist = lists;
+    m = subs;
+    ksub = books;
+    fingerprint = print;
+    count = rows;
+    return true;
+}
+
+void openIvfPq(const DescriptorStore& store, IvfPqIndex& index) {
+    if (index.load(CORPUS_IVF, store)) return;
+    cout << "  Construyendo índice IVF-PQ para " << store.size() << " ejemplos..." << endl;
+    index.build(store);
+    index.save(CORPUS_IVF);
+}
+
+pair<string, float> classifyAnn(const ShapeDescriptor& testDescriptor, const DescriptorStore& store,
+                                const IvfPqIndex& index, size_t k, float threshold,
+                                size_t nprobe, size_t rerank) {
+    if (store.empty()) {
+        cerr << " Corpus de entrenamiento vacío" << endl;
+        return {"unknown", 1e9};
+    }
+    if (testDescriptor.features.size() != store.dim()) {
+        cerr << "Descriptores de diferente tamaño" << endl;
+        return {"unknown", 1e9};
+    }
+
+    vector<float> query = store.padQuery(testDescriptor.features);
+    vector<Neighbor> neighbors;
+    index.search(store, query.data(), max<size_t>(k, 1), nprobe, rerank, neighbors);
+    return voteNeighbors(store, neighbors, threshold);
+}
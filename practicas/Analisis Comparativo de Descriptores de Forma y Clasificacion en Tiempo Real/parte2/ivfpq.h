@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "descriptor_store.h"
+
+// ÍNDICE IVF-PQ (BÚSQUEDA APROXIMADA)
+
+/**
+ * Índice aproximado para galerías muy grandes. Un cuantizador grueso (k-means
+ * con nlist centroides) reparte las filas en listas invertidas, y cada fila se
+ * guarda como su residuo respecto al centroide de su lista, cuantizado por
+ * producto: el residuo se parte en m subvectores de stride / m floats y cada uno
+ * se sustituye por el índice (1 byte) del más cercano de los ksub centroides de
+ * su subespacio. Una fila ocupa m bytes de código y 4 de id en lugar de stride
+ * floats.
+ *
+ * Distancia aproximada a la fila de la lista l con residuo cuantizado r:
+ *   ||q - c_l||² + sum_i (||r_i||² + 2<c_l,i, r_i>) - 2 sum_i <q_i, r_i>
+ * El primer término sale de la búsqueda gruesa, el segundo se precalcula por
+ * lista al construir (listTerms) y el tercero es una tabla m x ksub que se
+ * calcula una vez por consulta. Las rerank mejores filas se reordenan con la
+ * distancia exacta sobre el corpus.
+ *
+ * data/corpus.ivfpq (little-endian, versión 1): "SHPQ", uint32 versión, dim,
+ * stride, nlist, m, ksub, uint64 filas, uint64 huella del corpus; después los
+ * centroides gruesos (nlist x stride float), los diccionarios (m x ksub x
+ * stride / m float), listTerms (nlist x m x ksub float), el inicio de cada
+ * lista (nlist + 1 uint64), los ids (uint32 por fila) y los códigos (m bytes
+ * por fila), lista a lista.
+ */
+const std::string CORPUS_IVF = "data/corpus.ivfpq";
+const uint32_t IVF_VERSION = 1;
+const uint32_t IVF_SUBDIM = 4;      // floats por subvector
+const uint32_t IVF_KSUB = 256;      // centroides por subespacio (códigos de 1 byte)
+const size_t IVF_NPROBE = 8;        // listas visitadas por consulta
+const size_t IVF_RERANK = 64;       // candidatos reordenados con la distancia exacta
+
+class IvfPqIndex {
+public:
+    // lists = 0: unas sqrt(filas) listas; subdim debe dividir a stride
+    void build(const DescriptorStore& store, uint32_t lists = 0, uint32_t subdim = IVF_SUBDIM);
+    bool save(const std::string& filename) const;
+    bool load(const std::string& filename, const DescriptorStore& store);
+    bool empty() const { return count == 0; }
+    uint32_t lists() const { return nlist; }
+    uint32_t subquantizers() const { return m; }
+    // Memoria que ocupa el índice (sin el corpus)
+    size_t memoryBytes() const;
+
+    // Los k vecinos aproximados de query (stride floats), del más cercano al más
+    // lejano con su distancia exacta: recorre las nprobe listas más cercanas y
+    // reordena las rerank filas con menor distancia aproximada
+    void search(const DescriptorStore& store, const float* query, size_t k, size_t nprobe,
+                size_t rerank, std::vector<Neighbor>& out) const;
+
+private:
+    uint32_t dim_ = 0, stride_ = 0, nlist = 0, m = 0, ksub = 0;
+    uint64_t count = 0;
+    uint64_t fingerprint = 0;
+    std::vector<float> coarse;        // nlist x stride
+    std::vector<float> codebooks;     // m x ksub x subdim
+    std::vector<float> listTerms;     // nlist x m x ksub
+    std::vector<uint64_t> offsets;    // lista l: posiciones [offsets[l], offsets[l + 1])
+    std::vector<uint32_t> ids;
+    std::vector<uint8_t> codes;
+
+    uint32_t subdim() const { return stride_ / m; }
+    uint8_t encode(uint32_t i, const float* residual) const;
+    void scanCodes(uint32_t l, float base, const float* table, size_t keep, float& bound,
+                   std::vector<Neighbor>& candidates) const;
+};
+
+/**
+ * Índice aproximado del corpus abierto: el guardado en CORPUS_IVF si corresponde
+ * a este corpus; si no, se construye y se guarda (los k-means tardan, por eso
+ * solo se construye la primera vez que se pide la búsqueda aproximada).
+ */
+void openIvfPq(const DescriptorStore& store, IvfPqIndex& index);
+
+// Clasificación por k vecinos aproximados del índice IVF-PQ (ver voteNeighbors)
+std::pair<std::string, float> classifyAnn(const ShapeDescriptor& testDescriptor, const DescriptorStore& store,
+                                          const IvfPqIndex& index, size_t k, float threshold,
+                                          size_t nprobe, size_t rerank);
@@ -0,0 +1,207 @@
+#include "kdtree.h"
+
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <limits>
+
+using namespace std;
+
+void KdTree::build(const DescriptorStore& store) {
+    nodes.clear();
+    count = store.size();
+    dim_ = store.dim();
+    stride_ = store.stride();
+    fingerprint = corpusFingerprint(store);
+    order.resize(count);
+    for (size_t i = 0; i < count; i++) order[i] = i;
+    if (count > 0) build(store, 0, count);
+}
+
+int32_t KdTree::build(const DescriptorStore& store, uint32_t begin, uint32_t end) {
+    const int32_t index = nodes.size();
+    nodes.push_back({begin, end, -1, -1, 0, 0.0f});
+    if (end - begin <= KD_LEAF_SIZE) return index;
+
+    // Dimensión con más dispersión en el rango
+    uint32_t bestDim = 0;
+    float bestSpread = 0.0f;
+    for (uint32_t d = 0; d < dim_; d++) {
+        float lo = numeric_limits<float>::infinity(), hi = -lo;
+        for (uint32_t i = begin; i < end; i++) {
+            float v = store.row(order[i])[d];
+            lo = min(lo, v);
+            hi = max(hi, v);
+        }
+        if (hi - lo > bestSpread) {
+            bestSpread = hi - lo;
+            bestDim = d;
+        }
+    }
+    // Todas las filas iguales: se queda como hoja
+    if (bestSpread == 0.0f) return index;
+
+    const uint32_t mid = begin + (end - begin) / 2;
+    nth_element(order.begin() + begin, order.begin() + mid, order.begin() + end,
+                [&](uint32_t a, uint32_t b) { return store.row(a)[bestDim] < store.row(b)[bestDim]; });
+    const float split = store.row(order[mid])[bestDim];
+
+    int32_t left = build(store, begin, mid);
+    int32_t right = build(store, mid, end);
+    nodes[index].left = left;
+    nodes[index].right = right;
+    nodes[index].dim = bestDim;
+    nodes[index].split = split;
+    return index;
+}
+
+/**
+ * Búsqueda con la cota incremental de Arya y Mount: offsets[d] es la distancia
+ * de la consulta a la celda actual en la dimensión d y rd la suma de sus
+ * cuadrados, la menor distancia posible a cualquier fila de la celda.
+ */
+void KdTree::search(const DescriptorStore& store, int32_t node, const float* query, float rd,
+                    float* offsets, size_t k, vector<Neighbor>& heap) const {
+    const KdNode& n = nodes[node];
+    if (n.left < 0) {
+        for (uint32_t i = n.begin; i < n.end; i++) {
+            keepNearestK(heap, {order[i], squaredL2(query, store.row(order[i]), stride_)}, k);
+        }
+        return;
+    }
+
+    const float diff = query[n.dim] - n.split;
+    const int32_t nearChild = diff < 0 ? n.left : n.right;
+    const int32_t farChild = diff < 0 ? n.right : n.left;
+    search(store, nearChild, query, rd, offsets, k, heap);
+
+    // <= para no perder filas a la misma distancia con menor índice
+    const float old = offsets[n.dim];
+    const float farRd = rd - old * old + diff * diff;
+    if (heap.size() < k || farRd <= heap.front().distance) {
+        offsets[n.dim] = diff;
+        search(store, farChild, query, farRd, offsets, k, heap);
+        offsets[n.dim] = old;
+    }
+}
+
+void KdTree::knn(const DescriptorStore& store, const float* query, size_t k, vector<Neighbor>& out) const {
+    out.clear();
+    if (nodes.empty() || k == 0) return;
+    vector<float> offsets(dim_, 0.0f);
+    out.reserve(k + 1);
+    search(store, 0, query, 0.0f, offsets.data(), k, out);
+    sort_heap(out.begin(), out.end(), closerThan);
+}
+
+bool KdTree::save(const string& filename) const {
+    string tmp = filename + ".tmp";
+    ofstream file(tmp, ios::binary);
+    if (!file.is_open()) {
+        cerr << " No se pudo crear archivo: " << tmp << endl;
+        return false;
+    }
+    uint64_t numNodes = nodes.size();
+    file.write("SHPK", 4);
+    file.write((const char*)&KD_VERSION, sizeof(KD_VERSION));
+    file.write((const char*)&dim_, sizeof(dim_));
+    file.write((const char*)&stride_, sizeof(stride_));
+    file.write((const char*)&count, sizeof(count));
+    file.write((const char*)&fingerprint, sizeof(fingerprint));
+    file.write((const char*)&numNodes, sizeof(numNodes));
+    file.write((const char*)nodes.data(), nodes.size() * sizeof(KdNode));
+    file.write((const char*)order.data(), order.size() * sizeof(uint32_t));
+    file.close();
+    if (!file) {
+        cerr << " Error escribiendo: " << tmp << endl;
+        return false;
+    }
+
+    error_code ec;
+    filesystem::rename(tmp, filename, ec);
+    if (ec) {
+        cerr << " No se pudo renombrar " << tmp << ": " << ec.message() << endl;
+        return false;
+    }
+    cout << "✓ Índice k-d guardado: " << filename << " (" << nodes.size() << " nodos)" << endl;
+    return true;
+}
+
+// Carga el índice si se construyó para este corpus y es coherente
+bool KdTree::load(const string& filename, const DescriptorStore& store) {
+    nodes.clear();
+    order.clear();
+    ifstream file(filename, ios::binary);
+    if (!file.is_open()) return false;
+
+    char magic[4];
+    uint32_t version, dim, stride;
+    uint64_t rows, print, numNodes;
+    file.read(magic, 4);
+    file.read((char*)&version, sizeof(version));
+    file.read((char*)&dim, sizeof(dim));
+    file.read((char*)&stride, sizeof(stride));
+    file.read((char*)&rows, sizeof(rows));
+    file.read((char*)&print, sizeof(print));
+    file.read((char*)&numNodes, sizeof(numNodes));
+    if (!file || memcmp(magic, "SHPK", 4) != 0 || version != KD_VERSION ||
+        dim != store.dim() || stride != store.stride() || rows != store.size() ||
+        print != corpusFingerprint(store) || numNodes > 2 * rows + 1) {
+        return false;
+    }
+
+    vector<KdNode> n(numNodes);
+    vector<uint32_t> o(rows);
+    file.read((char*)n.data(), numNodes * sizeof(KdNode));
+    file.read((char*)o.data(), rows * sizeof(uint32_t));
+    if (!file) return false;
+
+    // Los hijos van siempre después del padre, así la búsqueda no puede ciclar
+    for (uint64_t i = 0; i < numNodes; i++) {
+        const KdNode& node = n[i];
+        if (node.begin > node.end || node.end > rows || node.dim >= dim) return false;
+        if ((node.left < 0) != (node.right < 0)) return false;
+        if (node.left >= 0 && ((uint64_t)node.left <= i || (uint64_t)node.left >= numNodes ||
+                               (uint64_t)node.right <= i || (uint64_t)node.right >= numNodes)) {
+            return false;
+        }
+    }
+    for (uint32_t r : o) {
+        if (r >= rows) return false;
+    }
+
+    nodes.swap(n);
+    order.swap(o);
+    dim_ = dim;
+    stride_ = stride;
+    count = rows;
+    fingerprint = print;
+    return true;
+}
+
+void openKdTree(const DescriptorStore& store, KdTree& tree) {
+    if (tree.load(CORPUS_KDT, store)) return;
+    cout << "  Construyendo índice k-d para " << store.size() << " ejemplos..." << endl;
+    tree.build(store);
+    tree.save(CORPUS_KDT);
+}
+
+pair<string, float> classifyKnn(const ShapeDescriptor& testDescriptor, const DescriptorStore& store,
+                                const KdTree& tree, size_t k, float threshold) {
+    if (store.empty()) {
+        cerr << " Corpus de entrenamiento vacío" << endl;
+        return {"unknown", 1e9};
+    }
+    if (testDescriptor.features.size() != store.dim()) {
+        cerr << "Descriptores de diferente tamaño" << endl;
+        return {"unknown", 1e9};
+    }
+
+    vector<float> query = store.padQuery(testDescriptor.features);
+    vector<Neighbor> neighbors;
+    tree.knn(store, query.data(), max<size_t>(k, 1), neighbors);
+    return voteNeighbors(store, neighbors, threshold);
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "descriptor_store.h"
+
+// ÍNDICE K-D (K VECINOS EXACTOS)
+
+const std::string CORPUS_KDT = "data/corpus.kdt";  // Índice k-d del corpus binario
+
+/**
+ * Árbol k-d sobre las filas de un DescriptorStore. Cada nodo cubre un rango de
+ * order (las filas en el orden del árbol) y lo parte por la mediana de la
+ * dimensión con más dispersión; las hojas guardan hasta KD_LEAF_SIZE filas.
+ * Los descriptores de 15 armónicos tienen poca dimensión intrínseca, así que la
+ * búsqueda solo visita unas pocas hojas en lugar de recorrer todo el corpus.
+ *
+ * data/corpus.kdt (little-endian, versión 1): "SHPK", uint32 versión, uint32 dim,
+ * uint32 stride, uint64 filas, uint64 huella del corpus, uint64 nodos, los nodos
+ * (KdNode) y order (uint32 por fila). La huella identifica el corpus para el que
+ * se construyó; si no coincide, el índice se reconstruye.
+ */
+const uint32_t KD_LEAF_SIZE = 16;
+const uint32_t KD_VERSION = 1;
+
+struct KdNode {
+    uint32_t begin, end;     // rango en order
+    int32_t left, right;     // hijos; -1 en las hojas
+    uint32_t dim;            // dimensión de corte
+    float split;             // izquierda <= split <= derecha
+};
+
+static_assert(sizeof(KdNode) == 24, "KdNode no debe tener relleno");
+
+class KdTree {
+public:
+    void build(const DescriptorStore& store);
+    bool save(const std::string& filename) const;
+    bool load(const std::string& filename, const DescriptorStore& store);
+    bool empty() const { return nodes.empty(); }
+
+    // Los k vecinos más cercanos a query (stride floats), del más cercano al más
+    // lejano; a igual distancia va antes la fila menor, como en la búsqueda lineal
+    void knn(const DescriptorStore& store, const float* query, size_t k, std::vector<Neighbor>& out) const;
+
+private:
+    std::vector<KdNode> nodes;
+    std::vector<uint32_t> order;
+    uint32_t dim_ = 0, stride_ = 0;
+    uint64_t count = 0;
+    uint64_t fingerprint = 0;
+
+    int32_t build(const DescriptorStore& store, uint32_t begin, uint32_t end);
+    void search(const DescriptorStore& store, int32_t node, const float* query, float rd,
+                float* offsets, size_t k, std::vector<Neighbor>& heap) const;
+};
+
+/**
+ * Índice del corpus abierto: el guardado en CORPUS_KDT si corresponde a este
+ * corpus; si no (corpus importado o regenerado a mano), se construye y se guarda.
+ */
+void openKdTree(const DescriptorStore& store, KdTree& tree);
+
+// Clasificación por los k vecinos exactos del árbol k-d (ver voteNeighbors)
+std::pair<std::string, float> classifyKnn(const ShapeDescriptor& testDescriptor, const DescriptorStore& store,
+                                          const KdTree& tree, size_t k, float threshold);
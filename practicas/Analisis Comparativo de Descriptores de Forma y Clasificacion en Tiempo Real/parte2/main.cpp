@@ -16,30 +16,31 @@
 #include <vector>
 #include <string>
 #include <cmath>
-#include <fstream>
 #include <filesystem>
+#include <map>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <limits>
+
+#include "corpus.h"
+#include "descriptor_store.h"
+#include "kdtree.h"
+#include "ivfpq.h"
 
 using namespace cv;
 using namespace std;
 
 // CONSTANTES GLOBALES
 
-const int NUM_POINTS = 1024;        // Interpolación a 1024 puntos
-const int NUM_HARMONICS = 15;       // Número de armónicos para el descriptor
 const string TRAIN_DIR = "data/training/";  // Corpus de entrenamiento
 const string TEST_DIR = "data/testing/";    // Imágenes de prueba
 
-// ESTRUCTURA: Descriptor de Forma
-
-struct ShapeDescriptor {
-    vector<float> features;    
-    string label;              
-    string filename;           
-    
-    ShapeDescriptor() {}
-    ShapeDescriptor(const vector<float>& f, const string& l, const string& fn = "") 
-        : features(f), label(l), filename(fn) {}
-};
+// Traza de cada paso del pipeline; train la apaga porque extrae en varios hilos
+bool verbose = true;
 
 // PASO 1: PREPROCESAMIENTO Y EXTRACCIÓN DE CONTORNO
 
@@ -77,7 +78,7 @@ bool extractContour(const Mat& image, vector<Point>& contour) {
     findContours(binary, contours, RETR_EXTERNAL, CHAIN_APPROX_NONE);
     
     if (contours.empty()) {
-        cerr << " No se encontraron contornos en la imagen" << endl;
+        if (verbose) cerr << " No se encontraron contornos en la imagen" << endl;
         return false;
     }
     
@@ -96,11 +97,11 @@ bool extractContour(const Mat& image, vector<Point>& contour) {
     
     
     if (maxArea < 100) {
-        cerr << " Contorno muy pequeño (área < 100 píxeles)" << endl;
+        if (verbose) cerr << " Contorno muy pequeño (área < 100 píxeles)" << endl;
         return false;
     }
     
-    cout << "✓ Contorno extraído: " << contour.size() << " puntos, área = " 
+    if (verbose) cout << "✓ Contorno extraído: " << contour.size() << " puntos, área = " 
          << maxArea << " px²" << endl;
     
     return true;
@@ -116,7 +117,7 @@ vector<Point2f> interpolateContour(const vector<Point>& contour) {
     int n = contour.size();
     
     if (n < 3) {
-        cerr << " Contorno con muy pocos puntos: " << n << endl;
+        if (verbose) cerr << " Contorno con muy pocos puntos: " << n << endl;
         return vector<Point2f>();
     }
     
@@ -158,7 +159,7 @@ vector<Point2f> interpolateContour(const vector<Point>& contour) {
         }
     }
     
-    cout << "✓ Contorno interpolado: " << contour.size() 
+    if (verbose) cout << "✓ Contorno interpolado: " << contour.size() 
          << " → " << NUM_POINTS << " puntos" << endl;
     
     return interpolated;
@@ -179,7 +180,7 @@ Point2f calculateCentroid(const vector<Point2f>& contour) {
     
     Point2f centroid(sumX / contour.size(), sumY / contour.size());
     
-    cout << "✓ Centroide calculado: (" << centroid.x << ", " 
+    if (verbose) cout << "✓ Centroide calculado: (" << centroid.x << ", " 
          << centroid.y << ")" << endl;
     
     return centroid;
@@ -202,7 +203,7 @@ Mat buildComplexSignal(const vector<Point2f>& contour, const Point2f& centroid)
         complexSignal.at<Vec2f>(i, 0) = Vec2f(real, imag);
     }
     
-    cout << "✓ Señal compleja construida: z(n) = (x-xc) + j(y-yc)" << endl;
+    if (verbose) cout << "✓ Señal compleja construida: z(n) = (x-xc) + j(y-yc)" << endl;
     
     return complexSignal;
 }
@@ -230,7 +231,7 @@ void computeFFT(const Mat& complexSignal, vector<float>& magnitudes) {
         magnitudes.push_back(mag.at<float>(i, 0));
     }
     
-    cout << "✓ FFT calculada: " << magnitudes.size() << " coeficientes" << endl;
+    if (verbose) cout << "✓ FFT calculada: " << magnitudes.size() << " coeficientes" << endl;
 }
 
 // PASO 6: NORMALIZACIÓN 
@@ -244,7 +245,7 @@ void computeFFT(const Mat& complexSignal, vector<float>& magnitudes) {
  */
 vector<float> normalizeDescriptor(const vector<float>& magnitudes) {
     if (magnitudes.size() < 2) {
-        cerr << " Muy pocos coeficientes de Fourier" << endl;
+        if (verbose) cerr << " Muy pocos coeficientes de Fourier" << endl;
         return vector<float>(NUM_HARMONICS, 0.0f);
     }
     
@@ -254,7 +255,7 @@ vector<float> normalizeDescriptor(const vector<float>& magnitudes) {
     float fundamental = magnitudes[1];
     
     if (fundamental < 1e-5) {
-        cerr << "Fundamental muy pequeño, posible error en la señal" << endl;
+        if (verbose) cerr << "Fundamental muy pequeño, posible error en la señal" << endl;
         return vector<float>(NUM_HARMONICS, 0.0f);
     }
     
@@ -269,7 +270,7 @@ vector<float> normalizeDescriptor(const vector<float>& magnitudes) {
         descriptor.push_back(0.0f);
     }
     
-    cout << "✓ Descriptor normalizado: " << descriptor.size() 
+    if (verbose) cout << "✓ Descriptor normalizado: " << descriptor.size() 
          << " armónicos (F[0]=" << dc << " descartado)" << endl;
     
     return descriptor;
@@ -291,9 +292,11 @@ vector<float> normalizeDescriptor(const vector<float>& magnitudes) {
 ShapeDescriptor extractShapeDescriptor(const Mat& image, 
                                        const string& label = "", 
                                        const string& filename = "") {
-    cout << "\n========================================" << endl;
-    cout << "Procesando: " << (filename.empty() ? "imagen" : filename) << endl;
-    cout << "========================================" << endl;
+    if (verbose) {
+        cout << "\n========================================" << endl;
+        cout << "Procesando: " << (filename.empty() ? "imagen" : filename) << endl;
+        cout << "========================================" << endl;
+    }
     
     // PASO 1: Extraer contorno
     vector<Point> contour;
@@ -320,206 +323,244 @@ ShapeDescriptor extractShapeDescriptor(const Mat& image,
     // PASO 6: Normalizar
     vector<float> descriptor = normalizeDescriptor(magnitudes);
     
-    cout << "Descriptor extraído exitosamente" << endl;
+    if (verbose) cout << "Descriptor extraído exitosamente" << endl;
     
     return ShapeDescriptor(descriptor, label, filename);
 }
 
-// PASO 7: COMPARACIÓN (DISTANCIA EUCLÍDEA)
+// UTILIDADES: RECORRER EL DATASET
 
 /**
- * Calcula la distancia euclídea entre dos descriptores.
- * tenemos en cuenta que mientras más parecidas sean las formas, MÁS PEQUEÑO el valor de la distancia
- 
+ * Clases del dataset: un subdirectorio de dir por clase, en orden alfabético.
  */
-float euclideanDistance(const vector<float>& d1, const vector<float>& d2) {
-    if (d1.size() != d2.size()) {
-        cerr << "Descriptores de diferente tamaño" << endl;
-        return 1e9;  
-    }
-    
-    float sum = 0.0f;
-    for (size_t i = 0; i < d1.size(); i++) {
-        float diff = d1[i] - d2[i];
-        sum += diff * diff;
+vector<string> discoverClasses(const string& dir) {
+    vector<string> classes;
+    if (!filesystem::exists(dir)) return classes;
+    for (const auto& entry : filesystem::directory_iterator(dir)) {
+        if (entry.is_directory()) {
+            classes.push_back(entry.path().filename().string());
+        }
     }
-    
-    return sqrt(sum);
+    sort(classes.begin(), classes.end());
+    return classes;
 }
 
 /**
- * Clasifica una imagen comparándola con el corpus de entrenamiento.
- * 
- * Método:
- * - Calculamos la distancia a TODOS los ejemplos del corpus
- * - Seleccionar el más cercano, la dist. minima
- * - Retornamos su etiqueta
- * 
-
+ * Imágenes (.png, .jpg) de un directorio, ordenadas por nombre: directory_iterator
+ * no garantiza ningún orden y el corpus debe salir igual en cada ejecución.
  */
-pair<string, float> classify(const ShapeDescriptor& testDescriptor, 
-                             const vector<ShapeDescriptor>& trainingSet) {
-    if (trainingSet.empty()) {
-        cerr << " Corpus de entrenamiento vacío" << endl;
-        return {"unknown", 1e9};
-    }
-    
-    string bestLabel = "unknown";
-    float minDistance = 1e9;
-    
-    for (const auto& train : trainingSet) {
-        float dist = euclideanDistance(testDescriptor.features, train.features);
-        
-        if (dist < minDistance) {
-            minDistance = dist;
-            bestLabel = train.label;
+vector<filesystem::path> listImages(const string& dir) {
+    vector<filesystem::path> images;
+    for (const auto& entry : filesystem::directory_iterator(dir)) {
+        if (entry.path().extension() == ".png" || 
+            entry.path().extension() == ".jpg") {
+            images.push_back(entry.path());
         }
     }
-    
-    return {bestLabel, minDistance};
+    sort(images.begin(), images.end());
+    return images;
 }
 
-// UTILIDADES: CARGAR/GUARDAR CORPUS
-
+/**
+ * Cola acotada entre el hilo lector y los de extracción: el lector se bloquea
+ * cuando está llena, así no se decodifica el dataset entero en memoria.
+ */
+template <typename T>
+class BoundedQueue {
+public:
+    explicit BoundedQueue(size_t capacity) : capacity(capacity) {}
+
+    void push(T item) {
+        unique_lock<mutex> lock(m);
+        notFull.wait(lock, [&] { return items.size() < capacity; });
+        items.push_back(move(item));
+        notEmpty.notify_one();
+    }
 
-void saveCorpus(const vector<ShapeDescriptor>& corpus, const string& filename) {
-    ofstream file(filename);
-    if (!file.is_open()) {
-        cerr << " No se pudo crear archivo: " << filename << endl;
-        return;
+    // false cuando la cola está cerrada y vacía
+    bool pop(T& item) {
+        unique_lock<mutex> lock(m);
+        notEmpty.wait(lock, [&] { return !items.empty() || closed; });
+        if (items.empty()) return false;
+        item = move(items.front());
+        items.pop_front();
+        notFull.notify_one();
+        return true;
     }
-    
-    for (const auto& desc : corpus) {
-        file << desc.label;
-        for (float f : desc.features) {
-            file << "," << f;
-        }
-        file << "\n";
+
+    void close() {
+        lock_guard<mutex> lock(m);
+        closed = true;
+        notEmpty.notify_all();
     }
-    
-    file.close();
-    cout << "✓ Corpus guardado: " << filename << " (" 
-         << corpus.size() << " ejemplos)" << endl;
-}
 
+private:
+    size_t capacity;
+    deque<T> items;
+    bool closed = false;
+    mutex m;
+    condition_variable notFull, notEmpty;
+};
 
-vector<ShapeDescriptor> loadCorpus(const string& filename) {
-    vector<ShapeDescriptor> corpus;
-    ifstream file(filename);
-    
-    if (!file.is_open()) {
-        cerr << " No se pudo abrir archivo: " << filename << endl;
-        return corpus;
+// FUNCIÓN PRINCIPAL: GENERAR CORPUS DE ENTRENAMIENTO
+
+/**
+ * Genera el corpus de entrenamiento procesando todas las imágenes en train_dir.
+ *
+ * Las clases son los subdirectorios de TRAIN_DIR. Un hilo lee y decodifica las
+ * imágenes en orden y numThreads hilos extraen los descriptores; cada resultado
+ * se guarda en la posición de su imagen, así el corpus sale en el mismo orden
+ * (clase, nombre de archivo) con cualquier número de hilos.
+ */
+void generateTrainingCorpus(int numThreads = 0) {
+    cout << "\n GENERANDO CORPUS DE ENTRENAMIENTO..." << endl;
+
+    vector<string> classes = discoverClasses(TRAIN_DIR);
+    if (classes.empty()) {
+        cerr << " No hay clases (subdirectorios) en: " << TRAIN_DIR << endl;
+        return;
     }
-    
-    string line;
-    while (getline(file, line)) {
-        stringstream ss(line);
+
+    struct Job {
+        filesystem::path path;
         string label;
-        getline(ss, label, ',');
-        
-        vector<float> features;
-        string value;
-        while (getline(ss, value, ',')) {
-            features.push_back(stof(value));
+    };
+    vector<Job> jobs;
+    for (const string& cls : classes) {
+        for (const auto& path : listImages(TRAIN_DIR + cls + "/")) {
+            jobs.push_back({path, cls});
         }
-        
-        corpus.push_back(ShapeDescriptor(features, label));
     }
-    
-    file.close();
-    cout << "✓ Corpus cargado: " << filename << " (" 
-         << corpus.size() << " ejemplos)" << endl;
-    
-    return corpus;
-}
 
+    if (numThreads <= 0) {
+        numThreads = max(1u, thread::hardware_concurrency());
+    }
+    cout << "  " << classes.size() << " clases, " << jobs.size() << " imágenes, "
+         << numThreads << " hilos" << endl;
+
+    // Cada hilo ya es un núcleo: OpenCV no debe repartir además dft y los filtros
+    const int cvThreads = getNumThreads();
+    setNumThreads(1);
+    const bool wasVerbose = verbose;
+    verbose = false;
+
+    vector<ShapeDescriptor> results(jobs.size());
+    vector<char> failed(jobs.size(), 0);
+    BoundedQueue<pair<size_t, Mat>> queue(2 * numThreads);
+
+    thread reader([&] {
+        for (size_t i = 0; i < jobs.size(); i++) {
+            Mat img = imread(jobs[i].path.string());
+            if (img.empty()) {
+                failed[i] = 1;
+                continue;
+            }
+            queue.push({i, move(img)});
+        }
+        queue.close();
+    });
+
+    atomic<size_t> done(0);
+    vector<thread> workers;
+    for (int t = 0; t < numThreads; t++) {
+        workers.emplace_back([&] {
+            pair<size_t, Mat> item;
+            while (queue.pop(item)) {
+                const Job& job = jobs[item.first];
+                results[item.first] = extractShapeDescriptor(item.second, job.label, job.path.filename().string());
+                size_t n = ++done;
+                if (n % 1000 == 0) {
+                    cout << "  " + to_string(n) + " / " + to_string(jobs.size()) + "\n" << flush;
+                }
+            }
+        });
+    }
 
-// FUNCIÓN PRINCIPAL: GENERAR CORPUS DE ENTRENAMIENTO
+    reader.join();
+    for (auto& w : workers) w.join();
+    verbose = wasVerbose;
+    setNumThreads(cvThreads);
 
-//Genera el corpus de entrenamiento procesando todas las imágenes en train_dir.
-void generateTrainingCorpus() {
-    cout << "\n GENERANDO CORPUS DE ENTRENAMIENTO..." << endl;
-    
+    // Fusión en el orden de las imágenes
     vector<ShapeDescriptor> corpus;
-    vector<string> classes = {"circle", "triangle", "square"};
-    
-    for (const string& cls : classes) {
-        string classDir = TRAIN_DIR + cls + "/";
-        
-        if (!filesystem::exists(classDir)) {
-            cout << "  Directorio no existe: " << classDir << endl;
+    corpus.reserve(jobs.size());
+    for (size_t i = 0; i < jobs.size(); i++) {
+        if (failed[i] || results[i].features.empty()) {
+            cout << "  Sin descriptor: " << jobs[i].path.string() << endl;
             continue;
         }
-        
-        for (const auto& entry : filesystem::directory_iterator(classDir)) {
-            if (entry.path().extension() == ".png" || 
-                entry.path().extension() == ".jpg") {
-                
-                Mat img = imread(entry.path().string());
-                if (img.empty()) continue;
-                
-                ShapeDescriptor desc = extractShapeDescriptor(
-                    img, cls, entry.path().filename().string()
-                );
-                
-                if (!desc.features.empty()) {
-                    corpus.push_back(desc);
-                }
-            }
-        }
+        corpus.push_back(move(results[i]));
     }
-    
-    saveCorpus(corpus, "data/corpus.csv");
-    
+
+    if (writeCorpusBinary(corpus, CORPUS_BIN)) {
+        KdTree tree;
+        tree.build(DescriptorStore(corpus));
+        tree.save(CORPUS_KDT);
+    }
+
     cout << "\n CORPUS GENERADO: " << corpus.size() << " ejemplos" << endl;
 }
 
 // FUNCIÓN PRINCIPAL: EVALUAR EN DATASET DE PRUEBA
 
-void evaluateTestSet() {
+/**
+ * Evalúa el dataset de prueba con los k vecinos exactos del árbol k-d o, con
+ * nprobe > 0, con los aproximados del índice IVF-PQ.
+ */
+void evaluateTestSet(size_t k = 1, float threshold = numeric_limits<float>::infinity(),
+                     size_t nprobe = 0, size_t rerank = IVF_RERANK) {
     cout << "\n EVALUANDO DATASET DE PRUEBA..." << endl;
     
     // Cargar corpus
-    auto corpus = loadCorpus("data/corpus.csv");
-    if (corpus.empty()) {
+    CorpusMap corpus;
+    if (!openCorpus(corpus) || corpus.empty()) {
         cerr << " No se pudo cargar el corpus" << endl;
         return;
     }
+    DescriptorStore store(corpus);
+    KdTree tree;
+    IvfPqIndex index;
+    if (nprobe > 0) {
+        openIvfPq(store, index);
+    } else {
+        openKdTree(store, tree);
+    }
     
-    // Matriz de confusión
+    // Matriz de confusión, sobre las clases del dataset de prueba y del corpus
     map<string, map<string, int>> confusionMatrix;
-    vector<string> classes = {"circle", "triangle", "square"};
+    vector<string> classes = discoverClasses(TEST_DIR);
+    for (const string& label : store.labels()) {
+        if (find(classes.begin(), classes.end(), label) == classes.end()) {
+            classes.push_back(label);
+        }
+    }
     
-    for (const string& cls : classes) {
+    if (threshold < numeric_limits<float>::infinity()) {
+        classes.push_back("unknown");
+    }
+    
+    for (const string& cls : discoverClasses(TEST_DIR)) {
         string classDir = TEST_DIR + cls + "/";
         
-        if (!filesystem::exists(classDir)) {
-            cout << "  Directorio no existe: " << classDir << endl;
-            continue;
-        }
-        
-        for (const auto& entry : filesystem::directory_iterator(classDir)) {
-            if (entry.path().extension() == ".png" || 
-                entry.path().extension() == ".jpg") {
-                
-                Mat img = imread(entry.path().string());
-                if (img.empty()) continue;
-                
-                ShapeDescriptor desc = extractShapeDescriptor(
-                    img, cls, entry.path().filename().string()
-                );
-                
-                if (desc.features.empty()) continue;
-                
-                auto [predicted, distance] = classify(desc, corpus);
-                
-                confusionMatrix[cls][predicted]++;
-                
-                string status = (predicted == cls) ? "✓" : "✗";
-                cout << status << " Real: " << cls << " | Predicho: " 
-                     << predicted << " | Distancia: " << distance << endl;
-            }
+        for (const auto& path : listImages(classDir)) {
+            Mat img = imread(path.string());
+            if (img.empty()) continue;
+            
+            ShapeDescriptor desc = extractShapeDescriptor(
+                img, cls, path.filename().string()
+            );
+            
+            if (desc.features.empty()) continue;
+            
+            auto [predicted, distance] = nprobe > 0
+                ? classifyAnn(desc, store, index, k, threshold, nprobe, rerank)
+                : classifyKnn(desc, store, tree, k, threshold);
+            
+            confusionMatrix[cls][predicted]++;
+            
+            string status = (predicted == cls) ? "✓" : "✗";
+            cout << status << " Real: " << cls << " | Predicho: " 
+                 << predicted << " | Distancia: " << distance << endl;
         }
     }
     
@@ -550,8 +591,133 @@ void evaluateTestSet() {
     cout << "\n ACCURACY: " << accuracy << "%" << endl;
 }
 
+// FUNCIÓN PRINCIPAL: COMPARAR LA BÚSQUEDA APROXIMADA CON LA EXACTA
+
+// Microsegundos por consulta de search, repitiendo las consultas hasta ~2000
+template <typename Search>
+static double microsPerQuery(const vector<vector<float>>& queries, Search search) {
+    const size_t passes = max<size_t>(1, 2000 / queries.size());
+    int64 start = getTickCount();
+    for (size_t p = 0; p < passes; p++) {
+        for (const auto& q : queries) search(q.data());
+    }
+    double seconds = (getTickCount() - start) / getTickFrequency();
+    return 1e6 * seconds / (passes * queries.size());
+}
+
+/**
+ * Tabla de recall frente a latencia del índice IVF-PQ para distintos nprobe y
+ * rerank. La referencia son los k vecinos exactos del árbol k-d:
+ *  - recall@1: el primer vecino aproximado está a la distancia del exacto
+ *  - recall@k: fracción de los k vecinos no más lejos que el k-ésimo exacto
+ *  - clase: el voto de los vecinos aproximados coincide con el de los exactos
+ * queries van rellenas a stride floats.
+ */
+void benchmarkAnn(const DescriptorStore& store, const KdTree& tree, const IvfPqIndex& index,
+                  const vector<vector<float>>& queries, size_t k) {
+    const float inf = numeric_limits<float>::infinity();
+    vector<vector<Neighbor>> exact(queries.size());
+    for (size_t q = 0; q < queries.size(); q++) tree.knn(store, queries[q].data(), k, exact[q]);
+
+    Neighbor nearest;
+    vector<Neighbor> neighbors;
+    double bruteUs = microsPerQuery(queries, [&](const float* q) { nearest = store.nearest(q); });
+    double treeUs = microsPerQuery(queries, [&](const float* q) { tree.knn(store, q, k, neighbors); });
+
+    const size_t corpusBytes = store.size() * store.stride() * sizeof(float);
+    cout << "\n " << queries.size() << " consultas, " << store.size() << " filas, k = " << k << endl;
+    cout << "  Corpus: " << corpusBytes / 1024 << " KB | Índice IVF-PQ: " << index.memoryBytes() / 1024
+         << " KB (" << index.lists() << " listas, " << index.subquantizers() << " bytes de código por fila)" << endl;
+    cout << "  Exacta, fuerza bruta:            " << bruteUs << " us/consulta" << endl;
+    cout << "  Exacta, árbol k-d:               " << treeUs << " us/consulta" << endl;
+    cout << "\n  nprobe\trerank\trecall@1\trecall@" << k << "\tclase\tus/consulta" << endl;
+
+    vector<size_t> reranks = {k};
+    for (size_t r : {(size_t)16, IVF_RERANK, (size_t)256}) {
+        if (r > k) reranks.push_back(r);
+    }
+    // Potencias de 2 y todas las listas (equivale a recorrer todos los códigos)
+    vector<size_t> probes;
+    for (size_t nprobe = 1; nprobe < index.lists(); nprobe *= 2) probes.push_back(nprobe);
+    probes.push_back(index.lists());
+    for (size_t nprobe : probes) {
+        for (size_t rerank : reranks) {
+            size_t hits1 = 0, hitsK = 0, total = 0, sameClass = 0;
+            for (size_t q = 0; q < queries.size(); q++) {
+                index.search(store, queries[q].data(), k, nprobe, rerank, neighbors);
+                const auto& ref = exact[q];
+                if (!neighbors.empty() && neighbors[0].distance <= ref[0].distance) hits1++;
+                for (const auto& n : neighbors) {
+                    if (n.distance <= ref.back().distance) hitsK++;
+                }
+                total += ref.size();
+                if (voteNeighbors(store, neighbors, inf).first == voteNeighbors(store, ref, inf).first) sameClass++;
+            }
+            double us = microsPerQuery(queries, [&](const float* q) {
+                index.search(store, q, k, nprobe, rerank, neighbors);
+            });
+            cout << "  " << nprobe << "\t" << rerank << "\t" << 100.0 * hits1 / queries.size() << "%\t\t"
+                 << 100.0 * hitsK / total << "%\t" << 100.0 * sameClass / queries.size() << "%\t"
+                 << us << endl;
+        }
+    }
+}
+
+/**
+ * bench-ann: las consultas son los descriptores del dataset de prueba. Con
+ * lists o subdim distintos de 0 el índice se construye con ellos y no se guarda.
+ */
+void benchmarkAnn(size_t k, uint32_t lists, uint32_t subdim) {
+    cout << "\n COMPARANDO BÚSQUEDA APROXIMADA Y EXACTA..." << endl;
+
+    CorpusMap corpus;
+    if (!openCorpus(corpus) || corpus.empty()) {
+        cerr << " No se pudo cargar el corpus" << endl;
+        return;
+    }
+    DescriptorStore store(corpus);
+    KdTree tree;
+    openKdTree(store, tree);
+    IvfPqIndex index;
+    if (lists > 0 || subdim > 0) {
+        index.build(store, lists, subdim > 0 ? subdim : IVF_SUBDIM);
+    } else {
+        openIvfPq(store, index);
+    }
+
+    vector<vector<float>> queries;
+    const bool wasVerbose = verbose;
+    verbose = false;
+    for (const string& cls : discoverClasses(TEST_DIR)) {
+        for (const auto& path : listImages(TEST_DIR + cls + "/")) {
+            Mat img = imread(path.string());
+            if (img.empty()) continue;
+            ShapeDescriptor desc = extractShapeDescriptor(img, cls, path.filename().string());
+            if (desc.features.size() == store.dim()) queries.push_back(store.padQuery(desc.features));
+        }
+    }
+    verbose = wasVerbose;
+
+    if (queries.empty()) {
+        cerr << " No hay imágenes de prueba en: " << TEST_DIR << endl;
+        return;
+    }
+    benchmarkAnn(store, tree, index, queries, k);
+}
+
 // MAIN: MENÚ PRINCIPAL
 
+// Valor de una opción --nombre=valor, o def si no aparece
+double optionValue(int argc, char** argv, const string& name, double def) {
+    for (int i = 2; i < argc; i++) {
+        string arg = argv[i];
+        if (arg.compare(0, name.size() + 1, name + "=") == 0) {
+            return atof(arg.c_str() + name.size() + 1);
+        }
+    }
+    return def;
+}
+
 int main(int argc, char** argv) {
     cout << "================================================" << endl;
     cout << "  SHAPE SIGNATURE - FFT COORDENADAS COMPLEJAS  " << endl;
@@ -560,19 +726,31 @@ int main(int argc, char** argv) {
     
     if (argc < 2) {
         cout << "\nUso:" << endl;
-        cout << "  ./shape_app train         - Generar corpus de entrenamiento" << endl;
+        cout << "  ./shape_app train [hilos] - Generar corpus de entrenamiento" << endl;
         cout << "  ./shape_app test          - Evaluar dataset de prueba" << endl;
         cout << "  ./shape_app classify <img> - Clasificar una imagen" << endl;
+        cout << "      test y classify aceptan --k=N (vecinos que votan, 1 por defecto)" << endl;
+        cout << "      y --umbral=D (más lejos de D que todos los vecinos: unknown)" << endl;
+        cout << "      Con --nprobe=N buscan en el índice aproximado " << CORPUS_IVF << endl;
+        cout << "      (N listas visitadas, --rerank=R candidatos reordenados)" << endl;
+        cout << "  ./shape_app bench-ann     - Recall y latencia del índice aproximado frente al exacto" << endl;
+        cout << "      (--k=N, y --listas=L --subdim=S para probar otro índice sin guardarlo)" << endl;
+        cout << "  ./shape_app import [csv]  - Convertir un corpus CSV a " << CORPUS_BIN << endl;
+        cout << "  ./shape_app export [csv]  - Volcar " << CORPUS_BIN << " a CSV" << endl;
         return 0;
     }
     
     string mode = argv[1];
+    size_t k = max(1.0, optionValue(argc, argv, "--k", 1));
+    float threshold = optionValue(argc, argv, "--umbral", numeric_limits<float>::infinity());
+    size_t nprobe = max(0.0, optionValue(argc, argv, "--nprobe", 0));
+    size_t rerank = max(0.0, optionValue(argc, argv, "--rerank", IVF_RERANK));
     
     if (mode == "train") {
-        generateTrainingCorpus();
+        generateTrainingCorpus(argc >= 3 ? atoi(argv[2]) : 0);
     } 
     else if (mode == "test") {
-        evaluateTestSet();
+        evaluateTestSet(k, threshold, nprobe, rerank);
     } 
     else if (mode == "classify" && argc >= 3) {
         string imgPath = argv[2];
@@ -583,15 +761,44 @@ int main(int argc, char** argv) {
             return -1;
         }
         
-        auto corpus = loadCorpus("data/corpus.csv");
+        CorpusMap corpus;
+        if (!openCorpus(corpus)) return -1;
+        DescriptorStore store(corpus);
         auto desc = extractShapeDescriptor(img, "", imgPath);
         
         if (!desc.features.empty()) {
-            auto [predicted, distance] = classify(desc, corpus);
+            KdTree tree;
+            IvfPqIndex index;
+            if (nprobe > 0) {
+                openIvfPq(store, index);
+            } else {
+                openKdTree(store, tree);
+            }
+            auto [predicted, distance] = nprobe > 0
+                ? classifyAnn(desc, store, index, k, threshold, nprobe, rerank)
+                : classifyKnn(desc, store, tree, k, threshold);
             cout << "\n RESULTADO: " << predicted 
                  << " (distancia: " << distance << ")" << endl;
         }
     } 
+    else if (mode == "bench-ann") {
+        benchmarkAnn(k, max(0.0, optionValue(argc, argv, "--listas", 0)),
+                     max(0.0, optionValue(argc, argv, "--subdim", 0)));
+    }
+    else if (mode == "import") {
+        string csv = argc >= 3 ? argv[2] : CORPUS_CSV;
+        auto corpus = loadCorpus(csv);
+        if (corpus.empty() || !writeCorpusBinary(corpus, CORPUS_BIN)) return -1;
+        KdTree tree;
+        tree.build(DescriptorStore(corpus));
+        tree.save(CORPUS_KDT);
+    }
+    else if (mode == "export") {
+        string csv = argc >= 3 ? argv[2] : CORPUS_CSV;
+        CorpusMap corpus;
+        if (!corpus.open(CORPUS_BIN)) return -1;
+        saveCorpus(corpus.toDescriptors(), csv);
+    }
     else {
         cerr << " Modo no reconocido: " << mode << endl;
         return -1;